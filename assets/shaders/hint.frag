@@ -0,0 +1,11 @@
+#version 410 core
+
+// Hint Fragment Shader - Flat, translucent arrows (no lighting)
+
+out vec4 FragColor;
+
+uniform vec4 color;
+
+void main() {
+    FragColor = color;
+}
@@ -0,0 +1,53 @@
+#version 410 core
+
+/*
+ * Hint Vertex Shader - One arrow per board cell, pointing towards the goal.
+ *
+ * Drawn instanced with one instance per cell. The cell comes from
+ * gl_InstanceID and its flow direction from flowMap, a mask of the
+ * neighbours one step closer to the goal (bit 0 = +X, 1 = -X, 2 = +Z,
+ * 3 = -Z). Cells without a direction collapse to a point and are culled.
+ */
+
+layout (location = 0) in vec3 aPos; // Arrow along +X in the XZ plane
+
+uniform mat4 model; // Board transform (tilt)
+uniform mat4 view;
+uniform mat4 projection;
+
+uniform usampler2D flowMap;
+uniform ivec2 boardCells; // Cells across X and Z
+uniform float cellSize;
+uniform float arrowHeight; // Above the floor surface
+
+const vec2 STEPS[4] =
+    vec2[](vec2(1, 0), vec2(-1, 0), vec2(0, 1), vec2(0, -1));
+
+void main() {
+    ivec2 cell = ivec2(gl_InstanceID % boardCells.x,
+                       gl_InstanceID / boardCells.x);
+    uint mask = texelFetch(flowMap, cell, 0).r;
+    if (mask == 0u) {
+        gl_Position = vec4(0.0);
+        return;
+    }
+
+    vec2 dir = vec2(0.0);
+    vec2 first = vec2(0.0);
+    for (int k = 3; k >= 0; --k) {
+        if ((mask & (1u << uint(k))) != 0u) {
+            dir += STEPS[k];
+            first = STEPS[k];
+        }
+    }
+    // Opposite neighbours cancel out (both sides of a pillar)
+    dir = dot(dir, dir) > 0.0 ? normalize(dir) : first;
+
+    // Turn +X onto dir, then move to the cell centre
+    vec2 p = vec2(aPos.x * dir.x - aPos.z * dir.y,
+                  aPos.x * dir.y + aPos.z * dir.x) * cellSize;
+    vec2 centre = (vec2(cell) + 0.5 - vec2(boardCells) * 0.5) * cellSize;
+    vec3 localPos = vec3(centre.x + p.x, arrowHeight, centre.y + p.y);
+
+    gl_Position = projection * view * model * vec4(localPos, 1.0);
+}
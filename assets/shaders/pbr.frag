@@ -63,45 +63,50 @@
  * ============================================================================
  */
 
+// Variants (ShaderPermutations) may define INSTANCE_MATERIAL, ALBEDO_MAP,
+// NORMAL_MAP and ARM_MAP, so each draw compiles only what it samples
+
 out vec4 FragColor;
 
 in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
+#ifdef NORMAL_MAP
     mat3 TBN;
+#endif
+#ifdef INSTANCE_MATERIAL
+    flat vec3 Albedo;
+    flat vec2 MetallicRoughness;
+#endif
 } fs_in;
 
+// Uniform blocks, filled from a UniformRing (UniformBlocks.h mirrors them)
+#define MAX_LIGHTS 4
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec4 camPos;
+    vec4 ambientColor;
+    vec4 lightPositions[MAX_LIGHTS];  // w = type (0 = point, 1 = directional)
+    vec4 lightColors[MAX_LIGHTS];     // w = intensity
+    vec4 lightDirections[MAX_LIGHTS];
+    int numLights;
+};
+
 // Material parameters
-uniform vec3 albedo;
-uniform float metallic;
-uniform float roughness;
-uniform float ao;
+layout (std140) uniform MaterialBlock {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+};
 
 // Texture maps
 uniform sampler2D albedoMap;
 uniform sampler2D normalMap;
 uniform sampler2D armMap;  // Combined: R=AO, G=Roughness, B=Metallic
 
-uniform bool useAlbedoMap;
-uniform bool useNormalMap;
-uniform bool useARMMap;
-
-// Lights (supporting up to 4 lights for now)
-#define MAX_LIGHTS 4
-uniform int numLights;
-uniform vec3 lightPositions[MAX_LIGHTS];
-uniform vec3 lightColors[MAX_LIGHTS];
-uniform float lightIntensities[MAX_LIGHTS];
-uniform int lightTypes[MAX_LIGHTS]; // 0 = point, 1 = directional
-uniform vec3 lightDirections[MAX_LIGHTS];
-
-// Camera
-uniform vec3 camPos;
-
-// Environment
-uniform vec3 ambientColor;
-
 // Constants
 const float PI = 3.14159265359;
 
@@ -152,32 +157,38 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0) {
 // ----------------------------------------------------------------------------
 
 void main() {
-    // Sample textures or use uniform values
-    vec3 albedoVal = useAlbedoMap ? pow(texture(albedoMap, fs_in.TexCoords).rgb, vec3(2.2)) : albedo;
-    
-    // Material properties from ARM map or uniform fallback
+    // Sample textures or use uniform (or per-instance) values
+#ifdef INSTANCE_MATERIAL
+    vec3 albedoVal = fs_in.Albedo;
+    float metallicVal = fs_in.MetallicRoughness.x;
+    float roughnessVal = fs_in.MetallicRoughness.y;
+#else
+    vec3 albedoVal = albedo;
     float metallicVal = metallic;
     float roughnessVal = roughness;
+#endif
     float aoVal = ao;
+#ifdef ALBEDO_MAP
+    albedoVal = pow(texture(albedoMap, fs_in.TexCoords).rgb, vec3(2.2));
+#endif
     
-    if (useARMMap) {
-        // ARM texture: R=AO, G=Roughness, B=Metallic
-        vec3 arm = texture(armMap, fs_in.TexCoords).rgb;
-        aoVal = arm.r;
-        roughnessVal = arm.g;
-        metallicVal = arm.b;
-    }
+#ifdef ARM_MAP
+    // ARM texture: R=AO, G=Roughness, B=Metallic
+    vec3 arm = texture(armMap, fs_in.TexCoords).rgb;
+    aoVal = arm.r;
+    roughnessVal = arm.g;
+    metallicVal = arm.b;
+#endif
     
     // Normal mapping
-    vec3 N;
-    if (useNormalMap) {
-        vec3 tangentNormal = texture(normalMap, fs_in.TexCoords).xyz * 2.0 - 1.0;
-        N = normalize(fs_in.TBN * tangentNormal);
-    } else {
-        N = normalize(fs_in.Normal);
-    }
+#ifdef NORMAL_MAP
+    vec3 tangentNormal = texture(normalMap, fs_in.TexCoords).xyz * 2.0 - 1.0;
+    vec3 N = normalize(fs_in.TBN * tangentNormal);
+#else
+    vec3 N = normalize(fs_in.Normal);
+#endif
     
-    vec3 V = normalize(camPos - fs_in.FragPos);
+    vec3 V = normalize(camPos.xyz - fs_in.FragPos);
 
     // Base reflectivity: 0.04 for dielectrics, albedo for metals
     vec3 F0 = vec3(0.04);
@@ -190,19 +201,19 @@ void main() {
         vec3 L;
         float attenuation;
         
-        if (lightTypes[i] == 1) {
+        if (lightPositions[i].w == 1.0) {
             // Directional light
-            L = normalize(-lightDirections[i]);
+            L = normalize(-lightDirections[i].xyz);
             attenuation = 1.0;
         } else {
             // Point light
-            L = normalize(lightPositions[i] - fs_in.FragPos);
-            float distance = length(lightPositions[i] - fs_in.FragPos);
+            L = normalize(lightPositions[i].xyz - fs_in.FragPos);
+            float distance = length(lightPositions[i].xyz - fs_in.FragPos);
             attenuation = 1.0 / (distance * distance);  // Inverse square falloff
         }
         
         vec3 H = normalize(V + L);
-        vec3 radiance = lightColors[i] * lightIntensities[i] * attenuation;
+        vec3 radiance = lightColors[i].rgb * lightColors[i].w * attenuation;
 
         // Calculate Cook-Torrance BRDF
         float NDF = DistributionGGX(N, H, roughnessVal);
@@ -226,7 +237,7 @@ void main() {
     }
 
     // Ambient lighting (simple constant ambient for now)
-    vec3 ambient = ambientColor * albedoVal * aoVal;
+    vec3 ambient = ambientColor.rgb * albedoVal * aoVal;
 
     vec3 color = ambient + Lo;
 
@@ -1,39 +1,79 @@
 #version 410 core
 
+// Variants (ShaderPermutations) may define INSTANCING, INSTANCE_MATERIAL,
+// ALBEDO_MAP, NORMAL_MAP and ARM_MAP
+
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
 layout (location = 2) in vec2 aTexCoords;
 layout (location = 3) in vec3 aTangent;
 layout (location = 4) in vec3 aBitangent;
+// Per instance (divisor 1)
+layout (location = 5) in vec4 aInstancePlacement; // xyz offset, w scale
+layout (location = 6) in vec4 aInstanceMaterial;  // rgb albedo, a metallic
+layout (location = 7) in float aInstanceRoughness;
 
 out VS_OUT {
     vec3 FragPos;       // Fragment position in world space
     vec3 Normal;        // Normal in world space
     vec2 TexCoords;
+#ifdef NORMAL_MAP
     mat3 TBN;           // Tangent-Bitangent-Normal matrix for normal mapping
+#endif
+#ifdef INSTANCE_MATERIAL
+    flat vec3 Albedo;
+    flat vec2 MetallicRoughness;
+#endif
 } vs_out;
 
-uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+// Uniform blocks, filled from a UniformRing (UniformBlocks.h mirrors them)
+#define MAX_LIGHTS 4
+layout (std140) uniform FrameBlock {
+    mat4 view;
+    mat4 projection;
+    vec4 camPos;
+    vec4 ambientColor;
+    vec4 lightPositions[MAX_LIGHTS];  // w = type (0 = point, 1 = directional)
+    vec4 lightColors[MAX_LIGHTS];     // w = intensity
+    vec4 lightDirections[MAX_LIGHTS];
+    int numLights;
+};
+
+layout (std140) uniform ObjectBlock {
+    mat4 model;
+    mat3 normalMatrix;  // transpose(inverse(mat3(model))), from the CPU
+};
 
 void main() {
+    // Instanced draws scale each copy and place it at its offset in model
+    // space. The scale is uniform, so normals need no correction for it.
+#ifdef INSTANCING
+    vec3 localPos = aPos * aInstancePlacement.w + aInstancePlacement.xyz;
+#else
+    vec3 localPos = aPos;
+#endif
+#ifdef INSTANCE_MATERIAL
+    vs_out.Albedo = aInstanceMaterial.rgb;
+    vs_out.MetallicRoughness = vec2(aInstanceMaterial.a, aInstanceRoughness);
+#endif
+
     // Transform position to world space
-    vec4 worldPos = model * vec4(aPos, 1.0);
+    vec4 worldPos = model * vec4(localPos, 1.0);
     vs_out.FragPos = worldPos.xyz;
     
     // Transform normal to world space (use normal matrix for non-uniform scaling)
-    mat3 normalMatrix = transpose(inverse(mat3(model)));
     vs_out.Normal = normalize(normalMatrix * aNormal);
     
     // Pass through texture coordinates
     vs_out.TexCoords = aTexCoords;
     
+#ifdef NORMAL_MAP
     // Compute TBN matrix for normal mapping
     vec3 T = normalize(normalMatrix * aTangent);
     vec3 B = normalize(normalMatrix * aBitangent);
     vec3 N = vs_out.Normal;
     vs_out.TBN = mat3(T, B, N);
+#endif
     
     gl_Position = projection * view * worldPos;
 }
@@ -0,0 +1,93 @@
+#ifndef AUTOPLAYER_H
+#define AUTOPLAYER_H
+
+#include "Ball.h"
+#include "Config.h"
+#include "FlowField.h"
+#include "Simulation.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Level;
+class ThreadPool;
+
+/**
+ * Autoplayer - Plays a level headlessly to estimate how hard it is.
+ *
+ * An attempt plays the level from the start with a receding-horizon Monte
+ * Carlo search. Every decision interval it tries a handful of candidate
+ * tilts. Each candidate is a rollout on its own copy of the Ball: the
+ * candidate tilt is held for one interval, then a greedy steering policy
+ * follows the level's FlowField for the rest of the horizon. The rollout
+ * that ends closest to the goal (by flow distance) wins, and its tilt is
+ * played with some random error to stand in for an imperfect human hand.
+ *
+ * Attempts differ only in their seed, so a level's results are the same
+ * on any number of threads. grade() runs every (level, attempt) pair as
+ * one item on a work-stealing ThreadPool.
+ */
+class Autoplayer {
+public:
+  struct Settings {
+    int attempts = Config::AUTOPLAY_ATTEMPTS;
+    int candidates = Config::AUTOPLAY_CANDIDATES;
+    float decisionSeconds = Config::AUTOPLAY_DECISION_SECONDS;
+    float horizonSeconds = Config::AUTOPLAY_HORIZON_SECONDS;
+    float timeLimitSeconds = Config::AUTOPLAY_TIME_LIMIT_SECONDS;
+    float tiltError = Config::AUTOPLAY_TILT_ERROR; // Fraction of max tilt
+    float tickRate = Config::PHYSICS_TICK_RATE;
+    uint64_t seed = 1;
+  };
+
+  struct Attempt {
+    GamePhase outcome = GamePhase::Playing; // Playing = out of time
+    float seconds = 0.0f;                   // Game time played
+    uint64_t rollouts = 0;
+    uint64_t ticks = 0; // Ball updates, rollouts included
+  };
+
+  struct LevelResult {
+    int attempts = 0;
+    int solved = 0;
+    int fell = 0;
+    int timedOut = 0;
+    float solveRate = 0.0f;
+    float fallRate = 0.0f;      // Hole-fall risk
+    float medianSeconds = 0.0f; // Over solved attempts, 0 if none
+    uint64_t rollouts = 0;
+    uint64_t ticks = 0;
+  };
+
+  Autoplayer(const Level &level, const Settings &settings);
+
+  Attempt play(uint64_t seed) const;
+
+  static LevelResult summarize(const std::vector<Attempt> &attempts);
+
+  // settings.attempts attempts on each level; results[i] is for levels[i]
+  static std::vector<LevelResult>
+  grade(const std::vector<const Level *> &levels, const Settings &settings,
+        ThreadPool &pool);
+
+  // Attempt seed for a (level, attempt) pair under a base seed
+  static uint64_t attemptSeed(uint64_t base, size_t level, int attempt);
+
+private:
+  const Level &level;
+  Settings settings;
+  FlowField flow;
+  Ball startBall;
+  float dt;
+  float maxTilt;
+
+  glm::vec2 steer(const Ball &ball) const;
+  // Distance left to the goal in cells (lower is better)
+  float potential(const Ball &ball) const;
+  // Score of holding `tilt` for `holdTicks` and steering after that
+  float rollout(Ball ball, glm::vec2 tilt, int holdTicks, int horizonTicks,
+                uint64_t &ticks) const;
+  glm::vec2 clampTilt(glm::vec2 tilt) const;
+};
+
+#endif // AUTOPLAYER_H
@@ -13,6 +13,7 @@ class Ball {
 public:
   glm::vec3 position = glm::vec3(0.0f);
   glm::vec3 velocity = glm::vec3(0.0f);
+  glm::vec3 previousPosition = glm::vec3(0.0f); // Position before last update
   float radius = 0.35f;
 
   bool isFalling = false;
@@ -21,8 +22,17 @@ public:
   Ball() = default;
 
   void reset(const Level &level);
-  void update(float dt, glm::vec2 tiltRadians, Level &level);
+  void update(float dt, glm::vec2 tiltRadians, const Level &level);
+  // Move by `move` with swept wall collision, bouncing velocity at contacts
+  static void sweepMotion(glm::vec3 &position, glm::vec3 &velocity,
+                          glm::vec3 move, float radius, const Level &level);
+
   bool hasFallenInHole() const { return isFalling && fallProgress >= 1.0f; }
+
+  // Blend between the last two physics states (alpha from PhysicsClock)
+  glm::vec3 getRenderPosition(float alpha) const {
+    return glm::mix(previousPosition, position, alpha);
+  }
 };
 
 #endif // BALL_H
@@ -0,0 +1,78 @@
+#ifndef BALL_BATCH_H
+#define BALL_BATCH_H
+
+#include "Ball.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Level;
+
+/**
+ * BallBatch - Many marbles simulated together in structure-of-arrays form.
+ *
+ * step() produces exactly the same state as calling Ball::update on every
+ * marble (and Level::isAtGoal afterwards), but does the arithmetic for
+ * 4 or 8 marbles at a time with SSE2, AVX2 or NEON. Per-marble branching
+ * work (the swept collision near walls, cell lookups for holes and goals)
+ * runs only for the lanes that need it.
+ *
+ * All marbles in a batch share one radius and one board tilt.
+ */
+class BallBatch {
+public:
+  enum class Kernel { Scalar, SSE2, AVX2, NEON };
+
+  explicit BallBatch(float radius = 0.35f);
+
+  // Fastest kernel supported by this build and CPU
+  static Kernel bestKernel();
+  static bool isSupported(Kernel kernel);
+  static const char *kernelName(Kernel kernel);
+
+  // Unsupported kernels fall back to the scalar path
+  void setKernel(Kernel k) { kernel = k; }
+  Kernel getKernel() const { return kernel; }
+
+  size_t size() const { return px.size(); }
+  float getRadius() const { return radius; }
+  void reserve(size_t count);
+  void clear();
+
+  // Append a marble (its radius is replaced by the batch radius)
+  size_t add(const Ball &ball);
+  Ball get(size_t i) const;
+  void set(size_t i, const Ball &ball);
+  void remove(size_t i); // Swap-with-last removal
+
+  void step(float dt, glm::vec2 tiltRadians, const Level &level);
+
+  glm::vec3 getPosition(size_t i) const { return {px[i], py[i], pz[i]}; }
+  glm::vec3 getRenderPosition(size_t i, float alpha) const;
+  bool isFalling(size_t i) const { return falling[i] != 0.0f; }
+  bool hasFallenInHole(size_t i) const {
+    return falling[i] != 0.0f && fall[i] >= 1.0f;
+  }
+  bool isAtGoal(size_t i) const { return atGoal[i] != 0; }
+
+  // Raw lanes, for kernels and for systems that work on the whole batch
+  std::vector<float> px, py, pz;
+  std::vector<float> vx, vz;
+  std::vector<float> prevX, prevY, prevZ;
+  std::vector<float> fall;    // Fall animation progress
+  std::vector<float> falling; // 1.0 while falling into a hole, else 0.0
+  std::vector<uint8_t> atGoal;
+
+private:
+  float radius;
+  Kernel kernel;
+
+  // Scratch lists reused between steps (no per-step allocation)
+  std::vector<float> moveX, moveZ;
+  std::vector<uint32_t> sweepLanes, cellLanes;
+
+  void stepScalar(size_t begin, size_t end, float dt, glm::vec2 tilt,
+                  const Level &level);
+};
+
+#endif // BALL_BATCH_H
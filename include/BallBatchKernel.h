@@ -0,0 +1,240 @@
+#ifndef BALL_BATCH_KERNEL_H
+#define BALL_BATCH_KERNEL_H
+
+#include "SimdMath.h"
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * Internal to BallBatch: the vectorized passes of a batch step.
+ *
+ * A step runs in four passes over a block of lanes:
+ *   1. integrate (SIMD)  - tilt, friction, speed clamp, falling animation;
+ *                          lanes clear of walls move, the rest are listed
+ *   2. sweep (scalar)    - Ball::sweepMotion for the listed lanes
+ *   3. settle (SIMD)     - distance field push-out, bounce, hole/goal filter
+ *   4. cells (scalar)    - exact hole/goal tests for the filtered lanes
+ *
+ * Every operation mirrors the scalar expression in Ball::update and
+ * DistanceField::sample in the same order, so results are bit-identical.
+ * The filters in passes 1 and 3 are conservative and only decide which
+ * lanes take the scalar path.
+ */
+
+struct BallBatchStep {
+  float dt, ax, az, friction, maxSpeed, bounce, radius, fallDelta;
+
+  // Distance field tiles (DistanceField::Sample is 3 floats)
+  const float *field;
+  const int32_t *fieldTiles;
+  int fieldTilesX, fieldTileShift;
+  int fieldX, fieldZ;
+  float fieldOriginX, fieldOriginZ, fieldSpacing;
+  float sweepMargin; // Worst-case bilinear error of the field
+  int pushIterations;
+
+  // Cell lookups (Level::worldToGrid / gridToWorld)
+  float halfWidth, halfDepth, cellSize, cellFilterRadius;
+};
+
+struct BallBatchLanes {
+  float *px, *py, *pz, *vx, *vz, *prevX, *prevY, *prevZ, *fall, *falling;
+  float *moveX, *moveZ;
+  uint32_t *sweepLanes;
+  size_t sweepCount;
+  uint32_t *cellLanes;
+  size_t cellCount;
+};
+
+// AVX2 entry points (BallBatchAVX2.cpp); only valid if ballBatchHasAVX2
+extern const bool ballBatchHasAVX2;
+void ballBatchIntegrateAVX2(const BallBatchStep &s, BallBatchLanes &l,
+                            size_t begin, size_t end);
+void ballBatchSettleAVX2(const BallBatchStep &s, BallBatchLanes &l,
+                         size_t begin, size_t end);
+
+namespace BallBatchKernel {
+namespace {
+
+template <class S> struct FieldSample {
+  typename S::F distance, gradX, gradZ;
+};
+
+// DistanceField::sample for W lanes
+template <class S>
+FieldSample<S> sampleField(const BallBatchStep &s, typename S::F x,
+                           typename S::F z, bool withGradient) {
+  using F = typename S::F;
+  const F zero = S::set1(0.0f), one = S::set1(1.0f);
+
+  F u = (x - S::set1(s.fieldOriginX)) / S::set1(s.fieldSpacing) -
+        S::set1(0.5f);
+  F v = (z - S::set1(s.fieldOriginZ)) / S::set1(s.fieldSpacing) -
+        S::set1(0.5f);
+  F x0 = S::min(S::max(S::floor(u), zero), S::set1(float(s.fieldX - 2)));
+  F z0 = S::min(S::max(S::floor(v), zero), S::set1(float(s.fieldZ - 2)));
+  F tx = S::min(S::max(u - x0, zero), one);
+  F tz = S::min(S::max(v - z0, zero), one);
+
+  int32_t ix[S::Width], iz[S::Width];
+  int32_t i00[S::Width], i10[S::Width], i01[S::Width], i11[S::Width];
+  S::storeInt(ix, x0);
+  S::storeInt(iz, z0);
+  const int32_t mask = (1 << s.fieldTileShift) - 1;
+  const int32_t rowStride = (mask + 2) * 3;
+  for (int k = 0; k < S::Width; ++k) {
+    int32_t tile = (iz[k] >> s.fieldTileShift) * s.fieldTilesX +
+                   (ix[k] >> s.fieldTileShift);
+    i00[k] = s.fieldTiles[tile] * 3 + (iz[k] & mask) * rowStride +
+             (ix[k] & mask) * 3;
+    i10[k] = i00[k] + 3;
+    i01[k] = i00[k] + rowStride;
+    i11[k] = i01[k] + 3;
+  }
+
+  F w00 = (one - tx) * (one - tz), w10 = tx * (one - tz);
+  F w01 = (one - tx) * tz, w11 = tx * tz;
+
+  FieldSample<S> out;
+  const float *d = s.field;
+  out.distance = S::gather(d, i00) * w00 + S::gather(d, i10) * w10 +
+                 S::gather(d, i01) * w01 + S::gather(d, i11) * w11;
+  if (!withGradient)
+    return out;
+
+  const float *gx = s.field + 1, *gz = s.field + 2;
+  F sumX = S::gather(gx, i00) * w00 + S::gather(gx, i10) * w10 +
+           S::gather(gx, i01) * w01 + S::gather(gx, i11) * w11;
+  F sumZ = S::gather(gz, i00) * w00 + S::gather(gz, i10) * w10 +
+           S::gather(gz, i01) * w01 + S::gather(gz, i11) * w11;
+  F len = S::sqrt(sumX * sumX + sumZ * sumZ);
+  typename S::M valid = S::gt(len, S::set1(0.0001f));
+  out.gradX = S::select(valid, sumX / len, zero);
+  out.gradZ = S::select(valid, sumZ / len, zero);
+  return out;
+}
+
+template <class S>
+void integrate(const BallBatchStep &s, BallBatchLanes &l, size_t begin,
+               size_t end) {
+  using F = typename S::F;
+  using M = typename S::M;
+  const F half = S::set1(0.5f), one = S::set1(1.0f), two = S::set1(2.0f);
+  const F dt = S::set1(s.dt), radius = S::set1(s.radius);
+  const F maxSpeed = S::set1(s.maxSpeed);
+
+  for (size_t i = begin; i < end; i += S::Width) {
+    F falling = S::load(l.falling + i);
+    M isFalling = S::gt(falling, half);
+    M active = S::lt(falling, half);
+
+    F px = S::load(l.px + i), py = S::load(l.py + i), pz = S::load(l.pz + i);
+    S::store(l.prevX + i, px);
+    S::store(l.prevY + i, py);
+    S::store(l.prevZ + i, pz);
+
+    // Falling lanes only advance the drop animation
+    F fall = S::load(l.fall + i);
+    F fallNext = fall + S::set1(s.fallDelta);
+    S::store(l.fall + i, S::select(isFalling, fallNext, fall));
+    py = S::select(isFalling, radius * (one - fallNext * two), py);
+    S::store(l.py + i, py);
+
+    F vx0 = S::load(l.vx + i), vz0 = S::load(l.vz + i);
+    F vx = vx0 + S::set1(s.ax * s.dt);
+    F vz = vz0 + S::set1(s.az * s.dt);
+    vx = vx * S::set1(s.friction);
+    vz = vz * S::set1(s.friction);
+    F speed = S::sqrt(vx * vx + vz * vz);
+    M over = S::gt(speed, maxSpeed);
+    vx = S::select(over, (vx / speed) * maxSpeed, vx);
+    vz = S::select(over, (vz / speed) * maxSpeed, vz);
+    S::store(l.vx + i, S::select(active, vx, vx0));
+    S::store(l.vz + i, S::select(active, vz, vz0));
+
+    F mx = vx * dt, mz = vz * dt;
+    S::store(l.moveX + i, mx);
+    S::store(l.moveZ + i, mz);
+
+    // A lane whose motion cannot reach any wall skips the sweep entirely
+    M needSweep = active;
+    if (s.field) {
+      F d = sampleField<S>(s, px, pz, false).distance;
+      F reach = S::sqrt(mx * mx + mz * mz) + radius;
+      M clear = S::gt(d - S::set1(s.sweepMargin), reach);
+      M move = active & clear;
+      needSweep = S::andNot(active, clear);
+      S::store(l.px + i, S::select(move, px + mx, px));
+      S::store(l.pz + i, S::select(move, pz + mz, pz));
+    }
+
+    int bits = S::bits(needSweep);
+    for (int k = 0; bits; ++k, bits >>= 1) {
+      if (bits & 1)
+        l.sweepLanes[l.sweepCount++] = static_cast<uint32_t>(i + k);
+    }
+  }
+}
+
+template <class S>
+void settle(const BallBatchStep &s, BallBatchLanes &l, size_t begin,
+            size_t end) {
+  using F = typename S::F;
+  using M = typename S::M;
+  const F zero = S::set1(0.0f), half = S::set1(0.5f);
+  const F radius = S::set1(s.radius), bounce = S::set1(s.bounce);
+  const F eps = S::set1(0.001f), negEps = S::set1(-0.001f);
+
+  for (size_t i = begin; i < end; i += S::Width) {
+    M active = S::lt(S::load(l.falling + i), half);
+    if (!S::bits(active))
+      continue;
+
+    // Level::resolveWallCollision (distance field path)
+    F oldX = S::load(l.px + i), oldZ = S::load(l.pz + i);
+    F px = oldX, pz = oldZ;
+    M live = active;
+    for (int it = 0; it < s.pushIterations; ++it) {
+      FieldSample<S> fs = sampleField<S>(s, px, pz, true);
+      live = live & S::lt(fs.distance, radius);
+      if (!S::bits(live))
+        break;
+      F overlap = radius - fs.distance;
+      px = S::select(live, px + fs.gradX * overlap, px);
+      pz = S::select(live, pz + fs.gradZ * overlap, pz);
+    }
+    S::store(l.px + i, px);
+    S::store(l.pz + i, pz);
+
+    F vx = S::load(l.vx + i), vz = S::load(l.vz + i);
+    F pushX = px - oldX, pushZ = pz - oldZ;
+    M bounceX = (S::gt(pushX, eps) & S::lt(vx, zero)) |
+                (S::lt(pushX, negEps) & S::gt(vx, zero));
+    M bounceZ = (S::gt(pushZ, eps) & S::lt(vz, zero)) |
+                (S::lt(pushZ, negEps) & S::gt(vz, zero));
+    S::store(l.vx + i, S::select(bounceX, (zero - vx) * bounce, vx));
+    S::store(l.vz + i, S::select(bounceZ, (zero - vz) * bounce, vz));
+    S::store(l.py + i, S::select(active, radius, S::load(l.py + i)));
+
+    // Only lanes near a cell centre (or off the board) can be over a hole
+    // or at the goal
+    F cell = S::set1(s.cellSize);
+    F localX = px + S::set1(s.halfWidth), localZ = pz + S::set1(s.halfDepth);
+    F cx = S::floor(localX / cell), cz = S::floor(localZ / cell);
+    F dx = px - ((cx + half) * cell - S::set1(s.halfWidth));
+    F dz = pz - ((cz + half) * cell - S::set1(s.halfDepth));
+    F dist = S::sqrt(dx * dx + dz * dz);
+    M near = S::lt(dist, S::set1(s.cellFilterRadius)) |
+             S::lt(localX, zero) | S::lt(localZ, zero);
+    int bits = S::bits(active & near);
+    for (int k = 0; bits; ++k, bits >>= 1) {
+      if (bits & 1)
+        l.cellLanes[l.cellCount++] = static_cast<uint32_t>(i + k);
+    }
+  }
+}
+
+} // namespace
+} // namespace BallBatchKernel
+
+#endif // BALL_BATCH_KERNEL_H
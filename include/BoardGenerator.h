@@ -1,21 +1,90 @@
 #ifndef BOARD_GENERATOR_H
 #define BOARD_GENERATOR_H
 
+#include "InstanceBuffer.h"
 #include "Level.h"
 #include "Mesh.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class ThreadPool;
 
 namespace BoardGenerator {
 
-struct BoardMeshes {
+// One square piece of the board's floor and walls, drawn or culled whole
+struct BoardChunk {
   Mesh floor;
   Mesh walls;
+  // Bounds in board model space
+  glm::vec3 min = glm::vec3(0.0f), max = glm::vec3(0.0f);
+};
+
+struct BoardMeshes {
+  // Config::BOARD_CHUNK_CELLS cells square, row-major
+  std::vector<BoardChunk> chunks;
+  int chunksX = 0, chunksY = 0;
   Mesh frame;
-  Mesh holeMarker; // Single cylinder, rendered per hole position
-  Mesh startMarker;
-  Mesh goalMarker;
+  // Instances of the shared marker mesh: start, goal, then one per hole
+  // in the order of Level::holePoss
+  std::vector<glm::vec4> markerPlacements;
+  std::vector<InstanceBuffer::Material> markerMaterials;
+
+  void cleanup();
+};
+
+// Vertices and indices of one mesh, before upload
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<unsigned int> indices;
 };
 
-BoardMeshes generateBoard(const Level &level);
+// Working memory for meshCells. Kept between calls (one per thread), it
+// only grows when a region needs more faces than any before it.
+struct MeshScratch {
+  // Rectangle of coplanar faces, in cells
+  struct Face {
+    glm::ivec2 cell;
+    glm::ivec2 size; // Sides are size.x cells long and one high
+    int8_t side;     // -1 for a top, else the direction (+x, -x, +z, -z)
+    bool wall;       // Goes in the wall mesh rather than the floor's
+  };
+  std::vector<uint8_t> wallMap, mask;
+  std::vector<Face> faces;
+};
+
+// Chunks are meshed in parallel on `pool`; the GL uploads happen on the
+// calling thread, which must own the context
+BoardMeshes generateBoard(const Level &level, ThreadPool &pool);
+
+// Re-mesh chunk (cx, cy) after its cells or their neighbours changed,
+// rewriting its buffers in place. `floor`, `walls` and `scratch` are
+// scratch space, kept between calls so steady editing doesn't allocate.
+void rebuildChunk(const Level &level, int cx, int cy, BoardChunk &chunk,
+                  MeshData &floor, MeshData &walls, MeshScratch &scratch);
+
+// Index in BoardMeshes::markerPlacements
+constexpr size_t START_MARKER = 0;
+constexpr size_t GOAL_MARKER = 1;
+constexpr size_t FIRST_HOLE_MARKER = 2;
+
+// Marker instance for a start, goal or hole cell
+glm::vec4 markerPlacement(const Level &level, glm::ivec2 cell, CellType type);
+InstanceBuffer::Material markerMaterial(CellType type);
+
+// Floor and wall surfaces of the cells in [min, max), greedy-meshed. Faces
+// that can never be seen (between neighbouring walls, under walls and
+// under the floor) are dropped, and the rest are merged into maximal
+// rectangles per plane. UVs are in cells, so the textures repeat once per
+// cell however large a rectangle is. Appends to `floor` and `walls`,
+// growing each once by exactly the faces found.
+void meshCells(const Level &level, glm::ivec2 min, glm::ivec2 max,
+               MeshData &floor, MeshData &walls, MeshScratch &scratch);
+
+// Flat cylinder of unit radius shared by every marker; instances scale it
+// to their radius
+Mesh createMarkerMesh();
+
 Mesh createHoleMesh(float radius, float depth, int segments = 24);
 Mesh createFrameMesh(float width, float depth, float height, float thickness);
 
@@ -1,6 +1,7 @@
 #ifndef CAMERA_H
 #define CAMERA_H
 
+#include "Frustum.h"
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -38,6 +39,10 @@ public:
   // Get the projection matrix
   glm::mat4 getProjectionMatrix(float aspectRatio) const;
 
+  // View frustum, with its planes in the space `model` maps to world
+  Frustum getFrustum(float aspectRatio,
+                     const glm::mat4 &model = glm::mat4(1.0f)) const;
+
   // Get camera position in world space
   glm::vec3 getPosition() const;
 
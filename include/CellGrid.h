@@ -0,0 +1,159 @@
+#ifndef CELL_GRID_H
+#define CELL_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+// What occupies one cell of a level
+enum class CellType : uint8_t { Floor, Wall, Hole, Start, Goal };
+constexpr int CELL_TYPE_COUNT = 5;
+
+// Bit masks over cell types, for queries that accept several
+constexpr uint32_t cellBit(CellType type) { return 1u << int(type); }
+
+/**
+ * CellGrid - Chunked, sparse storage for a level's cells.
+ *
+ * The board is split into CHUNK_SIZE x CHUNK_SIZE chunks of one byte per
+ * cell. A chunk whose cells are all the same type owns no memory: its slot
+ * in the chunk table points at a shared, read-only block of that type. The
+ * chunk gets its own block the first time a cell in it is changed (copy on
+ * write), and compact() shares any chunk that has become uniform again.
+ * Lookups are the same two loads whether a chunk is shared or not.
+ *
+ * The table has an extra ring of wall chunks around the board, and cells of
+ * the last row and column of chunks that lie past the board edge are walls.
+ * That means at() may read up to CHUNK_SIZE cells outside the board without
+ * bounds checks, so 3x3 neighbourhood queries never need them. get()
+ * accepts any coordinates, and everything off the board reads as wall.
+ *
+ * Each chunk keeps a count of each cell type, and the bulk queries use
+ * these counts to skip or accept whole chunks at once.
+ */
+class CellGrid {
+public:
+  static constexpr int CHUNK_SHIFT = 5;
+  static constexpr int CHUNK_SIZE = 1 << CHUNK_SHIFT;
+  static constexpr int CHUNK_CELLS = CHUNK_SIZE * CHUNK_SIZE;
+
+  // Cell counts of one chunk, including off-board padding (walls)
+  struct ChunkSummary {
+    uint16_t counts[CELL_TYPE_COUNT] = {};
+
+    int count(CellType type) const { return counts[int(type)]; }
+    bool isUniform(CellType type) const {
+      return counts[int(type)] == CHUNK_CELLS;
+    }
+    bool containsAny(uint32_t mask) const {
+      for (int t = 0; t < CELL_TYPE_COUNT; ++t) {
+        if ((mask & (1u << t)) && counts[t])
+          return true;
+      }
+      return false;
+    }
+  };
+
+  CellGrid() = default;
+  CellGrid(int width, int height, CellType fill = CellType::Floor);
+
+  CellGrid(const CellGrid &other);
+  CellGrid &operator=(const CellGrid &other);
+  CellGrid(CellGrid &&) noexcept = default;
+  CellGrid &operator=(CellGrid &&) noexcept = default;
+
+  // Text rows as used by level files ('#', '.', 'O', 'S', 'G'). Short rows
+  // are padded with walls.
+  static CellGrid fromText(const std::vector<std::string> &rows);
+  std::vector<std::string> toText() const;
+
+  static CellType fromChar(char c);
+  static char toChar(CellType type);
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+
+  // Unchecked; valid up to CHUNK_SIZE cells outside the board
+  CellType at(int x, int y) const {
+    return table[tableIndex(x >> CHUNK_SHIFT, y >> CHUNK_SHIFT)]
+                [((y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) |
+                 (x & (CHUNK_SIZE - 1))];
+  }
+
+  // Checked; anything outside the board is a wall
+  CellType get(int x, int y) const {
+    if (static_cast<unsigned>(x) >= static_cast<unsigned>(width) ||
+        static_cast<unsigned>(y) >= static_cast<unsigned>(height))
+      return CellType::Wall;
+    return at(x, y);
+  }
+  bool isWall(int x, int y) const { return get(x, y) == CellType::Wall; }
+
+  void set(int x, int y, CellType type);
+
+  // --- Chunks ---
+  int getChunksX() const { return chunksX; }
+  int getChunksY() const { return chunksY; }
+  // CHUNK_SIZE x CHUNK_SIZE cells, row-major, starting at board cell
+  // (cx * CHUNK_SIZE, cy * CHUNK_SIZE)
+  const CellType *chunkData(int cx, int cy) const {
+    return table[tableIndex(cx, cy)];
+  }
+  const ChunkSummary &chunkSummary(int cx, int cy) const {
+    return summaries[static_cast<size_t>(cy) * chunksX + cx];
+  }
+  // Replace the on-board cells of chunk (cx, cy) with `cells` (laid out
+  // like chunkData; padding entries are not read). Calls for different
+  // chunks may run on different threads at once.
+  void setChunk(int cx, int cy, const CellType *cells);
+  // Share the blocks of chunks that have become uniform
+  void compact();
+  size_t getAllocatedChunks() const;
+
+  // --- Bulk queries ---
+  size_t count(CellType type) const;
+  // Cells of this type in [min, max] (inclusive, clipped to the board)
+  size_t countInRect(glm::ivec2 min, glm::ivec2 max, CellType type) const;
+  bool anyInRect(glm::ivec2 min, glm::ivec2 max, CellType type) const {
+    return countInRect(min, max, type) > 0;
+  }
+  // Appends the coordinates of every cell of this type, chunk by chunk
+  void collect(CellType type, std::vector<glm::ivec2> &out) const;
+  // Bit (dy + 1) * 3 + (dx + 1) is set when cell (x+dx, y+dy) has this type.
+  // (x, y) must be on the board.
+  uint32_t neighbourMask(int x, int y, CellType type) const;
+  void fillRect(glm::ivec2 min, glm::ivec2 max, CellType type);
+
+private:
+  struct Block {
+    CellType cells[CHUNK_CELLS];
+  };
+
+  int width = 0;
+  int height = 0;
+  int chunksX = 0, chunksY = 0;
+  int tableStride = 0; // chunksX + 2 (one ring of border chunks)
+
+  // Chunk table including the border ring; entries point either into
+  // `blocks` or at a shared uniform block
+  std::vector<const CellType *> table;
+  std::vector<std::unique_ptr<Block>> blocks; // Per board chunk, or null
+  std::vector<ChunkSummary> summaries;        // Per board chunk
+
+  size_t tableIndex(int cx, int cy) const {
+    return static_cast<size_t>(cy + 1) * tableStride + (cx + 1);
+  }
+  size_t chunkIndex(int cx, int cy) const {
+    return static_cast<size_t>(cy) * chunksX + cx;
+  }
+  static const CellType *uniformBlock(CellType type);
+  // Cells of chunk (cx, cy) that lie on the board
+  glm::ivec2 chunkExtent(int cx, int cy) const;
+  CellType *makeWritable(int cx, int cy);
+  void shareChunk(int cx, int cy, CellType type);
+};
+
+#endif // CELL_GRID_H
@@ -8,6 +8,8 @@
  * Modify these values to change the game feel.
  */
 
+#include <cstddef>
+
 namespace Config {
 
 // ============================================================================
@@ -30,6 +32,114 @@ constexpr float BALL_MAX_SPEED = 50.0f; // Increase for faster rolling
 // bounce)
 constexpr float BALL_BOUNCE = 0.3f;
 
+// BALL_FRICTION is the damping applied per 1/60 s; it is rescaled to the
+// physics tick so the feel does not depend on PHYSICS_TICK_RATE
+constexpr float BALL_FRICTION_REFERENCE_RATE = 60.0f;
+
+// Wall contacts resolved per step by the swept (continuous) collision
+constexpr int BALL_MAX_SWEEP_CONTACTS = 4;
+
+// Gap left between the ball and a wall after a swept contact (world units)
+constexpr float BALL_CONTACT_SKIN = 0.0005f;
+
+// ============================================================================
+// PHYSICS TIMESTEP
+// ============================================================================
+
+// Fixed simulation rate in ticks per second (independent of frame rate)
+constexpr float PHYSICS_TICK_RATE = 240.0f;
+
+// Maximum ticks simulated per rendered frame; beyond this the game slows
+// down instead of stalling (16 ticks @ 240 Hz = ~66 ms of frame time)
+constexpr int PHYSICS_MAX_STEPS_PER_FRAME = 16;
+
+// Run the simulation on its own thread; when false it is stepped from the
+// render loop each frame (same results, easier to debug)
+constexpr bool PHYSICS_ON_THREAD = true;
+
+// ============================================================================
+// MULTI-MARBLE MODE
+// ============================================================================
+
+// Marbles spawned when multi-marble mode is switched on (M key)
+constexpr int MARBLE_COUNT = 500;
+
+// Bounce between marbles (0.0 = dead stop, 1.0 = perfectly elastic)
+constexpr float MARBLE_RESTITUTION = 0.5f;
+
+// Closing speed below which marbles stop bouncing off each other
+constexpr float MARBLE_RESTITUTION_THRESHOLD = 0.5f;
+
+// Sequential impulse passes over all contacts per physics tick
+constexpr int MARBLE_SOLVER_ITERATIONS = 4;
+
+// Fraction of marble overlap corrected per tick, and overlap tolerated
+constexpr float MARBLE_BAUMGARTE = 0.2f;
+constexpr float MARBLE_SLOP = 0.005f;
+
+// ============================================================================
+// REWIND
+// ============================================================================
+
+// Memory for the ball history (about 20 bytes per tick while rolling, so
+// 512 KB holds well over a minute at 240 Hz)
+constexpr size_t REWIND_ARENA_BYTES = 512 * 1024;
+
+// A full keyframe every this many ticks; the rest are deltas
+constexpr int REWIND_KEYFRAME_INTERVAL = 64;
+
+// Rewind speed while the key is held, relative to real time
+constexpr float REWIND_SPEED = 2.0f;
+
+// ============================================================================
+// REPLAYS
+// ============================================================================
+
+// Save a replay of every finished run (check them with MarbleTool verify)
+constexpr bool RECORD_REPLAYS = true;
+constexpr const char *REPLAY_DIRECTORY = "replays";
+// Longest run a replay may hold. Longer runs are not saved, and files that
+// claim more are rejected as corrupt
+constexpr int REPLAY_MAX_MINUTES = 120;
+
+// ============================================================================
+// AUTOPLAYER (MarbleTool play)
+// ============================================================================
+
+// Attempts per level; the solve rate is measured over these
+constexpr int AUTOPLAY_ATTEMPTS = 32;
+
+// Candidate tilts tried (one rollout each) per decision
+constexpr int AUTOPLAY_CANDIDATES = 12;
+
+// Time between decisions, and how far ahead each rollout looks
+constexpr float AUTOPLAY_DECISION_SECONDS = 0.1f;
+constexpr float AUTOPLAY_HORIZON_SECONDS = 0.6f;
+
+// An attempt that hasn't finished by now counts as timed out
+constexpr float AUTOPLAY_TIME_LIMIT_SECONDS = 60.0f;
+
+// Random error added to every played tilt, as a fraction of the maximum
+// tilt (0 = perfect hands)
+constexpr float AUTOPLAY_TILT_ERROR = 0.25f;
+
+// Steering policy the rollouts fall back on: target speed along the flow
+// (cells per second) and how hard to correct towards it and the cell middle
+constexpr float AUTOPLAY_STEER_SPEED = 3.0f;
+constexpr float AUTOPLAY_STEER_GAIN = 4.0f;
+constexpr float AUTOPLAY_CENTRE_GAIN = 20.0f;
+
+// ============================================================================
+// MAZE GENERATOR (MarbleTool maze)
+// ============================================================================
+
+// Chance that a floor cell off the start-to-goal route becomes a hole
+constexpr float MAZE_HOLE_DENSITY = 0.05f;
+
+// Maze cells along the side of a tile; each tile is carved by one thread
+// (rounded up to a multiple of 16 so tiles line up with CellGrid chunks)
+constexpr int MAZE_TILE_CELLS = 128;
+
 // ============================================================================
 // BOARD TILT
 // ============================================================================
@@ -82,6 +192,23 @@ constexpr float HOLE_DETECTION_RATIO = 0.3f;
 // Goal detection radius relative to cell size
 constexpr float GOAL_DETECTION_RATIO = 0.4f;
 
+// Wall distance field resolution baked per level (samples per cell edge).
+// 0 falls back to scanning the neighbouring cells on every query
+constexpr int SDF_SAMPLES_PER_CELL = 8;
+
+// Memory cap for the baked distance field. Huge maps lower the resolution
+// to fit, or skip the field entirely
+constexpr int SDF_MAX_MEGABYTES = 256;
+
+// Maximum push-out steps per collision query. Open floor exits after one
+// lookup; inside corners need a couple more to settle
+constexpr int SDF_PUSH_ITERATIONS = 3;
+
+// Boards with at least this many cells (about the size of a last-level
+// cache) have batched casts walk their rays grouped by start chunk. Smaller
+// boards stay cached anyway, so the rays are taken as given
+constexpr int RAYCAST_GROUP_MIN_CELLS = 32 * 1024 * 1024;
+
 // ============================================================================
 // RENDERING
 // ============================================================================
@@ -105,6 +232,36 @@ constexpr float BALL_ROUGHNESS = 0.1f; // Lower = shinier
 constexpr float WOOD_METALLIC = 0.0f;
 constexpr float WOOD_ROUGHNESS = 0.65f;
 
+// Board meshes are split into square chunks of this many cells, and each
+// chunk is culled against the view frustum on its own. Smaller chunks cull
+// tighter but cost more draw calls when the whole board is in view
+constexpr int BOARD_CHUNK_CELLS = 64;
+
+// Frames of uniform blocks kept in flight. The CPU fills one region of the
+// ring while the GPU may still be drawing from the others
+constexpr int UNIFORM_RING_FRAMES = 3;
+
+// Linked shader programs are saved here as driver binaries, so later
+// launches skip compiling them. An empty path turns the cache off
+constexpr const char *SHADER_CACHE_DIRECTORY = "shader_cache";
+
+// ============================================================================
+// HINTS
+// ============================================================================
+
+// Show the arrows pointing the way to the goal (toggle with H)
+constexpr bool SHOW_HINTS = false;
+
+// Arrow length relative to cell size, and height above the floor
+constexpr float HINT_ARROW_SIZE = 0.6f;
+constexpr float HINT_HEIGHT = 0.03f;
+
+// Arrow colour and opacity
+constexpr float HINT_COLOR_R = 0.3f;
+constexpr float HINT_COLOR_G = 0.9f;
+constexpr float HINT_COLOR_B = 1.0f;
+constexpr float HINT_ALPHA = 0.55f;
+
 } // namespace Config
 
 #endif // CONFIG_H
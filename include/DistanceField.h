@@ -0,0 +1,93 @@
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Level;
+
+/**
+ * DistanceField - Baked signed distance to the walls of a Level.
+ *
+ * The board (plus a one-cell border, which counts as wall) is sampled at
+ * samplesPerCell x samplesPerCell points per cell. Each sample stores the
+ * signed distance to the nearest wall edge (negative inside walls) and the
+ * outward unit gradient. Queries are a single bilinear lookup, so wall
+ * collision costs the same no matter how dense the maze is.
+ *
+ * Distances are only exact up to one cell away from a wall and are clamped
+ * beyond that, which is plenty for anything smaller than a cell.
+ *
+ * Samples are stored in square tiles, one per CellGrid chunk, each with a
+ * one-sample apron on its far edges so that a bilinear lookup never crosses
+ * a tile. Only tiles with both wall and open cells nearby are baked. Every
+ * other tile holds a constant and points at one of two shared tiles, so
+ * big open or solid regions cost nothing. If the baked tiles would exceed
+ * Config::SDF_MAX_MEGABYTES, the resolution is halved until they fit, and
+ * below two samples per cell the field is left unbaked. After cells are
+ * edited, update() re-bakes just the samples around them.
+ */
+class DistanceField {
+public:
+  struct Sample {
+    float distance;
+    glm::vec2 gradient; // Points away from the nearest wall
+  };
+
+  DistanceField() = default;
+
+  // samplesPerCell is rounded down to a power of two
+  void bake(const Level &level, int samplesPerCell);
+  // Re-bake after the cells in [minCell, maxCell] (inclusive) changed. Only
+  // the samples that can see those cells are recomputed. Tiles that become
+  // mixed are baked, and tiles that become uniform go back to the shared
+  // ones. Tiles baked here are not held to Config::SDF_MAX_MEGABYTES.
+  void update(const Level &level, glm::ivec2 minCell, glm::ivec2 maxCell);
+  bool isBaked() const { return !samples.empty(); }
+
+  // Bilinearly interpolated signed distance and (normalized) gradient at a
+  // world-space XZ position
+  Sample sample(glm::vec2 worldXZ) const;
+
+  int getSamplesPerCell() const { return samplesPerCell; }
+  float getMaxDistance() const { return maxDistance; }
+  size_t getBakedTiles() const { return bakedTiles; }
+  size_t getMemoryBytes() const { return samples.size() * sizeof(Sample); }
+
+  // Raw tiles, for batched lookups that reproduce sample() exactly. Sample
+  // (x, z) is in tile (x >> tileShift, z >> tileShift), which starts at
+  // data()[getTileOffsets()[tz * getTilesX() + tx]] and has rows of
+  // getTileStride() samples.
+  const Sample *data() const { return samples.data(); }
+  const int32_t *getTileOffsets() const { return tileOffsets.data(); }
+  int getTilesX() const { return tilesX; }
+  int getTileShift() const { return tileShift; }
+  int getTileStride() const { return (1 << tileShift) + 1; }
+  int getSamplesX() const { return samplesX; }
+  int getSamplesZ() const { return samplesZ; }
+  float getSpacing() const { return spacing; }
+  glm::vec2 getOrigin() const { return origin; }
+
+private:
+  std::vector<Sample> samples;       // Tiles, the two shared ones first
+  std::vector<int32_t> tileOffsets;  // Per tile, index of its first sample
+  std::vector<int32_t> freeTiles;    // Unused baked tiles, after update()
+  int tilesX = 0, tilesZ = 0;
+  int tileShift = 0; // log2 of samples per tile edge (without apron)
+  size_t bakedTiles = 0;
+  int samplesPerCell = 0;
+  int samplesX = 0, samplesZ = 0;
+  float spacing = 0.0f;
+  float maxDistance = 0.0f;
+  glm::vec2 origin = glm::vec2(0.0f); // World XZ of the sample grid corner
+
+  const Sample &at(int x, int z) const {
+    int t = tileOffsets[(z >> tileShift) * tilesX + (x >> tileShift)];
+    int mask = (1 << tileShift) - 1;
+    return samples[t + (z & mask) * getTileStride() + (x & mask)];
+  }
+};
+
+#endif // DISTANCE_FIELD_H
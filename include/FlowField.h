@@ -0,0 +1,90 @@
+#ifndef FLOW_FIELD_H
+#define FLOW_FIELD_H
+
+#include "CellGrid.h"
+#include <climits>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * FlowField - Which way to roll from every cell to reach the goal.
+ *
+ * build() runs one breadth-first search out from the goal over walkable
+ * cells (floor, start, goal; holes and walls block) and stores each cell's
+ * distance in moves. A cell's direction is the set of neighbours one step
+ * closer, kept as a 4-bit mask (DIR_POS_X ...) so the renderer can upload
+ * the masks as a one-byte-per-cell texture and decode them on the GPU.
+ *
+ * When cells change, update() repairs the field in the style of D* Lite
+ * instead of searching again: cells that lost their only route are raised
+ * to unreachable in order of their old distance, then they and any newly
+ * opened cells are lowered again from their valid neighbours. Only cells
+ * whose distance changes, and their neighbours, are visited. The result is
+ * the same as a fresh build(). The rectangle of masks that changed is kept
+ * so the texture can be patched rather than re-uploaded.
+ */
+class FlowField {
+public:
+  static constexpr uint32_t UNREACHABLE = UINT32_MAX;
+
+  // Direction mask bits; grid +y is world +Z
+  static constexpr uint8_t DIR_POS_X = 1;
+  static constexpr uint8_t DIR_NEG_X = 2;
+  static constexpr uint8_t DIR_POS_Y = 4;
+  static constexpr uint8_t DIR_NEG_Y = 8;
+
+  void build(const CellGrid &cells, glm::ivec2 goal);
+  // `changed` lists cells whose type has already been changed in `cells`.
+  // Moving the goal needs a build() instead.
+  void update(const CellGrid &cells, const std::vector<glm::ivec2> &changed);
+
+  int getWidth() const { return width; }
+  int getHeight() const { return height; }
+  glm::ivec2 getGoal() const { return goal; }
+
+  // Moves to the goal, UNREACHABLE for blocked and cut-off cells
+  uint32_t getDistance(int x, int y) const {
+    return inside(x, y) ? distance[index(x, y)] : UNREACHABLE;
+  }
+  // Direction mask of a cell, 0 at the goal and where there is no route
+  uint8_t getMask(int x, int y) const {
+    return inside(x, y) ? masks[index(x, y)] : 0;
+  }
+  // Unit step towards the goal in grid space (0 where there is none)
+  glm::vec2 getDirection(int x, int y) const;
+  // Masks of every cell, row-major
+  const uint8_t *getMasks() const { return masks.data(); }
+
+  // Cells whose mask changed since the last clearDirty() (build marks the
+  // whole board)
+  bool isDirty() const { return dirtyMin.x <= dirtyMax.x; }
+  glm::ivec2 getDirtyMin() const { return dirtyMin; }
+  glm::ivec2 getDirtyMax() const { return dirtyMax; }
+  void clearDirty();
+
+private:
+  int width = 0, height = 0;
+  glm::ivec2 goal = glm::ivec2(0);
+  std::vector<uint32_t> distance;
+  std::vector<uint8_t> masks;
+  std::vector<uint8_t> walkable;
+  glm::ivec2 dirtyMin = glm::ivec2(INT_MAX), dirtyMax = glm::ivec2(-1);
+
+  // Scratch for update()
+  std::vector<int> raised, touched;
+
+  bool inside(int x, int y) const {
+    return static_cast<unsigned>(x) < static_cast<unsigned>(width) &&
+           static_cast<unsigned>(y) < static_cast<unsigned>(height);
+  }
+  size_t index(int x, int y) const {
+    return static_cast<size_t>(y) * width + x;
+  }
+  // Walkable 4-neighbours of cell i, as indices; returns how many
+  int neighbours(int i, int out[4]) const;
+  bool hasSupport(int i) const;
+  void refreshMask(int i);
+};
+
+#endif // FLOW_FIELD_H
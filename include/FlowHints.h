@@ -0,0 +1,46 @@
+#ifndef FLOW_HINTS_H
+#define FLOW_HINTS_H
+
+#include "FlowField.h"
+#include "Mesh.h"
+#include "Shader.h"
+#include <glm/glm.hpp>
+
+/**
+ * FlowHints - Draws a FlowField as arrows on the board (H key).
+ *
+ * The field's direction masks are kept in a one-byte-per-cell integer
+ * texture, and one instanced draw issues an arrow for every cell: the
+ * vertex shader (hint.vert) finds its cell from gl_InstanceID, reads the
+ * mask and turns the arrow towards the goal. Per frame that is a few
+ * uniforms (only the changed ones are sent) and the draw call. The
+ * texture is only written by sync(), and then only the rectangle of cells
+ * that changed.
+ */
+class FlowHints {
+public:
+  bool init();
+
+  // Bring the texture up to date with the field and clear its dirty rect
+  void sync(FlowField &field);
+
+  void draw(const glm::mat4 &boardModel, const glm::mat4 &view,
+            const glm::mat4 &projection, float cellSize) const;
+
+  void cleanup();
+
+private:
+  Shader shader;
+  struct {
+    Shader::Uniform<glm::mat4> model, view, projection;
+    Shader::Uniform<int> flowMap;
+    Shader::Uniform<glm::ivec2> boardCells;
+    Shader::Uniform<float> cellSize, arrowHeight;
+    Shader::Uniform<glm::vec4> color;
+  } uniforms; // Resolved once in init()
+  Mesh arrow;
+  unsigned int texture = 0;
+  int width = 0, height = 0;
+};
+
+#endif // FLOW_HINTS_H
@@ -0,0 +1,29 @@
+#ifndef FRUSTUM_H
+#define FRUSTUM_H
+
+#include <glm/glm.hpp>
+
+/**
+ * Frustum - The six clip planes of a view, for culling on the CPU.
+ *
+ * The planes are read straight off a clip matrix (Gribb and Hartmann): a
+ * point p is inside when -w <= x, y, z <= w for clip = M * p, and each of
+ * those six inequalities is a plane in the space M maps from. Built from
+ * projection * view * model, the planes are in that model's space, so
+ * boxes can be tested there without transforming them.
+ */
+class Frustum {
+public:
+  Frustum() = default;
+  explicit Frustum(const glm::mat4 &clip);
+
+  // False only if the box is certainly outside. Boxes near a corner of the
+  // frustum can pass without touching it, which is fine for culling.
+  bool intersects(const glm::vec3 &min, const glm::vec3 &max) const;
+
+private:
+  // Inside is dot(plane.xyz, p) + plane.w >= 0
+  glm::vec4 planes[6] = {};
+};
+
+#endif // FRUSTUM_H
@@ -0,0 +1,57 @@
+#ifndef INSTANCE_BUFFER_H
+#define INSTANCE_BUFFER_H
+
+#include "Mesh.h"
+#include <cstdint>
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * InstanceBuffer - Per-instance vertex data for instanced draws.
+ *
+ * Holds a VBO of per-instance placements (model-space offset and uniform
+ * scale) that is attached to a Mesh's VAO as vertex attribute 5 with a
+ * divisor of 1, so Mesh::drawInstanced can draw one placed copy of the mesh
+ * per entry. Draws whose copies also differ in surface can attach a second
+ * VBO of materials (attributes 6 and 7) and set useInstanceMaterial in the
+ * shader. Both buffers grow as needed and are otherwise updated in place.
+ */
+class InstanceBuffer {
+public:
+  static constexpr unsigned int PLACEMENT_LOCATION = 5;
+  static constexpr unsigned int MATERIAL_LOCATION = 6; // And 7 (roughness)
+
+  struct Material {
+    glm::vec3 albedo = glm::vec3(1.0f);
+    float metallic = 0.0f;
+    float roughness = 0.5f;
+  };
+
+  InstanceBuffer()
+      : VBO(0), materialVBO(0), capacity(0), materialCapacity(0), count(0) {}
+
+  // Bind this buffer's placements, and its materials if `withMaterials`, to
+  // the mesh's VAO
+  void attach(const Mesh &mesh, bool withMaterials = false);
+
+  // xyz = offset in model space, w = uniform scale. The count becomes the
+  // vector's size, but only entries [first, last) are written (all of them
+  // if the buffer has to grow), for when the rest are already uploaded.
+  void upload(const std::vector<glm::vec4> &placements, size_t first = 0,
+              size_t last = SIZE_MAX);
+  // One per placement, in the same order
+  void uploadMaterials(const std::vector<Material> &materials,
+                       size_t first = 0, size_t last = SIZE_MAX);
+  size_t getCount() const { return count; }
+
+  void cleanup();
+
+private:
+  unsigned int VBO, materialVBO;
+  size_t capacity, materialCapacity, count;
+
+  void ensureBuffers();
+};
+
+#endif // INSTANCE_BUFFER_H
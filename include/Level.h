@@ -1,6 +1,9 @@
 #ifndef LEVEL_H
 #define LEVEL_H
 
+#include "CellGrid.h"
+#include "Config.h"
+#include "DistanceField.h"
 #include <glm/glm.hpp>
 #include <string>
 #include <vector>
@@ -10,7 +13,30 @@
  */
 class Level {
 public:
-  std::vector<std::string> grid;
+  // Result of sweeping a circle through the grid (see sweepCircle)
+  struct SweepHit {
+    bool hit = false;
+    float time = 1.0f;                  // Fraction of the motion, 0..1
+    glm::vec3 normal = glm::vec3(0.0f); // Wall normal at contact (XZ)
+    glm::vec3 point = glm::vec3(0.0f);  // Contact point on the wall
+  };
+
+  // Input and result of the ray / sphere queries. All of them work in the
+  // XZ plane: cells are treated as infinitely tall columns.
+  struct Ray {
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 direction = glm::vec3(1.0f, 0.0f, 0.0f); // Unit length
+    float maxDistance = 0.0f;
+  };
+  struct RayHit {
+    bool hit = false;
+    float distance = 0.0f;              // Along the ray, 0 if it starts inside
+    glm::ivec2 cell = glm::ivec2(0);    // Cell that was hit
+    glm::vec3 point = glm::vec3(0.0f);  // Ray (or sphere centre) at the hit
+    glm::vec3 normal = glm::vec3(0.0f); // Face normal (XZ), 0 if inside
+  };
+
+  CellGrid cells;
   int width = 0;
   int height = 0;
   float cellSize = 1.0f;
@@ -19,9 +45,20 @@ public:
   glm::ivec2 goalPos = {0, 0};
   std::vector<glm::ivec2> holePoss; // All hole positions
 
+  // Baked wall distances used by resolveWallCollision (0 samples = disabled)
+  DistanceField distanceField;
+
   Level() = default;
-  Level(const std::vector<std::string> &gridData, float cellSize = 1.0f);
+  Level(const std::vector<std::string> &gridData, float cellSize = 1.0f,
+        int sdfSamplesPerCell = Config::SDF_SAMPLES_PER_CELL);
+  // From cells built in code (e.g. by MazeGenerator)
+  explicit Level(CellGrid grid, float cellSize = 1.0f,
+                 int sdfSamplesPerCell = Config::SDF_SAMPLES_PER_CELL);
 
+  // Cell contents; anything off the board is a wall
+  CellType getCellType(int x, int y) const { return cells.get(x, y); }
+  bool isWall(int x, int y) const { return cells.isWall(x, y); }
+  // Same as getCellType, as the level-file character
   char getCell(int x, int y) const;
   glm::vec3 gridToWorld(int x, int y) const;
   glm::vec3 gridToWorld(glm::ivec2 pos) const;
@@ -30,8 +67,50 @@ public:
   bool isAtGoal(glm::vec3 worldPos, float radius) const;
   glm::vec3 resolveWallCollision(glm::vec3 pos, float radius) const;
 
+  // Continuous collision: first wall touched by a circle moving from `from`
+  // by `delta` (XZ only). Starting overlaps are ignored and left to
+  // resolveWallCollision.
+  SweepHit sweepCircle(glm::vec3 from, glm::vec3 delta, float radius) const;
+
+  // --- Spatial queries ---
+  // First cell whose type is in `mask` along the ray (Amanatides-Woo
+  // traversal; chunks with no such cell are crossed in one step). Off the
+  // board counts as wall.
+  RayHit raycast(const Ray &ray,
+                 uint32_t mask = cellBit(CellType::Wall)) const;
+  // First wall touched by a sphere of `radius` moving along the ray. A
+  // sphere that already overlaps a wall hits at distance 0.
+  RayHit sphereCast(const Ray &ray, float radius) const;
+  // Cells of a type in `mask` that a circle overlaps, off-board walls
+  // included; appends them to `out` and returns how many were found
+  size_t overlapCircle(glm::vec3 centre, float radius,
+                       std::vector<glm::ivec2> &out,
+                       uint32_t mask = cellBit(CellType::Wall)) const;
+
+  // Batched forms: hits[i] answers rays[i]. The rays share one lookup per
+  // chunk of whether it holds anything to hit, and on big boards are taken
+  // grouped by the chunk they start in. Sphere casts whose whole sweep stays
+  // inside wall-free chunks are answered from those lookups alone.
+  void raycast(const Ray *rays, size_t count, RayHit *hits,
+               uint32_t mask = cellBit(CellType::Wall)) const;
+  void sphereCast(const Ray *rays, size_t count, float radius,
+                  RayHit *hits) const;
+
   float getBoardWidth() const { return width * cellSize; }
   float getBoardDepth() const { return height * cellSize; }
+
+private:
+  // Reference path: push out of every wall in the 3x3 neighbourhood
+  glm::vec3 resolveWallCollisionScan(glm::vec3 pos, float radius) const;
+
+  // Single and batched raycasts; hasMask(chunk) says whether an on-board
+  // chunk holds a cell in `mask`
+  template <typename ChunkTest>
+  RayHit traceRay(const Ray &ray, uint32_t mask, ChunkTest hasMask) const;
+  RayHit castSphere(const Ray &ray, float radius,
+                    std::vector<glm::ivec2> &touching) const;
+  // Order to cast the rays in: grouped by start chunk on big boards
+  std::vector<uint32_t> castOrder(const Ray *rays, size_t count) const;
 };
 
 class LevelManager {
@@ -40,6 +119,13 @@ public:
   int currentLevelIndex = 0;
 
   void loadBuiltInLevels();
+
+  // Sorted .txt files in a directory (empty if it can't be read)
+  static std::vector<std::string> listLevelFiles(const std::string &directory);
+  // Non-empty lines of a level file; false if it can't be opened
+  static bool readLevelFile(const std::string &filepath,
+                            std::vector<std::string> &rows);
+
   Level &getCurrentLevel();
   bool nextLevel();
   void restartLevel();
@@ -0,0 +1,70 @@
+#ifndef LEVEL_EDITOR_H
+#define LEVEL_EDITOR_H
+
+#include "BoardGenerator.h"
+#include "CellGrid.h"
+#include "FlowField.h"
+#include "InstanceBuffer.h"
+#include "Level.h"
+#include <glm/glm.hpp>
+#include <vector>
+
+/**
+ * LevelEditor - Paints cells into the current level in place (Tab in game).
+ *
+ * An edit changes the Level's cells and then brings everything derived
+ * from them up to date, touching only what the changed cells can reach:
+ * the distance field samples around them, the board chunks whose faces
+ * they decide (only walls have faces of their own), the marker instances
+ * that moved, and the flow field, which is repaired rather than rebuilt
+ * unless the goal moved. Chunk meshes and marker instances are rewritten
+ * in their existing GPU buffers.
+ *
+ * A level keeps exactly one start and one goal: painting either one moves
+ * it, and neither can be painted over. The physics thread must be stopped
+ * while editing.
+ */
+class LevelEditor {
+public:
+  struct Stats {
+    int cells = 0;  // Cells changed
+    int chunks = 0; // Board chunks re-meshed
+    double milliseconds = 0.0;
+  };
+
+  void attach(Level &level, BoardGenerator::BoardMeshes &board,
+              InstanceBuffer &markers, FlowField &flow);
+
+  // Cell under the cursor, from its normalized device coordinates and the
+  // inverse of projection * view * boardModel. Wall tops are hit before
+  // the floor. False if the cursor is not over the board.
+  bool pick(glm::vec2 ndc, const glm::mat4 &inverseClip,
+            glm::ivec2 &cell) const;
+
+  // Paint `type` on a cell; false if nothing changed
+  bool paint(glm::ivec2 cell, CellType type);
+
+  const Stats &getLastEdit() const { return lastEdit; }
+
+private:
+  Level *level = nullptr;
+  BoardGenerator::BoardMeshes *board = nullptr;
+  InstanceBuffer *markers = nullptr;
+  FlowField *flow = nullptr;
+  Stats lastEdit;
+
+  // Per edit, kept between edits so painting doesn't allocate
+  std::vector<glm::ivec2> changed;
+  std::vector<glm::ivec2> dirtyChunks;
+  glm::ivec2 wallMin = glm::ivec2(0), wallMax = glm::ivec2(-1);
+  size_t markerFirst = 0, markerLast = 0; // Marker entries to upload
+  bool markersChanged = false;
+  BoardGenerator::MeshData floorScratch, wallScratch;
+  BoardGenerator::MeshScratch meshScratch;
+
+  void setCell(glm::ivec2 cell, CellType type);
+  void setMarker(size_t index, glm::ivec2 cell, CellType type);
+  void removeHoleMarker(glm::ivec2 cell);
+};
+
+#endif // LEVEL_EDITOR_H
@@ -0,0 +1,81 @@
+#ifndef LEVEL_VALIDATOR_H
+#define LEVEL_VALIDATOR_H
+
+#include "CellGrid.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+/**
+ * LevelValidator - Checks that a level can be solved, from its cells alone.
+ *
+ * No distance field is baked, so large sets of candidate levels can be
+ * screened quickly. The open cells (floor, start and goal) are packed one
+ * bit per cell, 64 to a word, and the breadth-first search advances a
+ * whole word of cells per operation: one BFS layer is a few shifts, ORs
+ * and ANDs per word over the rows the frontier spans. Moves are between
+ * 4-neighbours.
+ *
+ * Choke points come from a depth-first articulation-point pass over the
+ * reachable cells, which only runs when the goal is reachable.
+ *
+ * A validator keeps its scratch buffers between calls; use one per thread.
+ */
+class LevelValidator {
+public:
+  struct Report {
+    std::string path;
+    bool loaded = false; // Set by validate(); false if the file failed
+    int width = 0;
+    int height = 0;
+    int starts = 0;
+    int goals = 0;
+    bool reachable = false; // Goal reachable from the start without holes
+    int pathLength = -1;    // Fewest moves from start to goal, -1 if none
+    size_t reachableCells = 0;
+    // Open cells that every route from start to goal passes through
+    std::vector<glm::ivec2> chokePoints;
+    // Holes with no reachable neighbour; the ball can never fall in them
+    std::vector<glm::ivec2> unreachableHoles;
+
+    bool isValid() const {
+      return loaded && starts == 1 && goals == 1 && reachable;
+    }
+  };
+
+  // Fills in everything but `path`, and marks the report loaded
+  void validate(const CellGrid &cells, Report &report);
+
+  // Load and check each file on the pool; reports[i] describes paths[i]
+  static std::vector<Report>
+  validateFiles(const std::vector<std::string> &paths, ThreadPool &pool);
+
+private:
+  int width = 0, height = 0;
+  int rowWords = 0; // 64-cell words per row
+
+  // One bit per cell, rows padded by an empty row above and below
+  std::vector<uint64_t> open, visited, frontier, next;
+  // Depth-first pass for choke points, one entry per cell
+  std::vector<int> order, low;
+  std::vector<uint8_t> toGoal;
+
+  size_t wordIndex(int x, int y) const {
+    return static_cast<size_t>(y + 1) * rowWords + (x >> 6);
+  }
+  bool testBit(const std::vector<uint64_t> &bits, int x, int y) const {
+    return (bits[wordIndex(x, y)] >> (x & 63)) & 1;
+  }
+
+  void pack(const CellGrid &cells);
+  int search(glm::ivec2 start, glm::ivec2 goal);
+  void findChokePoints(glm::ivec2 start, glm::ivec2 goal,
+                       std::vector<glm::ivec2> &out);
+  void findUnreachableHoles(const CellGrid &cells,
+                            std::vector<glm::ivec2> &out);
+};
+
+#endif // LEVEL_VALIDATOR_H
@@ -0,0 +1,87 @@
+#ifndef MARBLE_WORLD_H
+#define MARBLE_WORLD_H
+
+#include "BallBatch.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Level;
+
+/**
+ * MarbleWorld - Many marbles rolling on one board and bumping each other.
+ *
+ * Marble motion and wall/hole handling come from BallBatch. On top of that,
+ * marble-marble contacts are found with a spatial hash whose buckets are
+ * the level's cells (a marble is smaller than a cell, so only the 3x3
+ * neighbourhood can touch) and resolved with sequential impulses. Marbles
+ * are sorted by cell, and only the occupied cells go into a hash table
+ * sized from the marble count, so a step costs nothing per empty cell and
+ * grows with the marble count alone. The player's Ball can take part as
+ * one more body.
+ *
+ * Marbles that drop into a hole or reach the goal are removed and counted.
+ */
+class MarbleWorld {
+public:
+  explicit MarbleWorld(float radius);
+
+  // Scatter `count` marbles over the free floor cells of the level
+  void spawn(const Level &level, int count, uint32_t seed);
+  void clear();
+
+  void step(float dt, glm::vec2 tiltRadians, const Level &level,
+            Ball *player = nullptr);
+
+  size_t size() const { return marbles.size(); }
+  const BallBatch &getMarbles() const { return marbles; }
+  int getMarblesHome() const { return marblesHome; }
+  int getMarblesLost() const { return marblesLost; }
+  size_t getContactCount() const { return contacts.size(); }
+
+  // Positions before and after the last step (reuses the vectors' storage)
+  void getPositions(std::vector<glm::vec3> &previous,
+                    std::vector<glm::vec3> &current) const;
+
+private:
+  struct Contact {
+    uint32_t a, b; // Lane indices; b == PLAYER for the player's ball
+    glm::vec2 normal; // From a to b
+    float penetration;
+    float bias;    // Target separating velocity (restitution + push-out)
+    float impulse; // Accumulated normal impulse
+  };
+  static constexpr uint32_t PLAYER = 0xffffffffu;
+
+  BallBatch marbles;
+  float radius;
+  int marblesHome = 0;
+  int marblesLost = 0;
+
+  // Lanes in one occupied cell: cellLanes[begin, end)
+  struct Run {
+    uint32_t cell; // y * hashWidth + x
+    uint32_t begin, end;
+  };
+
+  // Spatial hash, rebuilt every step. Runs are in cell order; the table
+  // maps a cell to its run by open addressing.
+  int hashWidth = 0, hashHeight = 0;
+  std::vector<uint64_t> sortKeys; // Cell in the high half, lane in the low
+  std::vector<uint64_t> sortScratch;
+  std::vector<uint32_t> cellLanes;
+  std::vector<Run> runs;
+  std::vector<uint32_t> table; // Run index, or EMPTY
+  uint32_t tableMask = 0;
+  static constexpr uint32_t EMPTY = 0xffffffffu;
+
+  std::vector<Contact> contacts;
+
+  void buildHash(const Level &level);
+  const Run *findRun(uint32_t cell) const;
+  void findContacts(const Level &level, float dt, const Ball *player);
+  void solveContacts(Ball *player);
+  void removeFinished();
+};
+
+#endif // MARBLE_WORLD_H
@@ -0,0 +1,143 @@
+#ifndef MAZE_GENERATOR_H
+#define MAZE_GENERATOR_H
+
+#include "CellGrid.h"
+#include "Config.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <random>
+#include <string>
+#include <vector>
+
+class ThreadPool;
+
+enum class MazeAlgorithm { Backtracker, Wilson, Rooms };
+
+/**
+ * MazeGenerator - Builds maze boards from a seed and a size.
+ *
+ * Maze cells sit on the odd board cells, and the even rows and columns
+ * between them are walls that get knocked through, so a board 2n + 1 cells
+ * wide holds n maze cells. The recursive backtracker makes long winding
+ * corridors, Wilson's loop-erased random walks make a uniform spanning
+ * tree (many short dead ends), and rooms plus corridors opens a few rooms,
+ * joins them with a backtracker maze and then fills in its dead ends.
+ *
+ * Boards are split into square tiles of maze cells, and each tile is
+ * carved on its own thread, with its own seed, into its own buffer. Tiles
+ * line up with CellGrid chunks and own the wall row and column on their
+ * top and left, so no two threads ever write the same cell or chunk. A
+ * spanning tree over the tiles, drawn from the master seed, puts one door
+ * through each edge it uses. The stitched board is therefore one connected
+ * maze, and the result does not depend on the number of threads.
+ *
+ * Start and goal are the ends of the longest route, found by a double
+ * sweep (the farthest cell from anywhere, then the farthest cell from
+ * that). Tiles only meet at doors, so a sweep is one search inside each
+ * tile, from the door it is entered by, plus a walk over the tile tree.
+ * Holes go on floor cells off the route from start to goal, so the level
+ * can always be solved.
+ */
+class MazeGenerator {
+public:
+  struct Settings {
+    int width = 41; // Board cells; even sizes leave a spare wall line
+    int height = 41;
+    MazeAlgorithm algorithm = MazeAlgorithm::Backtracker;
+    uint64_t seed = 1;
+    // Chance that a floor cell off the start-to-goal route is a hole
+    float holeDensity = Config::MAZE_HOLE_DENSITY;
+    // Maze cells along a tile side, rounded up to a multiple of 16
+    int tileCells = Config::MAZE_TILE_CELLS;
+  };
+
+  explicit MazeGenerator(const Settings &settings);
+
+  // Builds the board with its start, goal and holes
+  CellGrid generate(ThreadPool &pool);
+
+  glm::ivec2 getStart() const { return start; }
+  glm::ivec2 getGoal() const { return goal; }
+  // Fewest moves from start to goal
+  int getPathLength() const { return pathLength; }
+  size_t getTileCount() const { return tiles.size(); }
+
+  static const char *algorithmName(MazeAlgorithm algorithm);
+  // "backtracker", "wilson" or "rooms"; false if the name is unknown
+  static bool parseAlgorithm(const std::string &name, MazeAlgorithm &out);
+
+private:
+  // Breadth-first search inside one tile, in maze steps. Cells are
+  // offsets into the tile's buffer.
+  struct Search {
+    int source = 0;
+    int doorDistance[4] = {}; // To the cell beside each door
+    int farthest = 0;         // Farthest cell in the tile
+    int farthestDistance = 0;
+  };
+
+  struct Tile {
+    glm::ivec2 origin = glm::ivec2(0); // Board cell of cells[0]
+    glm::ivec2 size = glm::ivec2(0);   // Board cells owned
+    glm::ivec2 count = glm::ivec2(0);  // Maze cells
+    // The buffer also holds the right and bottom wall lines (owned by the
+    // next tiles), so a tile is a closed maze until its doors are opened
+    int stride = 0, rows = 0;
+    std::vector<CellType> cells;
+    // Cell beside the door towards the neighbouring tile in each direction
+    // (+x, -x, +y, -y), -1 where there is none
+    int doors[4] = {-1, -1, -1, -1};
+    int parent = -1; // Door towards the root of the tile tree
+    Search search;   // From the parent door, or the source in the root
+    // Route from start to goal through this tile, -1 if it misses it
+    int routeFrom = -1, routeTo = -1;
+
+    // Buffer offset of maze cell (x, y)
+    int offset(int x, int y) const {
+      return (2 * y + 1) * stride + 2 * x + 1;
+    }
+    // Offset to the wall in a direction; the next cell is twice as far
+    int step(int direction) const;
+  };
+
+  // Own cache lines, as workers resize theirs while others carve
+  struct alignas(64) Scratch {
+    std::vector<int> queue;
+    std::vector<int> distance;  // Per buffer cell (padded like state)
+    std::vector<uint8_t> state; // Per buffer cell, padded by two rows
+    std::vector<uint8_t> marks; // Per buffer cell
+  };
+
+  Settings settings;
+  int tileCells = 16;
+  glm::ivec2 mazeSize = glm::ivec2(0); // Maze cells on the board
+  glm::ivec2 tileCount = glm::ivec2(0);
+  std::vector<Tile> tiles;
+  std::vector<Scratch> scratch; // Per thread
+  int root = 0;                 // Root of the tile tree
+  glm::ivec2 start = glm::ivec2(1), goal = glm::ivec2(1);
+  int pathLength = 0;
+
+  int neighbourTile(int tile, int direction) const;
+  glm::ivec2 boardCell(const Tile &tile, int cell) const;
+  void planTiles();
+
+  void carve(Tile &tile, size_t index, Scratch &s) const;
+  // s.state: OUTSIDE past the maze cells, 0 on them; returns the base
+  uint8_t *clearState(const Tile &tile, Scratch &s) const;
+  void backtrack(Tile &tile, std::mt19937_64 &rng, Scratch &s) const;
+  void wilson(Tile &tile, std::mt19937_64 &rng, Scratch &s) const;
+  void rooms(Tile &tile, std::mt19937_64 &rng, Scratch &s) const;
+  // Stops early once `target` is taken; distances up to it are final then
+  void search(const Tile &tile, int source, Search &out, Scratch &s,
+              int target = -1) const;
+
+  // Makes `tile` the root of the tile tree and searches the tiles whose
+  // parent door changed
+  void reroot(int tile, int source, ThreadPool &pool);
+  // Farthest cell from the root's source over the whole board
+  void sweep(int &farthestTile, int &farthestCell, int &distance) const;
+  void finish(Tile &tile, size_t index, CellGrid &grid, Scratch &s) const;
+};
+
+#endif // MAZE_GENERATOR_H
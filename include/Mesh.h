@@ -34,20 +34,29 @@ public:
   std::vector<unsigned int> indices;
   unsigned int VAO;
 
-  Mesh() : VAO(0), VBO(0), EBO(0) {}
+  Mesh() : VAO(0), VBO(0), EBO(0), vertexCapacity(0), indexCapacity(0) {}
   Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices);
 
   // Set up the mesh (create VAO, VBO, EBO)
   void setupMesh();
 
+  // Replace the geometry, rewriting the existing buffers in place when it
+  // fits. Swaps with the arguments, which get the old data back for reuse.
+  void update(std::vector<Vertex> &newVertices,
+              std::vector<unsigned int> &newIndices);
+
   // Render the mesh
   void draw() const;
 
+  // Render `count` copies using the attached InstanceBuffer
+  void drawInstanced(size_t count) const;
+
   // Clean up GPU resources
   void cleanup();
 
 private:
   unsigned int VBO, EBO;
+  size_t vertexCapacity, indexCapacity; // Elements the buffers can hold
 };
 
 #endif // MESH_H
@@ -0,0 +1,37 @@
+#ifndef PHYSICS_CLOCK_H
+#define PHYSICS_CLOCK_H
+
+/**
+ * PhysicsClock - Fixed-timestep scheduler for the simulation.
+ *
+ * Frame time is accumulated and consumed in constant-size ticks, so the
+ * physics sees the same dt regardless of the render rate. Whatever is left
+ * over in the accumulator is exposed as an interpolation factor that the
+ * renderer uses to blend between the previous and current physics states.
+ */
+class PhysicsClock {
+public:
+  PhysicsClock(float tickRate, int maxStepsPerFrame);
+
+  // Add frame time; returns how many fixed ticks should be simulated now
+  int advance(float frameDelta);
+
+  // Fraction of a tick left in the accumulator (0..1), for interpolation
+  float getAlpha() const { return accumulator / step; }
+
+  float getStep() const { return step; }
+  int getMaxSteps() const { return maxSteps; }
+
+  // Number of frames where the step cap was hit and time was dropped
+  int getDroppedFrames() const { return droppedFrames; }
+
+  void reset();
+
+private:
+  float step;
+  int maxSteps;
+  float accumulator = 0.0f;
+  int droppedFrames = 0;
+};
+
+#endif // PHYSICS_CLOCK_H
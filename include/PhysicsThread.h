@@ -0,0 +1,101 @@
+#ifndef PHYSICS_THREAD_H
+#define PHYSICS_THREAD_H
+
+#include "PhysicsClock.h"
+#include "Simulation.h"
+#include "SpscQueue.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * PhysicsThread - Runs a Simulation at a fixed tick rate off the render
+ * thread.
+ *
+ * Tilt and rewind input goes in through a lock-free SPSC queue; after each
+ * batch of ticks the state the renderer needs (previous and current
+ * transforms, game phase) is published through a lock-free triple buffer.
+ * The render thread never waits on physics and physics never waits on
+ * rendering.
+ *
+ * Anything else (restart, level change, mode switches) is done by stopping
+ * the thread, changing the Simulation directly and starting it again.
+ * With threading disabled, pump() runs the same loop on the caller.
+ */
+class PhysicsThread {
+public:
+  struct Snapshot {
+    GamePhase phase = GamePhase::Playing;
+    glm::vec3 ballPrevious = glm::vec3(0.0f);
+    glm::vec3 ballPosition = glm::vec3(0.0f);
+    std::vector<glm::vec3> marblePrevious;
+    std::vector<glm::vec3> marblePosition;
+    int marblesHome = 0;
+    int marblesLost = 0;
+    glm::vec2 tilt = glm::vec2(0.0f); // As applied by the simulation
+    float rewindSeconds = 0.0f;       // History available to rewind()
+    uint64_t tick = 0;
+    double tickTime = 0.0; // Clock time (seconds) the latest tick stands for
+    // Last run won or lost (see Simulation::getFinishedReplay)
+    std::shared_ptr<const Replay> finishedReplay;
+  };
+
+  PhysicsThread(Simulation &simulation, float tickRate, int maxStepsPerFrame);
+  ~PhysicsThread();
+
+  PhysicsThread(const PhysicsThread &) = delete;
+  PhysicsThread &operator=(const PhysicsThread &) = delete;
+
+  void start(bool threaded);
+  void stop();
+  bool isThreaded() const { return threaded; }
+
+  // Render thread: send the current board tilt. While `rewinding` the
+  // simulation is held still and stepped back by rewindTicks instead.
+  void setInput(glm::vec2 tiltRadians, bool rewinding = false,
+                uint32_t rewindTicks = 0);
+
+  // Unthreaded mode: advance by one frame's worth of time on the caller
+  void pump(float frameDelta);
+
+  // Publish the simulation as it is now (call while stopped, after edits)
+  void publishNow();
+
+  // Render thread: newest published state, and how far to blend into it
+  const Snapshot &latest();
+  float getAlpha(const Snapshot &snapshot) const;
+
+  float getStep() const { return clock.getStep(); }
+  int getDroppedFrames() const { return clock.getDroppedFrames(); }
+
+  static double now();
+
+private:
+  struct Input {
+    glm::vec2 tilt;
+    bool rewinding;
+    uint32_t rewindTicks;
+  };
+
+  Simulation &sim;
+  PhysicsClock clock;
+  std::thread thread;
+  std::atomic<bool> running{false};
+  bool threaded = false;
+
+  SpscQueue<Input, 64> inputs;
+  TripleBuffer<Snapshot> snapshots;
+  glm::vec2 tilt = glm::vec2(0.0f); // Owned by the physics side
+  bool rewinding = false;
+  double lastTime = 0.0;
+
+  void run();
+  void advance(double time);
+  void publish(double tickTime);
+};
+
+#endif // PHYSICS_THREAD_H
@@ -34,6 +34,9 @@ Mesh createFrustum(int sides = 6, float bottomRadius = 0.5f,
 
 // Plane (useful for ground, walls, etc.)
 Mesh createPlane(float width = 10.0f, float depth = 10.0f);
+
+// Flat arrow in the XZ plane pointing along +X, centred at the origin
+Mesh createArrow(float length = 1.0f, float width = 0.5f);
 } // namespace Primitives
 
 #endif // PRIMITIVES_H
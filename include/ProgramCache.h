@@ -0,0 +1,41 @@
+#ifndef PROGRAM_CACHE_H
+#define PROGRAM_CACHE_H
+
+#include <cstdint>
+#include <string>
+
+/**
+ * ProgramCache - Linked shader programs kept on disk between launches.
+ *
+ * A program is stored as the driver's own binary (glGetProgramBinary), in
+ * Config::SHADER_CACHE_DIRECTORY. The file is named by a hash of both
+ * stages' full source (permutation defines included) and the GL vendor,
+ * renderer and version strings. A driver update or a changed shader
+ * therefore misses, and never loads a stale binary. Drivers may still
+ * reject a binary they wrote, e.g. after a silent update. In that case
+ * load() fails and the caller compiles from source, and the fresh binary
+ * replaces the file. Drivers that offer no binary formats simply never hit.
+ */
+namespace ProgramCache {
+
+struct Stats {
+  int hits = 0;
+  int misses = 0; // Compiled from source, including rejected binaries
+};
+
+// Key for a program; needs a current GL context
+uint64_t key(const std::string &vertexCode, const std::string &fragmentCode);
+
+// Ask the driver to keep `program` retrievable; call before linking
+void prepare(unsigned int program);
+// Give `program` the cached binary for `key`; false if there is none or
+// the driver won't link it
+bool load(unsigned int program, uint64_t key);
+// Save a linked program under `key`
+void store(unsigned int program, uint64_t key);
+
+const Stats &getStats();
+
+} // namespace ProgramCache
+
+#endif // PROGRAM_CACHE_H
@@ -0,0 +1,107 @@
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#include "Simulation.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+class Level;
+
+/**
+ * Replay - A recorded run that can be re-simulated without a window.
+ *
+ * A replay holds a hash of the level, the physics settings it was played
+ * with, the tilt input of every tick and the final state. Tilt is
+ * quantized (see quantizeTilt) before the simulation sees it, so replaying
+ * the stored values reproduces the run bit for bit.
+ *
+ * Inputs are stored as changes: for each change, the tick count since the
+ * last change (varint), then the delta of both tilt axes in quantized
+ * units (zigzag varint). A held tilt costs nothing, and typical steering
+ * costs a few bytes per change.
+ */
+class Replay {
+public:
+  // Everything besides the level and input that decides the outcome
+  struct Settings {
+    float tickRate, gravity, friction, maxSpeed, bounce, ballRadius;
+    float contactSkin, frictionReferenceRate;
+    int32_t maxSweepContacts, sdfSamplesPerCell;
+    int32_t sdfMaxMegabytes; // Decides the baked resolution on big boards
+    int32_t sdfPushIterations;
+    int32_t marbleCount, marbleIterations;
+    float marbleRestitution, marbleRestitutionThreshold, marbleBaumgarte;
+    float marbleSlop;
+
+    static Settings current();
+    bool operator==(const Settings &other) const;
+  };
+
+  struct Outcome {
+    GamePhase phase = GamePhase::Playing;
+    uint64_t ticks = 0;
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+  };
+
+  struct Verification {
+    bool ok = false;
+    std::string error; // Why it failed
+    Outcome replayed;
+    double seconds = 0.0; // Wall-clock time spent re-simulating
+  };
+
+  uint64_t levelHash = 0;
+  Settings settings = Settings::current();
+  bool multiMarble = false;
+  uint32_t marbleSeed = 0;
+  Outcome outcome;
+
+  static uint64_t hashLevel(const Level &level);
+
+  // Tilt as the simulation sees it, in steps of 2^-20 rad
+  static glm::ivec2 tiltToUnits(glm::vec2 tiltRadians);
+  static glm::vec2 unitsToTilt(glm::ivec2 units);
+  static glm::vec2 quantizeTilt(glm::vec2 tiltRadians) {
+    return unitsToTilt(tiltToUnits(tiltRadians));
+  }
+
+  // --- Recording (driven by Simulation) ---
+  void begin(const Level &level, bool multiMarble, uint32_t marbleSeed);
+  void record(glm::vec2 tiltRadians);
+  void finish(const Simulation &simulation);
+  // Drop the recording (the run was rewound and can't be replayed)
+  void discard();
+  bool isFinished() const { return finished; }
+  uint64_t getTickCount() const { return ticks; }
+
+  // --- Playback ---
+  // Tilt per tick, in order; empty if the stream is corrupt
+  std::vector<glm::vec2> decodeInputs() const;
+  Verification verify(const Level &level) const;
+
+  // --- Files ---
+  std::vector<uint8_t> serialize() const;
+  bool deserialize(const std::vector<uint8_t> &bytes);
+  bool save(const std::string &path) const;
+  bool load(const std::string &path);
+
+private:
+  std::vector<uint8_t> inputs; // Encoded changes (see class comment)
+  uint64_t ticks = 0;
+  bool finished = false;
+
+  // Change being accumulated by record()
+  glm::ivec2 current = glm::ivec2(0);
+  glm::ivec2 pendingDelta = glm::ivec2(0);
+  uint64_t pendingTicks = 0;
+
+  void flush();
+  // Calls visit(run, tilt) for each change in order, the pending one last;
+  // false if the stream is corrupt or does not add up to `ticks`
+  template <typename Visit> bool forEachChange(Visit visit) const;
+};
+
+#endif // REPLAY_H
@@ -0,0 +1,94 @@
+#ifndef REWIND_BUFFER_H
+#define REWIND_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+class Ball;
+
+/**
+ * RewindBuffer - Recent history of the ball, one frame per physics tick.
+ *
+ * Frames are packed into a fixed byte arena that is used as a ring. Every
+ * keyframeInterval ticks a full keyframe is written. The frames in between
+ * store each 32-bit field XORed with its prediction, as a varint. The
+ * prediction is the field's value on the previous tick; for
+ * previousPosition it is the previous position. Values that barely change
+ * XOR to small numbers and take one or two bytes. When the arena is full,
+ * the oldest keyframe and its deltas are dropped as a unit.
+ *
+ * Everything is allocated up front, so push() never allocates. restore()
+ * decodes at most one keyframe plus keyframeInterval - 1 deltas.
+ */
+class RewindBuffer {
+public:
+  struct Frame {
+    glm::vec3 position = glm::vec3(0.0f);
+    glm::vec3 velocity = glm::vec3(0.0f);
+    glm::vec3 previousPosition = glm::vec3(0.0f);
+    float fallProgress = 0.0f;
+    bool isFalling = false;
+    glm::vec2 tilt = glm::vec2(0.0f);
+
+    void apply(Ball &ball) const;
+  };
+
+  RewindBuffer(size_t arenaBytes, int keyframeInterval);
+
+  void clear();
+  // Frames must be pushed for consecutive ticks
+  void push(uint64_t tick, const Ball &ball, glm::vec2 tilt);
+
+  bool isEmpty() const { return segmentCount == 0; }
+  uint64_t getOldestTick() const;
+  uint64_t getNewestTick() const { return newestTick; }
+
+  bool restore(uint64_t tick, Frame &out) const;
+  // Forget everything after `tick` (history continues from there)
+  void truncateAfter(uint64_t tick);
+
+  size_t getArenaBytes() const { return arena.size(); }
+  size_t getUsedBytes() const { return usedBytes; }
+
+private:
+  static constexpr int WORDS = 13;  // Frame as 32-bit words
+  static constexpr int MAX_FRAME_BYTES = WORDS * 5;
+
+  // A keyframe and the deltas that follow it
+  struct Segment {
+    uint64_t firstTick;
+    size_t offset; // Arena position of the keyframe
+    size_t bytes;
+    int frames;
+  };
+
+  std::vector<uint8_t> arena;
+  size_t writePos = 0;
+  size_t usedBytes = 0;
+  int keyframeInterval;
+
+  std::vector<Segment> segments; // Ring of segments, oldest first
+  size_t firstSegment = 0;
+  size_t segmentCount = 0;
+
+  uint64_t newestTick = 0;
+  uint32_t last[WORDS] = {}; // Newest frame, as words
+
+  static void toWords(const Frame &frame, uint32_t *words);
+  static void fromWords(const uint32_t *words, Frame &frame);
+  static void predict(const uint32_t *previous, uint32_t *prediction);
+
+  Segment &segment(size_t i) {
+    return segments[(firstSegment + i) % segments.size()];
+  }
+  const Segment &segment(size_t i) const {
+    return segments[(firstSegment + i) % segments.size()];
+  }
+  void write(const uint8_t *bytes, size_t count);
+  // Decodes frames of `seg` up to `frameIndex`; returns bytes consumed
+  size_t decode(const Segment &seg, int frameIndex, uint32_t *words) const;
+};
+
+#endif // REWIND_BUFFER_H
@@ -1,46 +1,220 @@
 #ifndef SHADER_H
 #define SHADER_H
 
+#include <cstdint>
+#include <cstring>
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 #include <string>
-#include <unordered_map>
+#include <type_traits>
+#include <vector>
+
+// FNV-1a hash of a uniform name
+constexpr uint32_t uniformHash(const char *name) {
+  uint32_t hash = 2166136261u;
+  for (; *name; ++name)
+    hash = (hash ^ static_cast<uint8_t>(*name)) * 16777619u;
+  return hash;
+}
+
+// Uniform name as its hash. Literal names go through UNIFORM(), which
+// hashes them at compile time; a bare literal does not convert, since a
+// constexpr constructor in an argument would still run at run time.
+struct UniformName {
+  uint32_t hash;
+  static constexpr UniformName fromHash(uint32_t hash) {
+    return UniformName(hash);
+  }
+  UniformName(const std::string &name) : hash(uniformHash(name.c_str())) {}
+
+private:
+  explicit constexpr UniformName(uint32_t hash) : hash(hash) {}
+};
+
+// Template argument, so the hash is a constant expression
+#define UNIFORM(literal)                                                       \
+  UniformName::fromHash(                                                       \
+      std::integral_constant<uint32_t, uniformHash(literal)>::value)
 
 /**
  * Shader class - Manages OpenGL shader programs.
  *
  * This class handles loading, compiling, linking, and using GLSL shaders.
  * It also provides utility functions for setting uniform values.
+ *
+ * After linking, every active uniform outside a block is listed once, with
+ * its location, its GLSL type and a shadow copy of the last value sent.
+ * Names map to entries through a table sorted by hash; an array's bare
+ * name and its element 0 share one entry. Setters find their entry by
+ * hash, or
+ * directly through a typed Uniform handle resolved up front with find().
+ * A value equal to its shadow is not sent again. Counts of sent and
+ * skipped values are kept for all programs, per frame.
+ *
+ * With KHR_parallel_shader_compile, submit() hands both stages and the
+ * link to the driver and returns without asking for any status, since
+ * asking would wait for the work. The driver compiles on its own threads,
+ * and poll() can tell whether it is done without blocking. Without the
+ * extension nothing runs in the background: the work happens on this
+ * thread at the latest when a status is asked for. submit() then only
+ * keeps the sources, and each poll() without `wait` does one stage.
  */
 class Shader {
 public:
+  // Resolved uniform of GLSL type T; invalid if the program doesn't have it
+  template <typename T> struct Uniform {
+    int entry = -1;
+    bool valid() const { return entry >= 0; }
+  };
+
+  enum class Status {
+    Pending, // Submitted, driver still working
+    Ready,
+    Failed // Or never loaded
+  };
+
+  struct UniformStats {
+    int sent = 0;
+    int skipped = 0; // Same value as last time
+  };
+
   unsigned int ID; // OpenGL program ID
 
   Shader() : ID(0) {}
 
   // Load and compile shaders from file paths
   bool load(const std::string &vertexPath, const std::string &fragmentPath);
+  // Compile and link from source. `defines` (lines of "#define NAME") are
+  // inserted after each stage's #version line.
+  bool compile(const std::string &vertexCode, const std::string &fragmentCode,
+               const std::string &defines = "");
+  void cleanup();
+
+  // Start compiling and linking like compile(), without waiting. A program
+  // found in the ProgramCache is ready at once.
+  void submit(const std::string &vertexCode, const std::string &fragmentCode,
+              const std::string &defines = "");
+  // Finish a submitted program once the driver is done with it. Without
+  // `wait` it returns Pending while the driver is still busy. Without
+  // parallel compile it instead does the next stage and returns: vertex
+  // shader, fragment shader, then the link, which finishes the program.
+  Status poll(bool wait);
+  Status getStatus() const { return status; }
+
+  // Turn on the driver's parallel compile if it has KHR (or ARB)
+  // _parallel_shader_compile; `load` resolves GL functions. Once per
+  // context.
+  static bool enableParallelCompile(GLADloadproc load);
+  static bool hasParallelCompile() { return parallelCompile; }
+
+  // Read a whole source file; false (with a message) if it can't be read
+  static bool readFile(const std::string &path, std::string &out);
 
   // Activate this shader program
   void use() const;
 
+  // Handle for a uniform whose declared type matches T (int also matches
+  // samplers); invalid and reported if it doesn't
+  template <typename T> Uniform<T> find(UniformName name) const {
+    int entry = findEntry(name.hash);
+    if (entry >= 0 && !accepts(entries[entry].type, glType<T>())) {
+      reportMismatch(entry);
+      entry = -1;
+    }
+    return {entry};
+  }
+
+  // Set a uniform of the program in use
+  template <typename T> void set(Uniform<T> uniform, const T &value) const {
+    if (uniform.entry < 0)
+      return;
+    Entry &e = entries[uniform.entry];
+    static_assert(sizeof(T) <= sizeof(e.shadow), "Shadow too small");
+    if (e.known && std::memcmp(e.shadow, &value, sizeof(T)) == 0) {
+      ++stats.skipped;
+      return;
+    }
+    std::memcpy(e.shadow, &value, sizeof(T));
+    e.known = true;
+    send(e.location, value);
+    ++stats.sent;
+  }
+
   // Uniform setters
-  void setBool(const std::string &name, bool value) const;
-  void setInt(const std::string &name, int value) const;
-  void setFloat(const std::string &name, float value) const;
-  void setVec2(const std::string &name, const glm::vec2 &value) const;
-  void setVec3(const std::string &name, const glm::vec3 &value) const;
-  void setVec4(const std::string &name, const glm::vec4 &value) const;
-  void setMat3(const std::string &name, const glm::mat3 &value) const;
-  void setMat4(const std::string &name, const glm::mat4 &value) const;
+  void setBool(UniformName name, bool value) const;
+  void setInt(UniformName name, int value) const;
+  void setFloat(UniformName name, float value) const;
+  void setVec2(UniformName name, const glm::vec2 &value) const;
+  void setIVec2(UniformName name, const glm::ivec2 &value) const;
+  void setVec3(UniformName name, const glm::vec3 &value) const;
+  void setVec4(UniformName name, const glm::vec4 &value) const;
+  void setMat3(UniformName name, const glm::mat3 &value) const;
+  void setMat4(UniformName name, const glm::mat4 &value) const;
+
+  // Attach the uniform block `name` to a binding point, if the program has
+  // it (GLSL 4.1 has no layout(binding) for blocks)
+  void bindBlock(const std::string &name, unsigned int binding) const;
+
+  // Counts since the last call, for all programs
+  static UniformStats takeUniformStats();
 
 private:
-  // Cache for uniform locations to avoid repeated lookups
-  mutable std::unordered_map<std::string, int> uniformCache;
+  struct Entry {
+    int location;
+    GLenum type;
+    bool known; // Shadow holds what the program has
+    alignas(16) unsigned char shadow[64];
+  };
+  struct Name {
+    uint32_t hash;
+    int entry;
+  };
+
+  // Mutable for the shadows
+  mutable std::vector<Entry> entries;
+  std::vector<Name> names; // Sorted by hash
+  static UniformStats stats;
+
+  Status status = Status::Failed;
+  // Stages and cache key of a submitted program until poll() finishes it
+  unsigned int pendingVertex = 0, pendingFragment = 0;
+  uint64_t pendingKey = 0;
+  // Without parallel compile: sources and stages not yet compiled
+  std::string stagedVertex, stagedFragment;
+  int stagesLeft = 0;
+  static bool parallelCompile;
+
+  void listUniforms();
+  int findEntry(uint32_t hash) const;
+  void reportMismatch(int entry) const;
+  static bool accepts(GLenum declared, GLenum wanted);
+
+  template <typename T> static GLenum glType();
+  static void send(int location, bool value);
+  static void send(int location, int value);
+  static void send(int location, float value);
+  static void send(int location, const glm::vec2 &value);
+  static void send(int location, const glm::ivec2 &value);
+  static void send(int location, const glm::vec3 &value);
+  static void send(int location, const glm::vec4 &value);
+  static void send(int location, const glm::mat3 &value);
+  static void send(int location, const glm::mat4 &value);
 
-  int getUniformLocation(const std::string &name) const;
   unsigned int compileShader(const std::string &source, GLenum type);
+  void link();
+  // Compile or link the next staged step, waiting for it
+  void step();
   bool checkCompileErrors(unsigned int shader, const std::string &type);
 };
 
+template <> inline GLenum Shader::glType<bool>() { return GL_BOOL; }
+template <> inline GLenum Shader::glType<int>() { return GL_INT; }
+template <> inline GLenum Shader::glType<float>() { return GL_FLOAT; }
+template <> inline GLenum Shader::glType<glm::vec2>() { return GL_FLOAT_VEC2; }
+template <> inline GLenum Shader::glType<glm::ivec2>() { return GL_INT_VEC2; }
+template <> inline GLenum Shader::glType<glm::vec3>() { return GL_FLOAT_VEC3; }
+template <> inline GLenum Shader::glType<glm::vec4>() { return GL_FLOAT_VEC4; }
+template <> inline GLenum Shader::glType<glm::mat3>() { return GL_FLOAT_MAT3; }
+template <> inline GLenum Shader::glType<glm::mat4>() { return GL_FLOAT_MAT4; }
+
 #endif // SHADER_H
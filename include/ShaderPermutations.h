@@ -0,0 +1,64 @@
+#ifndef SHADER_PERMUTATIONS_H
+#define SHADER_PERMUTATIONS_H
+
+#include "Shader.h"
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * ShaderPermutations - #define-specialised variants of one shader pair.
+ *
+ * The sources are read once. A variant is a feature bitmask: bit i turns
+ * on `#define features[i]` in both stages, so each variant compiles only
+ * the paths it uses, and draws run no uniform branches. A variant is
+ * submitted the first time its mask is asked for. With parallel compile
+ * the driver builds it on its own threads and update() collects it once
+ * done, so a new material never holds up a frame. Without it update()
+ * does one stage of one variant per frame, in the order they were asked
+ * for, so a frame waits for at most one compile or link. Until a variant
+ * is ready get() hands back the ready variant with the most features out
+ * of those asked for, e.g. the plain program. A variant
+ * that fails to compile is remembered and not retried. Each new program is
+ * passed to the setup hook, which attaches the blocks and samplers that
+ * would otherwise be set per program.
+ */
+class ShaderPermutations {
+public:
+  using Setup = std::function<void(const Shader &)>;
+
+  bool load(const std::string &vertexPath, const std::string &fragmentPath,
+            std::vector<std::string> features, Setup setup = nullptr);
+
+  // Start compiling a variant ahead of its first get()
+  void request(uint32_t features);
+  // Wait for a variant; nullptr if it doesn't compile. For the fallbacks.
+  const Shader *require(uint32_t features);
+  // Program for a feature mask, or while it compiles the best ready subset
+  // of it; nullptr if there is none
+  const Shader *get(uint32_t features);
+
+  // Once per frame: finish variants the driver is done with. Without
+  // parallel compile, do the next stage of the first pending variant.
+  void update();
+
+  size_t getVariantCount() const { return variants.size(); }
+  size_t getPendingCount() const;
+
+  void cleanup();
+
+private:
+  std::string vertexCode, fragmentCode;
+  std::vector<std::string> featureNames;
+  Setup setup;
+  std::unordered_map<uint32_t, Shader> variants;
+  std::vector<uint32_t> order; // Masks in the order first asked for
+
+  std::string defines(uint32_t features) const;
+  // Set up a variant that just became ready, or report it failed
+  void finish(uint32_t features, Shader &shader);
+};
+
+#endif // SHADER_PERMUTATIONS_H
@@ -0,0 +1,169 @@
+#ifndef SIMD_MATH_H
+#define SIMD_MATH_H
+
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_HAS_SSE2 1
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_HAS_AVX2 1
+#endif
+
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_HAS_NEON 1
+#endif
+
+/**
+ * SimdMath - Thin float-vector wrappers for the batched physics kernels.
+ *
+ * Each instruction set is a struct with a float vector F, a lane mask M and
+ * the handful of operations the kernels need. Kernels are templates over
+ * these structs, so one source produces the SSE2, AVX2 and NEON variants.
+ * Only plain IEEE operations are exposed (no FMA, no approximate rsqrt) so
+ * the results match the scalar code bit for bit.
+ *
+ * Everything lives in an unnamed namespace on purpose: the AVX2 kernels are
+ * built in their own translation unit with -mavx2, and internal linkage
+ * keeps those VEX-encoded copies from being merged with the SSE2 ones.
+ */
+namespace Simd {
+namespace {
+
+#ifdef SIMD_HAS_SSE2
+struct SSE2 {
+  static constexpr int Width = 4;
+
+  struct F {
+    __m128 v;
+    friend F operator+(F a, F b) { return {_mm_add_ps(a.v, b.v)}; }
+    friend F operator-(F a, F b) { return {_mm_sub_ps(a.v, b.v)}; }
+    friend F operator*(F a, F b) { return {_mm_mul_ps(a.v, b.v)}; }
+    friend F operator/(F a, F b) { return {_mm_div_ps(a.v, b.v)}; }
+  };
+  struct M {
+    __m128 v;
+    friend M operator&(M a, M b) { return {_mm_and_ps(a.v, b.v)}; }
+    friend M operator|(M a, M b) { return {_mm_or_ps(a.v, b.v)}; }
+  };
+
+  static F load(const float *p) { return {_mm_loadu_ps(p)}; }
+  static void store(float *p, F a) { _mm_storeu_ps(p, a.v); }
+  static F set1(float x) { return {_mm_set1_ps(x)}; }
+  static F sqrt(F a) { return {_mm_sqrt_ps(a.v)}; }
+  static F min(F a, F b) { return {_mm_min_ps(a.v, b.v)}; }
+  static F max(F a, F b) { return {_mm_max_ps(a.v, b.v)}; }
+  static M lt(F a, F b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+  static M gt(F a, F b) { return {_mm_cmpgt_ps(a.v, b.v)}; }
+  static M andNot(M a, M b) { return {_mm_andnot_ps(b.v, a.v)}; } // a & ~b
+  static F select(M m, F a, F b) {
+    return {_mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v))};
+  }
+  static int bits(M m) { return _mm_movemask_ps(m.v); }
+
+  // SSE2 has no round-down: truncate, then step back where that rounded up
+  static F floor(F a) {
+    __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+    __m128 fix = _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f));
+    return {_mm_sub_ps(t, fix)};
+  }
+  static void storeInt(int32_t *p, F a) {
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(p), _mm_cvttps_epi32(a.v));
+  }
+  static F gather(const float *base, const int32_t *idx) {
+    return {_mm_setr_ps(base[idx[0]], base[idx[1]], base[idx[2]],
+                        base[idx[3]])};
+  }
+};
+#endif // SIMD_HAS_SSE2
+
+#ifdef SIMD_HAS_AVX2
+struct AVX2 {
+  static constexpr int Width = 8;
+
+  struct F {
+    __m256 v;
+    friend F operator+(F a, F b) { return {_mm256_add_ps(a.v, b.v)}; }
+    friend F operator-(F a, F b) { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend F operator*(F a, F b) { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend F operator/(F a, F b) { return {_mm256_div_ps(a.v, b.v)}; }
+  };
+  struct M {
+    __m256 v;
+    friend M operator&(M a, M b) { return {_mm256_and_ps(a.v, b.v)}; }
+    friend M operator|(M a, M b) { return {_mm256_or_ps(a.v, b.v)}; }
+  };
+
+  static F load(const float *p) { return {_mm256_loadu_ps(p)}; }
+  static void store(float *p, F a) { _mm256_storeu_ps(p, a.v); }
+  static F set1(float x) { return {_mm256_set1_ps(x)}; }
+  static F sqrt(F a) { return {_mm256_sqrt_ps(a.v)}; }
+  static F min(F a, F b) { return {_mm256_min_ps(a.v, b.v)}; }
+  static F max(F a, F b) { return {_mm256_max_ps(a.v, b.v)}; }
+  static M lt(F a, F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ)}; }
+  static M gt(F a, F b) { return {_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ)}; }
+  static M andNot(M a, M b) { return {_mm256_andnot_ps(b.v, a.v)}; }
+  static F select(M m, F a, F b) { return {_mm256_blendv_ps(b.v, a.v, m.v)}; }
+  static int bits(M m) { return _mm256_movemask_ps(m.v); }
+  static F floor(F a) { return {_mm256_floor_ps(a.v)}; }
+  static void storeInt(int32_t *p, F a) {
+    _mm256_storeu_si256(reinterpret_cast<__m256i *>(p),
+                        _mm256_cvttps_epi32(a.v));
+  }
+  static F gather(const float *base, const int32_t *idx) {
+    __m256i i = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(idx));
+    return {_mm256_i32gather_ps(base, i, 4)};
+  }
+};
+#endif // SIMD_HAS_AVX2
+
+#ifdef SIMD_HAS_NEON
+struct NEON {
+  static constexpr int Width = 4;
+
+  struct F {
+    float32x4_t v;
+    friend F operator+(F a, F b) { return {vaddq_f32(a.v, b.v)}; }
+    friend F operator-(F a, F b) { return {vsubq_f32(a.v, b.v)}; }
+    friend F operator*(F a, F b) { return {vmulq_f32(a.v, b.v)}; }
+    friend F operator/(F a, F b) { return {vdivq_f32(a.v, b.v)}; }
+  };
+  struct M {
+    uint32x4_t v;
+    friend M operator&(M a, M b) { return {vandq_u32(a.v, b.v)}; }
+    friend M operator|(M a, M b) { return {vorrq_u32(a.v, b.v)}; }
+  };
+
+  static F load(const float *p) { return {vld1q_f32(p)}; }
+  static void store(float *p, F a) { vst1q_f32(p, a.v); }
+  static F set1(float x) { return {vdupq_n_f32(x)}; }
+  static F sqrt(F a) { return {vsqrtq_f32(a.v)}; }
+  static F min(F a, F b) { return {vminq_f32(a.v, b.v)}; }
+  static F max(F a, F b) { return {vmaxq_f32(a.v, b.v)}; }
+  static M lt(F a, F b) { return {vcltq_f32(a.v, b.v)}; }
+  static M gt(F a, F b) { return {vcgtq_f32(a.v, b.v)}; }
+  static M andNot(M a, M b) { return {vbicq_u32(a.v, b.v)}; }
+  static F select(M m, F a, F b) { return {vbslq_f32(m.v, a.v, b.v)}; }
+  static int bits(M m) {
+    static const int32_t shifts[4] = {0, 1, 2, 3};
+    uint32x4_t lsb = vshrq_n_u32(m.v, 31);
+    return static_cast<int>(
+        vaddvq_u32(vshlq_u32(lsb, vld1q_s32(shifts))));
+  }
+  static F floor(F a) { return {vrndmq_f32(a.v)}; }
+  static void storeInt(int32_t *p, F a) { vst1q_s32(p, vcvtq_s32_f32(a.v)); }
+  static F gather(const float *base, const int32_t *idx) {
+    float tmp[4] = {base[idx[0]], base[idx[1]], base[idx[2]], base[idx[3]]};
+    return {vld1q_f32(tmp)};
+  }
+};
+#endif // SIMD_HAS_NEON
+
+} // namespace
+} // namespace Simd
+
+#endif // SIMD_MATH_H
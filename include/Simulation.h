@@ -0,0 +1,77 @@
+#ifndef SIMULATION_H
+#define SIMULATION_H
+
+#include "Ball.h"
+#include "MarbleWorld.h"
+#include "RewindBuffer.h"
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <memory>
+
+class Level;
+class Replay;
+
+enum class GamePhase { Playing, Won, Failed };
+
+/**
+ * Simulation - Everything that advances on the physics tick.
+ *
+ * Owns the player's ball, the optional marble crowd and the game phase for
+ * the current level. It knows nothing about windows, input devices or
+ * threads: tick() advances one fixed step with the given board tilt.
+ *
+ * Ticks are deterministic: tilt is quantized on entry, and the marble crowd
+ * is spawned from a seed, so a Replay of the inputs reproduces a run.
+ */
+class Simulation {
+public:
+  Ball ball;
+  MarbleWorld marbles;
+  GamePhase phase = GamePhase::Playing;
+  uint64_t tickCount = 0; // Ticks since the last restart
+  glm::vec2 tilt = glm::vec2(0.0f); // Tilt applied on the last tick
+
+  Simulation();
+
+  void setLevel(const Level *newLevel) { level = newLevel; }
+  const Level *getLevel() const { return level; }
+
+  // Switching modes restarts the run
+  void setMultiMarble(bool enabled);
+  bool isMultiMarble() const { return multiMarble; }
+
+  // Seed for the next marble spawn, and the one the current crowd used
+  void setMarbleSeed(uint32_t seed) { nextMarbleSeed = seed; }
+  uint32_t getMarbleSeed() const { return marbleSeed; }
+
+  // Record every run from restart() until it is won or lost
+  void setRecorder(Replay *replay) { recorder = replay; }
+  // Copy of the last recorded run that was won or lost, null until one is.
+  // Never changed once made, so other threads may keep and read it.
+  std::shared_ptr<const Replay> getFinishedReplay() const {
+    return finishedReplay;
+  }
+
+  // Put the ball on the start cell (and respawn marbles) and resume play
+  void restart();
+
+  void tick(float dt, glm::vec2 tiltRadians);
+
+  // Step the ball back in time (single-ball mode only); resumes play and
+  // drops the replay of the run if it was still recording. Returns false
+  // if there is no history or the run was won.
+  bool rewind(uint64_t ticks);
+  uint64_t getRewindTicks() const;
+
+private:
+  const Level *level = nullptr;
+  bool multiMarble = false;
+  uint32_t marbleSeed = 0;
+  uint32_t nextMarbleSeed = 1;
+  Replay *recorder = nullptr;
+  bool recording = false; // Run is still replayable and unfinished
+  std::shared_ptr<const Replay> finishedReplay;
+  RewindBuffer history;
+};
+
+#endif // SIMULATION_H
@@ -0,0 +1,43 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * SpscQueue - Bounded lock-free queue for one producer and one consumer.
+ *
+ * A fixed ring of Capacity slots (a power of two); push() fails instead of
+ * blocking when the ring is full. Head and tail sit on separate cache lines
+ * so the two threads don't fight over one line.
+ */
+template <typename T, size_t Capacity> class SpscQueue {
+  static_assert((Capacity & (Capacity - 1)) == 0,
+                "SpscQueue capacity must be a power of two");
+
+public:
+  bool push(const T &value) {
+    size_t tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail - headIndex.load(std::memory_order_acquire) == Capacity)
+      return false;
+    slots[tail & (Capacity - 1)] = value;
+    tailIndex.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &out) {
+    size_t head = headIndex.load(std::memory_order_relaxed);
+    if (head == tailIndex.load(std::memory_order_acquire))
+      return false;
+    out = slots[head & (Capacity - 1)];
+    headIndex.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+private:
+  T slots[Capacity];
+  alignas(64) std::atomic<size_t> headIndex{0};
+  alignas(64) std::atomic<size_t> tailIndex{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,76 @@
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * ThreadPool - A fixed set of worker threads for data-parallel loops.
+ *
+ * parallelFor() splits the indices into one contiguous slice per thread.
+ * Each thread takes indices from the front of its own slice, and a thread
+ * whose slice runs dry steals the back half of another thread's remaining
+ * slice. Uneven items (a huge level among small ones, a rollout that runs
+ * to the time limit) therefore balance themselves, while threads mostly
+ * touch neighbouring items and never contend on a shared counter. The
+ * calling thread works too, and the call returns once every index has
+ * been processed. Each call passes a worker number in
+ * [0, getThreadCount()) so bodies can keep per-thread scratch space.
+ *
+ * Slices pack both bounds into one 64-bit word, so counts of 2^32 or more
+ * run as several batches, one after another. Calls must not overlap, and
+ * bodies must not call back into the pool.
+ */
+class ThreadPool {
+public:
+  // Index of the item, and of the thread running it
+  using Body = std::function<void(size_t index, unsigned worker)>;
+
+  // 0 threads means one per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool &) = delete;
+  ThreadPool &operator=(const ThreadPool &) = delete;
+
+  // Workers plus the calling thread
+  unsigned getThreadCount() const {
+    return static_cast<unsigned>(workers.size()) + 1;
+  }
+
+  void parallelFor(size_t count, const Body &body);
+
+private:
+  std::vector<std::thread> workers;
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::condition_variable done;
+  uint64_t generation = 0; // Bumped for every parallelFor
+  unsigned busy = 0;       // Workers still inside the current job
+  bool quitting = false;
+
+  // Remaining slice of each thread: begin in the low 32 bits, end in the
+  // high 32. Owners and thieves both update it with compare-and-swap.
+  struct alignas(64) Slice {
+    std::atomic<uint64_t> bounds{0};
+  };
+  std::unique_ptr<Slice[]> slices;
+  const Body *body = nullptr;
+  size_t base = 0; // First index of the current batch
+
+  // Indices [first, first + count), count below 2^32
+  void runBatch(size_t first, size_t count, const Body &body);
+  void workerLoop(unsigned worker);
+  void drain(unsigned worker);
+  bool takeFront(unsigned worker, size_t &index);
+  bool steal(unsigned worker);
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,46 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * TripleBuffer - Lock-free single-producer/single-consumer state handoff.
+ *
+ * The writer fills getWriteBuffer() and publish()es it; the reader calls
+ * fetch() and then reads getReadBuffer(). Neither side ever waits: the
+ * writer always has a free buffer, and the reader always sees the newest
+ * complete state (intermediate ones are simply skipped). Buffers are
+ * recycled, so a T that owns memory (e.g. vectors) stops allocating once
+ * it has reached its working size.
+ */
+template <typename T> class TripleBuffer {
+public:
+  // Producer side
+  T &getWriteBuffer() { return buffers[back]; }
+  void publish() {
+    uint8_t prev = middle.exchange(back | FRESH, std::memory_order_acq_rel);
+    back = prev & INDEX_MASK;
+  }
+
+  // Consumer side: returns true if a newer state was picked up
+  bool fetch() {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH))
+      return false;
+    uint8_t prev = middle.exchange(front, std::memory_order_acq_rel);
+    front = prev & INDEX_MASK;
+    return true;
+  }
+  const T &getReadBuffer() const { return buffers[front]; }
+
+private:
+  static constexpr uint8_t INDEX_MASK = 0x3;
+  static constexpr uint8_t FRESH = 0x4; // Middle holds unread data
+
+  T buffers[3];
+  std::atomic<uint8_t> middle{1};
+  uint8_t back = 0;  // Owned by the producer
+  uint8_t front = 2; // Owned by the consumer
+};
+
+#endif // TRIPLE_BUFFER_H
@@ -0,0 +1,76 @@
+#ifndef UNIFORM_BLOCKS_H
+#define UNIFORM_BLOCKS_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+
+/**
+ * UniformBlocks - C++ mirrors of the std140 uniform blocks in pbr.vert and
+ * pbr.frag.
+ *
+ * Members are ordered and padded so a struct can be staged in a
+ * UniformRing as it is. The static_asserts catch the C++ side drifting
+ * from the GLSL declarations. Binding points are fixed here, and
+ * Shader::bindBlock attaches a program's blocks to them.
+ */
+namespace UniformBlocks {
+
+constexpr unsigned int FRAME_BINDING = 0;
+constexpr unsigned int MATERIAL_BINDING = 1;
+constexpr unsigned int OBJECT_BINDING = 2;
+
+constexpr int MAX_LIGHTS = 4;
+
+// Camera and lights, once per frame
+struct Frame {
+  glm::mat4 view = glm::mat4(1.0f);
+  glm::mat4 projection = glm::mat4(1.0f);
+  glm::vec4 camPos = glm::vec4(0.0f);       // xyz
+  glm::vec4 ambientColor = glm::vec4(0.0f); // rgb
+  // xyz, w = type (0 = point, 1 = directional)
+  glm::vec4 lightPositions[MAX_LIGHTS] = {};
+  glm::vec4 lightColors[MAX_LIGHTS] = {}; // rgb, w = intensity
+  glm::vec4 lightDirections[MAX_LIGHTS] = {};
+  int32_t numLights = 0;
+  int32_t padding[3] = {};
+};
+static_assert(sizeof(Frame) == 368, "Frame must match FrameBlock (std140)");
+
+// Surface of one kind of object
+struct Material {
+  glm::vec3 albedo = glm::vec3(1.0f);
+  float metallic = 0.0f;
+  float roughness = 0.5f;
+  float ao = 1.0f;
+  uint32_t padding[2] = {};
+};
+static_assert(sizeof(Material) == 32,
+              "Material must match MaterialBlock (std140)");
+
+// Transform of one draw
+struct Object {
+  glm::mat4 model = glm::mat4(1.0f);
+  glm::mat3x4 normalMatrix = glm::mat3x4(1.0f); // std140 mat3: vec4 columns
+};
+static_assert(sizeof(Object) == 112, "Object must match ObjectBlock (std140)");
+
+inline Material material(glm::vec3 albedo, float metallic, float roughness) {
+  Material m;
+  m.albedo = albedo;
+  m.metallic = metallic;
+  m.roughness = roughness;
+  return m;
+}
+
+// Object with its normal matrix worked out once here instead of per vertex
+inline Object object(const glm::mat4 &model) {
+  Object o;
+  o.model = model;
+  o.normalMatrix =
+      glm::mat3x4(glm::transpose(glm::inverse(glm::mat3(model))));
+  return o;
+}
+
+} // namespace UniformBlocks
+
+#endif // UNIFORM_BLOCKS_H
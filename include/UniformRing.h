@@ -0,0 +1,56 @@
+#ifndef UNIFORM_RING_H
+#define UNIFORM_RING_H
+
+#include "Config.h"
+#include <cstddef>
+#include <glad/glad.h>
+#include <vector>
+
+/**
+ * UniformRing - Uniform buffer for std140 blocks rewritten every frame.
+ *
+ * During a frame, blocks are staged on the CPU at offsets aligned for
+ * glBindBufferRange. flush() then copies all of them to the GPU with one
+ * unsynchronized map. The buffer is split into
+ * Config::UNIFORM_RING_FRAMES regions used in turn. Each region gets a
+ * fence at endFrame(), and a region is only written again once its fence
+ * has passed, so the driver never has to stall or shadow-copy the buffer.
+ * A draw selects its blocks with bind(), which is a single
+ * glBindBufferRange with no name lookups.
+ */
+class UniformRing {
+public:
+  // A staged block, valid until the next beginFrame()
+  struct Range {
+    size_t offset = 0; // Within the frame's region
+    size_t size = 0;
+  };
+
+  UniformRing() : UBO(0), regionBytes(0), region(0), alignment(256) {}
+
+  // Move to the next region, waiting for the GPU to finish with it
+  void beginFrame();
+  Range stage(const void *data, size_t size);
+  template <typename Block> Range stage(const Block &block) {
+    return stage(&block, sizeof(Block));
+  }
+  // Upload everything staged this frame; call before the first bind()
+  void flush();
+  void bind(unsigned int binding, Range range) const;
+  // Fence the region after the frame's last draw that reads it
+  void endFrame();
+
+  void cleanup();
+
+private:
+  unsigned int UBO;
+  size_t regionBytes; // Grows with headroom when a frame stages more
+  int region;
+  size_t alignment; // GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT
+  std::vector<unsigned char> staging;
+  GLsync fences[Config::UNIFORM_RING_FRAMES] = {};
+
+  void wait(int index);
+};
+
+#endif // UNIFORM_RING_H
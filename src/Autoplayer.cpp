@@ -0,0 +1,191 @@
+#include "Autoplayer.h"
+#include "Level.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+// Rollout scores: any goal beats any fall, sooner goals and later falls
+// are better, and everything else is ranked by distance left
+static constexpr float GOAL_SCORE = -1e9f;
+static constexpr float FALL_SCORE = 1e9f;
+static constexpr float CUT_OFF_DISTANCE = 1e6f;
+
+Autoplayer::Autoplayer(const Level &level, const Settings &settings)
+    : level(level), settings(settings),
+      dt(1.0f / settings.tickRate),
+      maxTilt(glm::radians(Config::MAX_TILT_DEGREES)) {
+  flow.build(level.cells, level.goalPos);
+  startBall.reset(level);
+}
+
+glm::vec2 Autoplayer::clampTilt(glm::vec2 tilt) const {
+  return glm::clamp(tilt, -maxTilt, maxTilt);
+}
+
+// Accelerate towards a target velocity along the flow, pulled towards the
+// middle of the cell so corners are taken wide of the walls
+glm::vec2 Autoplayer::steer(const Ball &ball) const {
+  glm::ivec2 cell = level.worldToGrid(ball.position);
+  glm::vec3 centre = level.gridToWorld(cell);
+  glm::vec2 direction = flow.getDirection(cell.x, cell.y);
+  glm::vec2 velocity(ball.velocity.x, ball.velocity.z);
+  glm::vec2 offset(ball.position.x - centre.x, ball.position.z - centre.z);
+  // Only the sideways part of the offset is corrected
+  offset -= direction * glm::dot(offset, direction);
+
+  glm::vec2 accel =
+      (direction * Config::AUTOPLAY_STEER_SPEED * level.cellSize - velocity) *
+          Config::AUTOPLAY_STEER_GAIN -
+      offset * Config::AUTOPLAY_CENTRE_GAIN;
+  // Ball::update: a = G * (-sin(tilt.x), sin(tilt.y)); small angles
+  return clampTilt(glm::vec2(-accel.x, accel.y) / Config::BALL_GRAVITY);
+}
+
+float Autoplayer::potential(const Ball &ball) const {
+  glm::ivec2 cell = level.worldToGrid(ball.position);
+  uint32_t distance = flow.getDistance(cell.x, cell.y);
+  if (distance == FlowField::UNREACHABLE)
+    return CUT_OFF_DISTANCE;
+  glm::vec3 centre = level.gridToWorld(cell);
+  glm::vec2 offset =
+      glm::vec2(ball.position.x - centre.x, ball.position.z - centre.z) /
+      level.cellSize;
+  if (distance == 0)
+    return glm::length(offset);
+  return distance - glm::dot(offset, flow.getDirection(cell.x, cell.y));
+}
+
+float Autoplayer::rollout(Ball ball, glm::vec2 tilt, int holdTicks,
+                          int horizonTicks, uint64_t &ticks) const {
+  for (int t = 0; t < horizonTicks; ++t) {
+    ball.update(dt, t < holdTicks ? tilt : steer(ball), level);
+    ticks++;
+    // Once over a hole the fall can't be stopped
+    if (ball.isFalling)
+      return FALL_SCORE - t;
+    if (level.isAtGoal(ball.position, ball.radius))
+      return GOAL_SCORE + t;
+  }
+  return potential(ball);
+}
+
+Autoplayer::Attempt Autoplayer::play(uint64_t seed) const {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+  std::normal_distribution<float> error(0.0f, settings.tiltError * maxTilt);
+
+  float rate = settings.tickRate;
+  int decisionTicks =
+      std::max(1, static_cast<int>(settings.decisionSeconds * rate));
+  int horizonTicks = std::max(
+      decisionTicks, static_cast<int>(settings.horizonSeconds * rate));
+  uint64_t limit = static_cast<uint64_t>(settings.timeLimitSeconds * rate);
+
+  Attempt attempt;
+  Ball ball = startBall;
+  glm::vec2 tilt(0.0f);
+  for (uint64_t tick = 0; tick < limit; ++tick) {
+    if (tick % decisionTicks == 0) {
+      // Candidate 0 is the steering policy itself; the rest perturb it by
+      // up to a full tilt in a random direction
+      glm::vec2 greedy = steer(ball);
+      glm::vec2 best = greedy;
+      float bestScore = rollout(ball, greedy, decisionTicks, horizonTicks,
+                                attempt.ticks);
+      for (int c = 1; c < settings.candidates; ++c) {
+        glm::vec2 candidate =
+            clampTilt(greedy + glm::vec2(unit(rng), unit(rng)) * maxTilt);
+        float score = rollout(ball, candidate, decisionTicks, horizonTicks,
+                              attempt.ticks);
+        if (score < bestScore) {
+          bestScore = score;
+          best = candidate;
+        }
+      }
+      attempt.rollouts += settings.candidates;
+      tilt = clampTilt(best + glm::vec2(error(rng), error(rng)));
+    }
+
+    ball.update(dt, tilt, level);
+    attempt.ticks++;
+    attempt.seconds = (tick + 1) * dt;
+    if (ball.isFalling) {
+      attempt.outcome = GamePhase::Failed;
+      break;
+    }
+    if (level.isAtGoal(ball.position, ball.radius)) {
+      attempt.outcome = GamePhase::Won;
+      break;
+    }
+  }
+  return attempt;
+}
+
+Autoplayer::LevelResult
+Autoplayer::summarize(const std::vector<Attempt> &attempts) {
+  LevelResult result;
+  std::vector<float> times;
+  for (const Attempt &attempt : attempts) {
+    result.attempts++;
+    result.rollouts += attempt.rollouts;
+    result.ticks += attempt.ticks;
+    if (attempt.outcome == GamePhase::Won) {
+      result.solved++;
+      times.push_back(attempt.seconds);
+    } else if (attempt.outcome == GamePhase::Failed) {
+      result.fell++;
+    } else {
+      result.timedOut++;
+    }
+  }
+  if (result.attempts > 0) {
+    result.solveRate = static_cast<float>(result.solved) / result.attempts;
+    result.fallRate = static_cast<float>(result.fell) / result.attempts;
+  }
+  if (!times.empty()) {
+    std::sort(times.begin(), times.end());
+    size_t mid = times.size() / 2;
+    result.medianSeconds = times.size() % 2
+                               ? times[mid]
+                               : 0.5f * (times[mid - 1] + times[mid]);
+  }
+  return result;
+}
+
+uint64_t Autoplayer::attemptSeed(uint64_t base, size_t level, int attempt) {
+  // splitmix64 of the three, so neighbouring attempts are unrelated
+  uint64_t z = base * 0x9e3779b97f4a7c15ull + level * 0xbf58476d1ce4e5b9ull +
+               static_cast<uint64_t>(attempt) * 0x94d049bb133111ebull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+std::vector<Autoplayer::LevelResult>
+Autoplayer::grade(const std::vector<const Level *> &levels,
+                  const Settings &settings, ThreadPool &pool) {
+  std::vector<Autoplayer> players;
+  players.reserve(levels.size());
+  for (const Level *level : levels)
+    players.emplace_back(*level, settings);
+
+  // One item per attempt; long and short attempts mix freely, and the
+  // pool's stealing keeps every thread busy until the last one
+  size_t perLevel = static_cast<size_t>(std::max(settings.attempts, 0));
+  std::vector<Attempt> attempts(levels.size() * perLevel);
+  pool.parallelFor(attempts.size(), [&](size_t i, unsigned) {
+    size_t levelIndex = i / perLevel;
+    int attempt = static_cast<int>(i % perLevel);
+    attempts[i] = players[levelIndex].play(
+        attemptSeed(settings.seed, levelIndex, attempt));
+  });
+
+  std::vector<LevelResult> results;
+  for (size_t l = 0; l < levels.size(); ++l) {
+    std::vector<Attempt> own(attempts.begin() + l * perLevel,
+                             attempts.begin() + (l + 1) * perLevel);
+    results.push_back(summarize(own));
+  }
+  return results;
+}
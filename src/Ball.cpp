@@ -6,12 +6,37 @@
 void Ball::reset(const Level &level) {
   position = level.gridToWorld(level.startPos);
   position.y = radius;
+  previousPosition = position;
   velocity = glm::vec3(0.0f);
   isFalling = false;
   fallProgress = 0.0f;
 }
 
-void Ball::update(float dt, glm::vec2 tiltRadians, Level &level) {
+// Sweep the motion so fast balls bounce at the exact contact instead of
+// tunnelling through walls; the rest of the step continues reflected
+void Ball::sweepMotion(glm::vec3 &position, glm::vec3 &velocity,
+                       glm::vec3 move, float radius, const Level &level) {
+  for (int i = 0; i < Config::BALL_MAX_SWEEP_CONTACTS; ++i) {
+    Level::SweepHit hit = level.sweepCircle(position, move, radius);
+    if (!hit.hit) {
+      position += move;
+      break;
+    }
+    position += move * hit.time + hit.normal * Config::BALL_CONTACT_SKIN;
+    move *= 1.0f - hit.time;
+
+    float vn = glm::dot(velocity, hit.normal);
+    if (vn < 0.0f)
+      velocity -= (1.0f + Config::BALL_BOUNCE) * vn * hit.normal;
+    float mn = glm::dot(move, hit.normal);
+    if (mn < 0.0f)
+      move -= (1.0f + Config::BALL_BOUNCE) * mn * hit.normal;
+  }
+}
+
+void Ball::update(float dt, glm::vec2 tiltRadians, const Level &level) {
+  previousPosition = position;
+
   if (isFalling) {
     fallProgress += dt * 3.0f;
     position.y = radius * (1.0f - fallProgress * 2.0f);
@@ -24,7 +49,8 @@ void Ball::update(float dt, glm::vec2 tiltRadians, Level &level) {
 
   velocity.x += ax * dt;
   velocity.z += az * dt;
-  velocity *= Config::BALL_FRICTION;
+  velocity *= std::pow(Config::BALL_FRICTION,
+                       dt * Config::BALL_FRICTION_REFERENCE_RATE);
 
   float speed = std::sqrt(velocity.x * velocity.x + velocity.z * velocity.z);
   if (speed > Config::BALL_MAX_SPEED) {
@@ -32,16 +58,21 @@ void Ball::update(float dt, glm::vec2 tiltRadians, Level &level) {
     velocity.z = (velocity.z / speed) * Config::BALL_MAX_SPEED;
   }
 
-  position.x += velocity.x * dt;
-  position.z += velocity.z * dt;
+  sweepMotion(position, velocity,
+              glm::vec3(velocity.x * dt, 0.0f, velocity.z * dt), radius, level);
 
+  // Settle any remaining overlap; only bounce if still moving into the wall
   glm::vec3 oldPos = position;
   position = level.resolveWallCollision(position, radius);
 
-  if (std::abs(position.x - oldPos.x) > 0.001f) {
+  float pushX = position.x - oldPos.x;
+  float pushZ = position.z - oldPos.z;
+  if ((pushX > 0.001f && velocity.x < 0.0f) ||
+      (pushX < -0.001f && velocity.x > 0.0f)) {
     velocity.x = -velocity.x * Config::BALL_BOUNCE;
   }
-  if (std::abs(position.z - oldPos.z) > 0.001f) {
+  if ((pushZ > 0.001f && velocity.z < 0.0f) ||
+      (pushZ < -0.001f && velocity.z > 0.0f)) {
     velocity.z = -velocity.z * Config::BALL_BOUNCE;
   }
 
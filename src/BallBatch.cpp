@@ -0,0 +1,272 @@
+#include "BallBatch.h"
+#include "BallBatchKernel.h"
+#include "Config.h"
+#include "Level.h"
+#include <algorithm>
+#include <cmath>
+
+// Lanes per block: all four passes of a block stay in L1
+static constexpr size_t BLOCK_LANES = 512;
+
+BallBatch::BallBatch(float radius) : radius(radius), kernel(bestKernel()) {}
+
+BallBatch::Kernel BallBatch::bestKernel() {
+#if (defined(__x86_64__) || defined(__i386__)) &&                             \
+    (defined(__GNUC__) || defined(__clang__))
+  if (ballBatchHasAVX2 && __builtin_cpu_supports("avx2"))
+    return Kernel::AVX2;
+#endif
+#if defined(SIMD_HAS_SSE2)
+  return Kernel::SSE2;
+#elif defined(SIMD_HAS_NEON)
+  return Kernel::NEON;
+#else
+  return Kernel::Scalar;
+#endif
+}
+
+bool BallBatch::isSupported(Kernel k) {
+  switch (k) {
+  case Kernel::Scalar:
+    return true;
+  case Kernel::AVX2:
+    return bestKernel() == Kernel::AVX2;
+#ifdef SIMD_HAS_SSE2
+  case Kernel::SSE2:
+    return true;
+#endif
+#ifdef SIMD_HAS_NEON
+  case Kernel::NEON:
+    return true;
+#endif
+  default:
+    return false;
+  }
+}
+
+const char *BallBatch::kernelName(Kernel k) {
+  switch (k) {
+  case Kernel::SSE2:
+    return "SSE2";
+  case Kernel::AVX2:
+    return "AVX2";
+  case Kernel::NEON:
+    return "NEON";
+  default:
+    return "scalar";
+  }
+}
+
+void BallBatch::reserve(size_t count) {
+  for (auto *v : {&px, &py, &pz, &vx, &vz, &prevX, &prevY, &prevZ, &fall,
+                  &falling, &moveX, &moveZ})
+    v->reserve(count);
+  atGoal.reserve(count);
+  sweepLanes.reserve(count);
+  cellLanes.reserve(count);
+}
+
+void BallBatch::clear() {
+  for (auto *v : {&px, &py, &pz, &vx, &vz, &prevX, &prevY, &prevZ, &fall,
+                  &falling, &moveX, &moveZ})
+    v->clear();
+  atGoal.clear();
+}
+
+size_t BallBatch::add(const Ball &ball) {
+  px.push_back(0.0f);
+  py.push_back(0.0f);
+  pz.push_back(0.0f);
+  vx.push_back(0.0f);
+  vz.push_back(0.0f);
+  prevX.push_back(0.0f);
+  prevY.push_back(0.0f);
+  prevZ.push_back(0.0f);
+  fall.push_back(0.0f);
+  falling.push_back(0.0f);
+  moveX.push_back(0.0f);
+  moveZ.push_back(0.0f);
+  atGoal.push_back(0);
+  set(px.size() - 1, ball);
+  return px.size() - 1;
+}
+
+Ball BallBatch::get(size_t i) const {
+  Ball ball;
+  ball.radius = radius;
+  ball.position = glm::vec3(px[i], py[i], pz[i]);
+  ball.velocity = glm::vec3(vx[i], 0.0f, vz[i]);
+  ball.previousPosition = glm::vec3(prevX[i], prevY[i], prevZ[i]);
+  ball.isFalling = falling[i] != 0.0f;
+  ball.fallProgress = fall[i];
+  return ball;
+}
+
+void BallBatch::set(size_t i, const Ball &ball) {
+  px[i] = ball.position.x;
+  py[i] = ball.position.y;
+  pz[i] = ball.position.z;
+  vx[i] = ball.velocity.x;
+  vz[i] = ball.velocity.z;
+  prevX[i] = ball.previousPosition.x;
+  prevY[i] = ball.previousPosition.y;
+  prevZ[i] = ball.previousPosition.z;
+  fall[i] = ball.fallProgress;
+  falling[i] = ball.isFalling ? 1.0f : 0.0f;
+  atGoal[i] = 0;
+}
+
+void BallBatch::remove(size_t i) {
+  size_t last = size() - 1;
+  for (auto *v : {&px, &py, &pz, &vx, &vz, &prevX, &prevY, &prevZ, &fall,
+                  &falling, &moveX, &moveZ}) {
+    (*v)[i] = (*v)[last];
+    v->pop_back();
+  }
+  atGoal[i] = atGoal[last];
+  atGoal.pop_back();
+}
+
+glm::vec3 BallBatch::getRenderPosition(size_t i, float alpha) const {
+  return glm::mix(glm::vec3(prevX[i], prevY[i], prevZ[i]),
+                  glm::vec3(px[i], py[i], pz[i]), alpha);
+}
+
+// Reference path: literally Ball::update per lane
+void BallBatch::stepScalar(size_t begin, size_t end, float dt, glm::vec2 tilt,
+                           const Level &level) {
+  for (size_t i = begin; i < end; ++i) {
+    Ball ball = get(i);
+    ball.update(dt, tilt, level);
+    set(i, ball);
+    atGoal[i] = !ball.isFalling && level.isAtGoal(ball.position, radius);
+  }
+}
+
+void BallBatch::step(float dt, glm::vec2 tiltRadians, const Level &level) {
+  const size_t count = size();
+  const DistanceField &field = level.distanceField;
+
+  // The vector kernels only implement the distance field collision path
+  int width = kernel == Kernel::AVX2 ? 8 : 4;
+  if (kernel == Kernel::Scalar || !isSupported(kernel) || !field.isBaked() ||
+      radius >= field.getMaxDistance()) {
+    stepScalar(0, count, dt, tiltRadians, level);
+    return;
+  }
+
+  BallBatchStep s;
+  s.dt = dt;
+  s.ax = -Config::BALL_GRAVITY * std::sin(tiltRadians.x);
+  s.az = Config::BALL_GRAVITY * std::sin(tiltRadians.y);
+  s.friction = std::pow(Config::BALL_FRICTION,
+                        dt * Config::BALL_FRICTION_REFERENCE_RATE);
+  s.maxSpeed = Config::BALL_MAX_SPEED;
+  s.bounce = Config::BALL_BOUNCE;
+  s.radius = radius;
+  s.fallDelta = dt * 3.0f;
+  s.field = reinterpret_cast<const float *>(field.data());
+  s.fieldTiles = field.getTileOffsets();
+  s.fieldTilesX = field.getTilesX();
+  s.fieldTileShift = field.getTileShift();
+  s.fieldX = field.getSamplesX();
+  s.fieldZ = field.getSamplesZ();
+  s.fieldOriginX = field.getOrigin().x;
+  s.fieldOriginZ = field.getOrigin().y;
+  s.fieldSpacing = field.getSpacing();
+  s.sweepMargin = field.getSpacing() * 1.5f;
+  s.pushIterations = Config::SDF_PUSH_ITERATIONS;
+  s.halfWidth = level.getBoardWidth() / 2.0f;
+  s.halfDepth = level.getBoardDepth() / 2.0f;
+  s.cellSize = level.cellSize;
+  s.cellFilterRadius = level.cellSize * 0.45f; // > hole (0.3) and goal (0.4)
+
+  sweepLanes.resize(BLOCK_LANES);
+  cellLanes.resize(BLOCK_LANES);
+  BallBatchLanes l;
+  l.px = px.data();
+  l.py = py.data();
+  l.pz = pz.data();
+  l.vx = vx.data();
+  l.vz = vz.data();
+  l.prevX = prevX.data();
+  l.prevY = prevY.data();
+  l.prevZ = prevZ.data();
+  l.fall = fall.data();
+  l.falling = falling.data();
+  l.moveX = moveX.data();
+  l.moveZ = moveZ.data();
+  l.sweepLanes = sweepLanes.data();
+  l.cellLanes = cellLanes.data();
+
+  const size_t vectorEnd = count - count % width;
+  for (size_t begin = 0; begin < vectorEnd; begin += BLOCK_LANES) {
+    size_t end = std::min(begin + BLOCK_LANES, vectorEnd);
+    l.sweepCount = 0;
+    l.cellCount = 0;
+
+    switch (kernel) {
+#ifdef SIMD_HAS_SSE2
+    case Kernel::SSE2:
+      BallBatchKernel::integrate<Simd::SSE2>(s, l, begin, end);
+      break;
+#endif
+#ifdef SIMD_HAS_NEON
+    case Kernel::NEON:
+      BallBatchKernel::integrate<Simd::NEON>(s, l, begin, end);
+      break;
+#endif
+    case Kernel::AVX2:
+      ballBatchIntegrateAVX2(s, l, begin, end);
+      break;
+    default:
+      break;
+    }
+
+    for (size_t k = 0; k < l.sweepCount; ++k) {
+      uint32_t i = sweepLanes[k];
+      glm::vec3 position(px[i], py[i], pz[i]);
+      glm::vec3 velocity(vx[i], 0.0f, vz[i]);
+      Ball::sweepMotion(position, velocity,
+                        glm::vec3(moveX[i], 0.0f, moveZ[i]), radius, level);
+      px[i] = position.x;
+      pz[i] = position.z;
+      vx[i] = velocity.x;
+      vz[i] = velocity.z;
+    }
+
+    std::fill(atGoal.begin() + begin, atGoal.begin() + end, 0);
+    switch (kernel) {
+#ifdef SIMD_HAS_SSE2
+    case Kernel::SSE2:
+      BallBatchKernel::settle<Simd::SSE2>(s, l, begin, end);
+      break;
+#endif
+#ifdef SIMD_HAS_NEON
+    case Kernel::NEON:
+      BallBatchKernel::settle<Simd::NEON>(s, l, begin, end);
+      break;
+#endif
+    case Kernel::AVX2:
+      ballBatchSettleAVX2(s, l, begin, end);
+      break;
+    default:
+      break;
+    }
+
+    for (size_t k = 0; k < l.cellCount; ++k) {
+      uint32_t i = cellLanes[k];
+      glm::vec3 position(px[i], py[i], pz[i]);
+      if (level.isOverHole(position, radius)) {
+        falling[i] = 1.0f;
+        fall[i] = 0.0f;
+        vx[i] = 0.0f;
+        vz[i] = 0.0f;
+      } else {
+        atGoal[i] = level.isAtGoal(position, radius);
+      }
+    }
+  }
+
+  stepScalar(vectorEnd, count, dt, tiltRadians, level);
+}
@@ -0,0 +1,27 @@
+// Built with -mavx2 on x86 (see CMakeLists.txt); empty stubs elsewhere.
+#include "BallBatchKernel.h"
+
+#ifdef SIMD_HAS_AVX2
+
+extern const bool ballBatchHasAVX2 = true;
+
+void ballBatchIntegrateAVX2(const BallBatchStep &s, BallBatchLanes &l,
+                            size_t begin, size_t end) {
+  BallBatchKernel::integrate<Simd::AVX2>(s, l, begin, end);
+}
+
+void ballBatchSettleAVX2(const BallBatchStep &s, BallBatchLanes &l,
+                         size_t begin, size_t end) {
+  BallBatchKernel::settle<Simd::AVX2>(s, l, begin, end);
+}
+
+#else
+
+extern const bool ballBatchHasAVX2 = false;
+
+void ballBatchIntegrateAVX2(const BallBatchStep &, BallBatchLanes &, size_t,
+                            size_t) {}
+void ballBatchSettleAVX2(const BallBatchStep &, BallBatchLanes &, size_t,
+                         size_t) {}
+
+#endif // SIMD_HAS_AVX2
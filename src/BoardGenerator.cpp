@@ -1,6 +1,10 @@
 #include "BoardGenerator.h"
+#include "Config.h"
 #include "Primitives.h"
+#include "ThreadPool.h"
+#include <algorithm>
 #include <cmath>
+#include <utility>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -8,74 +12,327 @@
 
 namespace BoardGenerator {
 
-BoardMeshes generateBoard(const Level &level) {
-  BoardMeshes result;
+// Marker radii, as fractions of the cell size
+static constexpr float HOLE_RADIUS = 0.3f;
+static constexpr float END_RADIUS = 0.35f; // Start and goal
 
-  float cellSize = level.cellSize;
-  float wallHeight = cellSize * 0.6f;
-  float floorThickness = cellSize * 0.15f;
-
-  std::vector<Vertex> floorVerts, wallVerts;
-  std::vector<unsigned int> floorInds, wallInds;
-
-  Mesh floorTile = Primitives::createCube(cellSize);
-  Mesh wallBlock = Primitives::createCube(cellSize);
-
-  for (int y = 0; y < level.height; ++y) {
-    for (int x = 0; x < level.width; ++x) {
-      char cell = level.getCell(x, y);
-      glm::vec3 worldPos = level.gridToWorld(x, y);
-
-      if (cell == '#') {
-        glm::vec3 wallPos = worldPos;
-        wallPos.y = wallHeight / 2.0f;
-        for (const auto &v : wallBlock.vertices) {
-          Vertex newV = v;
-          newV.Position.x = v.Position.x + wallPos.x;
-          newV.Position.y = v.Position.y * (wallHeight / cellSize) + wallPos.y;
-          newV.Position.z = v.Position.z + wallPos.z;
-          wallVerts.push_back(newV);
-        }
-        unsigned int baseIdx = static_cast<unsigned int>(wallVerts.size()) -
-                               wallBlock.vertices.size();
-        for (unsigned int idx : wallBlock.indices)
-          wallInds.push_back(baseIdx + idx);
-      } else {
-        // Floor tile for walkable cells (including holes, start, goal)
-        glm::vec3 floorPos = worldPos;
-        floorPos.y = -floorThickness / 2.0f;
-        for (const auto &v : floorTile.vertices) {
-          Vertex newV = v;
-          newV.Position.x = v.Position.x + floorPos.x;
-          newV.Position.y =
-              v.Position.y * (floorThickness / cellSize) + floorPos.y;
-          newV.Position.z = v.Position.z + floorPos.z;
-          floorVerts.push_back(newV);
+// Markers are raised slightly above the floor to prevent z-fighting
+static constexpr float MARKER_LIFT = 0.02f;
+static constexpr float MARKER_HEIGHT = 0.02f; // Start and goal; holes less
+
+// Quad from `origin` along edges u and v, counter-clockwise seen from the
+// side cross(u, v) points to. UVs run from uv0 to uv0 + uvSize. Writes four
+// vertices and six indices; `base` is the index of the first vertex.
+static void writeQuad(glm::vec3 origin, glm::vec3 u, glm::vec3 v,
+                      glm::vec2 uv0, glm::vec2 uvSize, Vertex *vertices,
+                      unsigned int *indices, unsigned int base) {
+  glm::vec3 normal = glm::normalize(glm::cross(u, v));
+  glm::vec3 tangent = glm::normalize(u), bitangent = glm::normalize(v);
+  vertices[0] = {origin, normal, uv0, tangent, bitangent};
+  vertices[1] = {origin + u, normal, uv0 + glm::vec2(uvSize.x, 0), tangent,
+                 bitangent};
+  vertices[2] = {origin + u + v, normal, uv0 + uvSize, tangent, bitangent};
+  vertices[3] = {origin + v, normal, uv0 + glm::vec2(0, uvSize.y), tangent,
+                 bitangent};
+  static const unsigned int QUAD[6] = {0, 1, 2, 0, 2, 3};
+  for (int i = 0; i < 6; ++i)
+    indices[i] = base + QUAD[i];
+}
+
+// Splits the set cells of a w x h mask into rectangles and clears it. Each
+// rectangle starts at the first set cell left in scan order, takes the
+// longest run along the row, then as many rows below as have that whole
+// run set. With `rowsOnly`, rectangles stay one row tall.
+template <typename Emit>
+static void greedyRects(std::vector<uint8_t> &mask, int w, int h,
+                        bool rowsOnly, Emit emit) {
+  for (int y = 0; y < h; ++y) {
+    uint8_t *row = &mask[static_cast<size_t>(y) * w];
+    for (int x = 0; x < w;) {
+      if (!row[x]) {
+        ++x;
+        continue;
+      }
+      int width = 1;
+      while (x + width < w && row[x + width])
+        ++width;
+      int height = 1;
+      while (!rowsOnly && y + height < h) {
+        const uint8_t *next = &mask[static_cast<size_t>(y + height) * w + x];
+        if (std::find(next, next + width, 0) != next + width)
+          break;
+        ++height;
+      }
+      for (int r = 0; r < height; ++r)
+        std::fill_n(&mask[static_cast<size_t>(y + r) * w + x], width, 0);
+      emit(x, y, width, height);
+      x += width;
+    }
+  }
+}
+
+// Board cells covered by chunk (cx, cy)
+static void chunkCells(const Level &level, int cx, int cy, glm::ivec2 &min,
+                       glm::ivec2 &max) {
+  const int size = Config::BOARD_CHUNK_CELLS;
+  min = glm::ivec2(cx * size, cy * size);
+  max = glm::min(min + size, glm::ivec2(level.width, level.height));
+}
+
+void meshCells(const Level &level, glm::ivec2 min, glm::ivec2 max,
+               MeshData &floor, MeshData &walls, MeshScratch &scratch) {
+  min = glm::max(min, glm::ivec2(0));
+  max = glm::min(max, glm::ivec2(level.width, level.height));
+  if (min.x >= max.x || min.y >= max.y)
+    return;
+
+  const CellGrid &cells = level.cells;
+  const float cs = level.cellSize;
+  const float wallHeight = cs * Config::WALL_HEIGHT_RATIO;
+  const float floorThickness = cs * Config::FLOOR_THICKNESS_RATIO;
+  const glm::ivec2 size = max - min;
+  auto corner = [&](int x, int y, float height) {
+    return glm::vec3(x * cs - level.getBoardWidth() / 2.0f, height,
+                     y * cs - level.getBoardDepth() / 2.0f);
+  };
+  auto onBoard = [&](int x, int y) {
+    return x >= 0 && y >= 0 && x < level.width && y < level.height;
+  };
+
+  // Wall flags of the cells and a one-cell border (off the board is wall),
+  // read once so the passes below don't look up chunks cell by cell
+  const int mapWidth = size.x + 2;
+  std::vector<uint8_t> &wallMap = scratch.wallMap;
+  wallMap.resize(static_cast<size_t>(mapWidth) * (size.y + 2));
+  for (int y = -1; y <= size.y; ++y) {
+    uint8_t *row = &wallMap[static_cast<size_t>(y + 1) * mapWidth + 1];
+    for (int x = -1; x <= size.x; ++x)
+      row[x] = cells.isWall(min.x + x, min.y + y);
+  }
+  auto isWall = [&](int x, int y) {
+    return wallMap[static_cast<size_t>(y - min.y + 1) * mapWidth +
+                   (x - min.x + 1)] != 0;
+  };
+
+  // First pass: collect the face rectangles, so the second can size the
+  // buffers exactly and write straight into them
+  std::vector<MeshScratch::Face> &faces = scratch.faces;
+  faces.clear();
+
+  // Tops: all walls at wall height, everything else at floor level
+  std::vector<uint8_t> &mask = scratch.mask;
+  mask.resize(static_cast<size_t>(size.x) * size.y);
+  for (bool wall : {true, false}) {
+    for (int y = 0; y < size.y; ++y) {
+      for (int x = 0; x < size.x; ++x)
+        mask[static_cast<size_t>(y) * size.x + x] =
+            isWall(min.x + x, min.y + y) == wall;
+    }
+    greedyRects(mask, size.x, size.y, false, [&](int x, int y, int w, int h) {
+      faces.push_back({min + glm::ivec2(x, y), glm::ivec2(w, h), -1, wall});
+    });
+  }
+
+  // Sides, one direction at a time. A wall shows a side wherever its
+  // neighbour is open or off the board; the floor slab only shows its
+  // sides at the board edge. Faces in one direction are coplanar only
+  // along their row (or column), so they merge into runs. The mask is
+  // transposed for the x directions, so runs always go along mask rows.
+  static const glm::ivec2 STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  for (int k = 0; k < 4; ++k) {
+    glm::ivec2 step = STEPS[k];
+    bool alongY = step.x != 0;
+    int w = alongY ? size.y : size.x, h = alongY ? size.x : size.y;
+    for (bool wall : {true, false}) {
+      for (int j = 0; j < h; ++j) {
+        for (int i = 0; i < w; ++i) {
+          glm::ivec2 cell =
+              min + (alongY ? glm::ivec2(j, i) : glm::ivec2(i, j));
+          glm::ivec2 next = cell + step;
+          bool show;
+          if (!onBoard(next.x, next.y))
+            show = isWall(cell.x, cell.y) == wall;
+          else
+            show = wall && isWall(cell.x, cell.y) && !isWall(next.x, next.y);
+          mask[static_cast<size_t>(j) * w + i] = show;
         }
-        unsigned int baseIdx = static_cast<unsigned int>(floorVerts.size()) -
-                               floorTile.vertices.size();
-        for (unsigned int idx : floorTile.indices)
-          floorInds.push_back(baseIdx + idx);
       }
+      greedyRects(mask, w, h, true, [&](int i, int j, int length, int) {
+        glm::ivec2 cell = min + (alongY ? glm::ivec2(j, i) : glm::ivec2(i, j));
+        faces.push_back(
+            {cell, glm::ivec2(length, 1), static_cast<int8_t>(k), wall});
+      });
+    }
+  }
+
+  // Second pass: grow each mesh once, by exactly its faces
+  size_t wallFaces = 0;
+  for (const MeshScratch::Face &face : faces)
+    wallFaces += face.wall;
+  const size_t floorVertex = floor.vertices.size();
+  const size_t wallVertex = walls.vertices.size();
+  const size_t floorIndex = floor.indices.size();
+  const size_t wallIndex = walls.indices.size();
+  floor.vertices.resize(floorVertex + 4 * (faces.size() - wallFaces));
+  floor.indices.resize(floorIndex + 6 * (faces.size() - wallFaces));
+  walls.vertices.resize(wallVertex + 4 * wallFaces);
+  walls.indices.resize(wallIndex + 6 * wallFaces);
+
+  size_t floorQuads = 0, wallQuads = 0;
+  for (const MeshScratch::Face &face : faces) {
+    size_t quad = face.wall ? wallQuads++ : floorQuads++;
+    unsigned int base = static_cast<unsigned int>(
+        (face.wall ? wallVertex : floorVertex) + 4 * quad);
+    Vertex *vertices = (face.wall ? walls : floor).vertices.data() + base;
+    unsigned int *indices = (face.wall ? walls : floor).indices.data() +
+                            (face.wall ? wallIndex : floorIndex) + 6 * quad;
+    glm::ivec2 cell = face.cell;
+
+    if (face.side < 0) {
+      glm::ivec2 extent = face.size;
+      float height = face.wall ? wallHeight : 0.0f;
+      writeQuad(corner(cell.x, cell.y + extent.y, height),
+                glm::vec3(extent.x * cs, 0, 0),
+                glm::vec3(0, 0, -extent.y * cs),
+                glm::vec2(cell.x, -(cell.y + extent.y)), glm::vec2(extent),
+                vertices, indices, base);
+      continue;
+    }
+
+    int length = face.size.x;
+    float len = length * cs;
+    float bottom = face.wall ? 0.0f : -floorThickness;
+    glm::vec3 up(0, face.wall ? wallHeight : floorThickness, 0);
+    switch (face.side) {
+    case 0: // +x
+      writeQuad(corner(cell.x + 1, cell.y + length, bottom),
+                glm::vec3(0, 0, -len), up, glm::vec2(-(cell.y + length), 0),
+                glm::vec2(length, 1), vertices, indices, base);
+      break;
+    case 1: // -x
+      writeQuad(corner(cell.x, cell.y, bottom), glm::vec3(0, 0, len), up,
+                glm::vec2(cell.y, 0), glm::vec2(length, 1), vertices, indices,
+                base);
+      break;
+    case 2: // +z
+      writeQuad(corner(cell.x, cell.y + 1, bottom), glm::vec3(len, 0, 0), up,
+                glm::vec2(cell.x, 0), glm::vec2(length, 1), vertices, indices,
+                base);
+      break;
+    default: // -z
+      writeQuad(corner(cell.x + length, cell.y, bottom),
+                glm::vec3(-len, 0, 0), up,
+                glm::vec2(-(cell.x + length), 0), glm::vec2(length, 1),
+                vertices, indices, base);
+      break;
     }
   }
+}
+
+BoardMeshes generateBoard(const Level &level, ThreadPool &pool) {
+  BoardMeshes result;
+
+  float cellSize = level.cellSize;
+  float wallHeight = cellSize * Config::WALL_HEIGHT_RATIO;
+
+  const int size = Config::BOARD_CHUNK_CELLS;
+  result.chunksX = (level.width + size - 1) / size;
+  result.chunksY = (level.height + size - 1) / size;
+  const size_t count = static_cast<size_t>(result.chunksX) * result.chunksY;
 
-  if (!floorVerts.empty())
-    result.floor = Mesh(floorVerts, floorInds);
-  if (!wallVerts.empty())
-    result.walls = Mesh(wallVerts, wallInds);
+  // Chunks are meshed on the pool, each into its own buffers; only the
+  // uploads below need the GL context
+  std::vector<MeshData> floors(count), walls(count);
+  std::vector<MeshScratch> scratch(pool.getThreadCount());
+  pool.parallelFor(count, [&](size_t index, unsigned worker) {
+    glm::ivec2 min, max;
+    chunkCells(level, static_cast<int>(index % result.chunksX),
+               static_cast<int>(index / result.chunksX), min, max);
+    meshCells(level, min, max, floors[index], walls[index], scratch[worker]);
+  });
 
+  glm::vec3 origin(-level.getBoardWidth() / 2.0f, 0.0f,
+                   -level.getBoardDepth() / 2.0f);
+  float bottom = -cellSize * Config::FLOOR_THICKNESS_RATIO;
+  result.chunks.resize(count);
+  for (size_t i = 0; i < count; ++i) {
+    BoardChunk &chunk = result.chunks[i];
+    if (!floors[i].vertices.empty())
+      chunk.floor = Mesh(std::move(floors[i].vertices),
+                         std::move(floors[i].indices));
+    if (!walls[i].vertices.empty())
+      chunk.walls = Mesh(std::move(walls[i].vertices),
+                         std::move(walls[i].indices));
+
+    glm::ivec2 min, max;
+    chunkCells(level, static_cast<int>(i % result.chunksX),
+               static_cast<int>(i / result.chunksX), min, max);
+    chunk.min = origin + glm::vec3(min.x * cellSize, bottom, min.y * cellSize);
+    chunk.max =
+        origin + glm::vec3(max.x * cellSize, wallHeight, max.y * cellSize);
+  }
   result.frame = createFrameMesh(level.getBoardWidth(), level.getBoardDepth(),
                                  wallHeight * 1.2f, cellSize * 0.3f);
 
-  // All markers use the same cylinder shape
-  result.holeMarker = Primitives::createCylinder(cellSize * 0.3f, 0.02f, 16);
-  result.startMarker = Primitives::createCylinder(cellSize * 0.35f, 0.02f, 16);
-  result.goalMarker = Primitives::createCylinder(cellSize * 0.35f, 0.02f, 16);
+  auto addMarker = [&](glm::ivec2 cell, CellType type) {
+    result.markerPlacements.push_back(markerPlacement(level, cell, type));
+    result.markerMaterials.push_back(markerMaterial(type));
+  };
+  result.markerPlacements.reserve(FIRST_HOLE_MARKER + level.holePoss.size());
+  result.markerMaterials.reserve(FIRST_HOLE_MARKER + level.holePoss.size());
+  addMarker(level.startPos, CellType::Start);
+  addMarker(level.goalPos, CellType::Goal);
+  for (glm::ivec2 hole : level.holePoss)
+    addMarker(hole, CellType::Hole);
 
   return result;
 }
 
+void rebuildChunk(const Level &level, int cx, int cy, BoardChunk &chunk,
+                  MeshData &floor, MeshData &walls, MeshScratch &scratch) {
+  glm::ivec2 min, max;
+  chunkCells(level, cx, cy, min, max);
+  for (MeshData *data : {&floor, &walls}) {
+    data->vertices.clear();
+    data->indices.clear();
+  }
+  meshCells(level, min, max, floor, walls, scratch);
+  chunk.floor.update(floor.vertices, floor.indices);
+  chunk.walls.update(walls.vertices, walls.indices);
+}
+
+glm::vec4 markerPlacement(const Level &level, glm::ivec2 cell,
+                          CellType type) {
+  glm::vec3 position = level.gridToWorld(cell);
+  position.y = MARKER_LIFT;
+  float radius = type == CellType::Hole ? HOLE_RADIUS : END_RADIUS;
+  return glm::vec4(position, level.cellSize * radius);
+}
+
+InstanceBuffer::Material markerMaterial(CellType type) {
+  switch (type) {
+  case CellType::Start:
+    return {glm::vec3(0.2f, 0.8f, 0.3f), 0.0f, 0.5f};
+  case CellType::Goal:
+    return {glm::vec3(1.0f, 0.84f, 0.0f), 0.9f, 0.3f};
+  default: // Very dark for holes
+    return {glm::vec3(0.05f), 0.0f, 0.95f};
+  }
+}
+
+void BoardMeshes::cleanup() {
+  for (BoardChunk &chunk : chunks) {
+    chunk.floor.cleanup();
+    chunk.walls.cleanup();
+  }
+  chunks.clear();
+  frame.cleanup();
+}
+
+Mesh createMarkerMesh() {
+  return Primitives::createCylinder(1.0f, MARKER_HEIGHT / END_RADIUS, 16);
+}
+
 Mesh createHoleMesh(float radius, float depth, int segments) {
   std::vector<Vertex> vertices;
   std::vector<unsigned int> indices;
@@ -26,6 +26,10 @@ glm::mat4 Camera::getProjectionMatrix(float aspectRatio) const {
   return glm::perspective(glm::radians(Fov), aspectRatio, NearPlane, FarPlane);
 }
 
+Frustum Camera::getFrustum(float aspectRatio, const glm::mat4 &model) const {
+  return Frustum(getProjectionMatrix(aspectRatio) * getViewMatrix() * model);
+}
+
 glm::vec3 Camera::getRightVector() const {
   // Right vector is perpendicular to the view direction and world up
   glm::vec3 position = calculatePosition();
@@ -0,0 +1,351 @@
+#include "CellGrid.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+static constexpr uint64_t ONES = 0x0101010101010101ull;
+
+// The top bit of each byte of eight cells that is `type`. Bytes of x are
+// zero where a cell matches, and only zero bytes keep their top bit clear
+// through the add.
+static uint64_t matches(const CellType *cells, CellType type) {
+  const uint64_t low7 = ONES * 0x7f;
+  uint64_t x;
+  std::memcpy(&x, cells, sizeof(x));
+  x ^= ONES * static_cast<uint8_t>(type);
+  return ~(((x & low7) + low7) | x | low7);
+}
+
+// Cells of `type` in a full chunk row
+static int countInRow(const CellType *row, CellType type) {
+  int n = 0;
+  for (int i = 0; i < CellGrid::CHUNK_SIZE; i += 8)
+    n += static_cast<int>(((matches(row + i, type) >> 7) * ONES) >> 56);
+  return n;
+}
+
+const CellType *CellGrid::uniformBlock(CellType type) {
+  static const auto blocks = [] {
+    std::array<Block, CELL_TYPE_COUNT> b;
+    for (int t = 0; t < CELL_TYPE_COUNT; ++t)
+      std::fill_n(b[t].cells, CHUNK_CELLS, static_cast<CellType>(t));
+    return b;
+  }();
+  return blocks[static_cast<int>(type)].cells;
+}
+
+CellGrid::CellGrid(int w, int h, CellType fill)
+    : width(std::max(w, 0)), height(std::max(h, 0)) {
+  chunksX = (width + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+  chunksY = (height + CHUNK_SIZE - 1) >> CHUNK_SHIFT;
+  tableStride = chunksX + 2;
+  table.assign(static_cast<size_t>(chunksY + 2) * tableStride,
+               uniformBlock(CellType::Wall));
+  blocks.resize(static_cast<size_t>(chunksX) * chunksY);
+  summaries.resize(blocks.size());
+
+  for (int cy = 0; cy < chunksY; ++cy) {
+    for (int cx = 0; cx < chunksX; ++cx) {
+      shareChunk(cx, cy, CellType::Wall);
+      if (fill != CellType::Wall)
+        fillRect(glm::ivec2(cx, cy) * CHUNK_SIZE,
+                 glm::ivec2(cx, cy) * CHUNK_SIZE + CHUNK_SIZE - 1, fill);
+    }
+  }
+}
+
+CellGrid::CellGrid(const CellGrid &other)
+    : width(other.width), height(other.height), chunksX(other.chunksX),
+      chunksY(other.chunksY), tableStride(other.tableStride),
+      table(other.table), blocks(other.blocks.size()),
+      summaries(other.summaries) {
+  for (int cy = 0; cy < chunksY; ++cy) {
+    for (int cx = 0; cx < chunksX; ++cx) {
+      const auto &src = other.blocks[chunkIndex(cx, cy)];
+      if (src) {
+        blocks[chunkIndex(cx, cy)] = std::make_unique<Block>(*src);
+        table[tableIndex(cx, cy)] = blocks[chunkIndex(cx, cy)]->cells;
+      }
+    }
+  }
+}
+
+CellGrid &CellGrid::operator=(const CellGrid &other) {
+  if (this != &other)
+    *this = CellGrid(other);
+  return *this;
+}
+
+CellGrid CellGrid::fromText(const std::vector<std::string> &rows) {
+  int w = 0;
+  for (const std::string &line : rows)
+    w = std::max(w, static_cast<int>(line.size()));
+
+  CellGrid grid(w, static_cast<int>(rows.size()), CellType::Wall);
+  for (int y = 0; y < grid.height; ++y) {
+    for (size_t x = 0; x < rows[y].size(); ++x)
+      grid.set(static_cast<int>(x), y, fromChar(rows[y][x]));
+  }
+  grid.compact();
+  return grid;
+}
+
+std::vector<std::string> CellGrid::toText() const {
+  std::vector<std::string> rows(height, std::string(width, '#'));
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x)
+      rows[y][x] = toChar(at(x, y));
+  }
+  return rows;
+}
+
+CellType CellGrid::fromChar(char c) {
+  switch (c) {
+  case '#':
+    return CellType::Wall;
+  case 'O':
+    return CellType::Hole;
+  case 'S':
+    return CellType::Start;
+  case 'G':
+    return CellType::Goal;
+  default:
+    return CellType::Floor;
+  }
+}
+
+char CellGrid::toChar(CellType type) {
+  switch (type) {
+  case CellType::Wall:
+    return '#';
+  case CellType::Hole:
+    return 'O';
+  case CellType::Start:
+    return 'S';
+  case CellType::Goal:
+    return 'G';
+  default:
+    return '.';
+  }
+}
+
+glm::ivec2 CellGrid::chunkExtent(int cx, int cy) const {
+  return glm::ivec2(std::min(CHUNK_SIZE, width - cx * CHUNK_SIZE),
+                    std::min(CHUNK_SIZE, height - cy * CHUNK_SIZE));
+}
+
+void CellGrid::shareChunk(int cx, int cy, CellType type) {
+  blocks[chunkIndex(cx, cy)].reset();
+  table[tableIndex(cx, cy)] = uniformBlock(type);
+  ChunkSummary &summary = summaries[chunkIndex(cx, cy)];
+  summary = ChunkSummary();
+  summary.counts[int(type)] = CHUNK_CELLS;
+}
+
+CellType *CellGrid::makeWritable(int cx, int cy) {
+  std::unique_ptr<Block> &block = blocks[chunkIndex(cx, cy)];
+  if (!block) {
+    block = std::make_unique<Block>();
+    std::copy_n(table[tableIndex(cx, cy)], CHUNK_CELLS, block->cells);
+    table[tableIndex(cx, cy)] = block->cells;
+  }
+  return block->cells;
+}
+
+void CellGrid::set(int x, int y, CellType type) {
+  if (static_cast<unsigned>(x) >= static_cast<unsigned>(width) ||
+      static_cast<unsigned>(y) >= static_cast<unsigned>(height))
+    return;
+  CellType old = at(x, y);
+  if (old == type)
+    return;
+
+  int cx = x >> CHUNK_SHIFT, cy = y >> CHUNK_SHIFT;
+  CellType *cells = makeWritable(cx, cy);
+  cells[((y & (CHUNK_SIZE - 1)) << CHUNK_SHIFT) | (x & (CHUNK_SIZE - 1))] =
+      type;
+  ChunkSummary &summary = summaries[chunkIndex(cx, cy)];
+  summary.counts[int(old)]--;
+  summary.counts[int(type)]++;
+}
+
+void CellGrid::setChunk(int cx, int cy, const CellType *cells) {
+  glm::ivec2 extent = chunkExtent(cx, cy);
+  ChunkSummary summary;
+  summary.counts[int(CellType::Wall)] = CHUNK_CELLS - extent.x * extent.y;
+  for (int y = 0; y < extent.y; ++y) {
+    const CellType *row = cells + (y << CHUNK_SHIFT);
+    if (extent.x < CHUNK_SIZE) {
+      for (int x = 0; x < extent.x; ++x)
+        summary.counts[int(row[x])]++;
+      continue;
+    }
+    // Floor is whatever the other types leave
+    int rest = CHUNK_SIZE;
+    for (int t = 1; t < CELL_TYPE_COUNT; ++t) {
+      int n = countInRow(row, static_cast<CellType>(t));
+      summary.counts[t] += n;
+      rest -= n;
+    }
+    summary.counts[int(CellType::Floor)] += rest;
+  }
+  for (int t = 0; t < CELL_TYPE_COUNT; ++t) {
+    if (summary.isUniform(static_cast<CellType>(t))) {
+      shareChunk(cx, cy, static_cast<CellType>(t));
+      return;
+    }
+  }
+
+  // Padding cells of a block are walls already
+  CellType *block = makeWritable(cx, cy);
+  for (int y = 0; y < extent.y; ++y)
+    std::copy_n(cells + (y << CHUNK_SHIFT), extent.x,
+                block + (y << CHUNK_SHIFT));
+  summaries[chunkIndex(cx, cy)] = summary;
+}
+
+void CellGrid::compact() {
+  for (int cy = 0; cy < chunksY; ++cy) {
+    for (int cx = 0; cx < chunksX; ++cx) {
+      if (!blocks[chunkIndex(cx, cy)])
+        continue;
+      for (int t = 0; t < CELL_TYPE_COUNT; ++t) {
+        if (chunkSummary(cx, cy).isUniform(static_cast<CellType>(t)))
+          shareChunk(cx, cy, static_cast<CellType>(t));
+      }
+    }
+  }
+}
+
+size_t CellGrid::getAllocatedChunks() const {
+  return std::count_if(blocks.begin(), blocks.end(),
+                       [](const auto &block) { return block != nullptr; });
+}
+
+size_t CellGrid::count(CellType type) const {
+  size_t n = 0;
+  for (const ChunkSummary &summary : summaries)
+    n += summary.count(type);
+  // Padding past the board edge is stored as wall
+  if (type == CellType::Wall)
+    n -= summaries.size() * CHUNK_CELLS - static_cast<size_t>(width) * height;
+  return n;
+}
+
+size_t CellGrid::countInRect(glm::ivec2 min, glm::ivec2 max,
+                             CellType type) const {
+  min = glm::max(min, glm::ivec2(0));
+  max = glm::min(max, glm::ivec2(width - 1, height - 1));
+  if (min.x > max.x || min.y > max.y)
+    return 0;
+
+  size_t n = 0;
+  for (int cy = min.y >> CHUNK_SHIFT; cy <= max.y >> CHUNK_SHIFT; ++cy) {
+    for (int cx = min.x >> CHUNK_SHIFT; cx <= max.x >> CHUNK_SHIFT; ++cx) {
+      const ChunkSummary &summary = chunkSummary(cx, cy);
+      if (summary.count(type) == 0)
+        continue;
+
+      glm::ivec2 origin = glm::ivec2(cx, cy) * CHUNK_SIZE;
+      glm::ivec2 lo = glm::max(min, origin);
+      glm::ivec2 hi = glm::min(max, origin + CHUNK_SIZE - 1);
+      glm::ivec2 extent = chunkExtent(cx, cy);
+      if (summary.isUniform(type)) {
+        n += static_cast<size_t>(hi.x - lo.x + 1) * (hi.y - lo.y + 1);
+        continue;
+      }
+      if (hi - lo + 1 == glm::ivec2(CHUNK_SIZE) && extent == hi - lo + 1) {
+        n += summary.count(type);
+        continue;
+      }
+
+      const CellType *cells = chunkData(cx, cy);
+      for (int y = lo.y; y <= hi.y; ++y) {
+        const CellType *row = cells + ((y - origin.y) << CHUNK_SHIFT);
+        n += std::count(row + (lo.x - origin.x), row + (hi.x - origin.x) + 1,
+                        type);
+      }
+    }
+  }
+  return n;
+}
+
+void CellGrid::collect(CellType type, std::vector<glm::ivec2> &out) const {
+  out.reserve(out.size() + count(type));
+  for (int cy = 0; cy < chunksY; ++cy) {
+    for (int cx = 0; cx < chunksX; ++cx) {
+      if (chunkSummary(cx, cy).count(type) == 0)
+        continue;
+      const CellType *cells = chunkData(cx, cy);
+      glm::ivec2 extent = chunkExtent(cx, cy);
+      for (int y = 0; y < extent.y; ++y) {
+        const CellType *row = cells + (y << CHUNK_SHIFT);
+        // Padding is wall, so only walls need the row cut at the edge
+        int end = type == CellType::Wall ? extent.x : CHUNK_SIZE;
+        for (int x = 0; x < end; x += 8) {
+          if (x + 8 > end) {
+            for (int i = x; i < end; ++i) {
+              if (row[i] == type)
+                out.push_back({cx * CHUNK_SIZE + i, cy * CHUNK_SIZE + y});
+            }
+            break;
+          }
+          // Lowest match first; the bytes below it give its index
+          for (uint64_t m = matches(row + x, type); m; m &= m - 1) {
+            uint64_t below = ((m & (~m + 1)) >> 7) - 1;
+            int i = x + static_cast<int>(((below & ONES) * ONES) >> 56);
+            out.push_back({cx * CHUNK_SIZE + i, cy * CHUNK_SIZE + y});
+          }
+        }
+      }
+    }
+  }
+}
+
+uint32_t CellGrid::neighbourMask(int x, int y, CellType type) const {
+  uint32_t mask = 0;
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      mask |= static_cast<uint32_t>(at(x + dx, y + dy) == type)
+              << ((dy + 1) * 3 + (dx + 1));
+    }
+  }
+  return mask;
+}
+
+void CellGrid::fillRect(glm::ivec2 min, glm::ivec2 max, CellType type) {
+  min = glm::max(min, glm::ivec2(0));
+  max = glm::min(max, glm::ivec2(width - 1, height - 1));
+  if (min.x > max.x || min.y > max.y)
+    return;
+
+  for (int cy = min.y >> CHUNK_SHIFT; cy <= max.y >> CHUNK_SHIFT; ++cy) {
+    for (int cx = min.x >> CHUNK_SHIFT; cx <= max.x >> CHUNK_SHIFT; ++cx) {
+      glm::ivec2 origin = glm::ivec2(cx, cy) * CHUNK_SIZE;
+      glm::ivec2 lo = glm::max(min, origin);
+      glm::ivec2 hi = glm::min(max, origin + CHUNK_SIZE - 1);
+      if (chunkSummary(cx, cy).isUniform(type))
+        continue;
+      // Whole chunk covered: drop its block (off-board cells stay walls, so
+      // only full on-board chunks or walls can be shared)
+      if (hi - lo + 1 == chunkExtent(cx, cy) &&
+          (type == CellType::Wall ||
+           chunkExtent(cx, cy) == glm::ivec2(CHUNK_SIZE))) {
+        shareChunk(cx, cy, type);
+        continue;
+      }
+
+      CellType *cells = makeWritable(cx, cy);
+      ChunkSummary &summary = summaries[chunkIndex(cx, cy)];
+      for (int y = lo.y; y <= hi.y; ++y) {
+        CellType *row = cells + ((y - origin.y) << CHUNK_SHIFT);
+        for (int x = lo.x; x <= hi.x; ++x) {
+          CellType &cell = row[x - origin.x];
+          summary.counts[int(cell)]--;
+          summary.counts[int(type)]++;
+          cell = type;
+        }
+      }
+    }
+  }
+}
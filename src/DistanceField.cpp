@@ -0,0 +1,252 @@
+#include "DistanceField.h"
+#include "Config.h"
+#include "Level.h"
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Closest point on an axis-aligned cell box (in cell units) to p
+static glm::vec2 closestPointOnCell(glm::vec2 p, int cx, int cy) {
+  return glm::vec2(std::clamp(p.x, float(cx), float(cx + 1)),
+                   std::clamp(p.y, float(cy), float(cy + 1)));
+}
+
+// Sample at (x, z) of the sample grid, which starts one cell outside the
+// board. Samples sit at the centre of their sub-cell so none lies on a wall
+// edge.
+static DistanceField::Sample bakeSample(const Level &level, int resolution,
+                                        int sx, int sz) {
+  glm::vec2 p((sx + 0.5f) / resolution - 1.0f,
+              (sz + 0.5f) / resolution - 1.0f);
+  int cx = static_cast<int>(std::floor(p.x));
+  int cy = static_cast<int>(std::floor(p.y));
+  bool inside = level.isWall(cx, cy);
+
+  // Nearest cell of the opposite kind in the 3x3 neighbourhood
+  float bestDist = 1.0f;
+  glm::vec2 bestDir(0.0f);
+  for (int dy = -1; dy <= 1; ++dy) {
+    for (int dx = -1; dx <= 1; ++dx) {
+      bool wall = level.isWall(cx + dx, cy + dy);
+      if (wall == inside)
+        continue;
+      glm::vec2 d = p - closestPointOnCell(p, cx + dx, cy + dy);
+      float dist = glm::length(d);
+      if (dist < bestDist) {
+        bestDist = dist;
+        bestDir = dist > 0.0f ? d / dist : glm::vec2(0.0f);
+      }
+    }
+  }
+
+  DistanceField::Sample s;
+  if (inside) {
+    // Gradient points out of the wall, towards the nearest free cell
+    s.distance = -bestDist * level.cellSize;
+    s.gradient = -bestDir;
+  } else {
+    s.distance = bestDist * level.cellSize;
+    s.gradient = bestDir;
+  }
+  return s;
+}
+
+// Whether tile (tx, tz) needs baking: 0 = all open, 1 = all wall, 2 = mixed
+static uint8_t classifyTile(const Level &level, int tx, int tz) {
+  const int chunk = CellGrid::CHUNK_SIZE;
+  // The tile's cells take in all of chunk (tx, tz), so a chunk holding
+  // walls (padding included) and open cells settles it
+  const CellGrid &cells = level.cells;
+  if (tx < cells.getChunksX() && tz < cells.getChunksY()) {
+    int walls = cells.chunkSummary(tx, tz).count(CellType::Wall);
+    if (walls > 0 && walls < CellGrid::CHUNK_CELLS)
+      return 2;
+  }
+  // Cells whose walls any sample of the tile (apron included) can see
+  glm::ivec2 lo = glm::ivec2(tx, tz) * chunk - 2;
+  glm::ivec2 hi = glm::ivec2(tx, tz) * chunk + chunk;
+  glm::ivec2 boardLo = glm::max(lo, glm::ivec2(0));
+  glm::ivec2 boardHi =
+      glm::min(hi, glm::ivec2(level.width - 1, level.height - 1));
+  glm::ivec2 boardSize = glm::max(boardHi - boardLo + 1, glm::ivec2(0));
+  size_t onBoard = static_cast<size_t>(boardSize.x) * boardSize.y;
+  size_t total = static_cast<size_t>(hi.x - lo.x + 1) * (hi.y - lo.y + 1);
+  size_t walls = level.cells.countInRect(lo, hi, CellType::Wall);
+
+  bool hasWall = walls > 0 || onBoard < total;
+  bool hasOpen = walls < onBoard;
+  return hasWall && hasOpen ? 2 : (hasWall ? 1 : 0);
+}
+
+static std::vector<uint8_t> classifyTiles(const Level &level, int tilesX,
+                                          int tilesZ) {
+  std::vector<uint8_t> kinds(static_cast<size_t>(tilesX) * tilesZ);
+  for (int tz = 0; tz < tilesZ; ++tz) {
+    for (int tx = 0; tx < tilesX; ++tx)
+      kinds[static_cast<size_t>(tz) * tilesX + tx] =
+          classifyTile(level, tx, tz);
+  }
+  return kinds;
+}
+
+void DistanceField::bake(const Level &level, int resolution) {
+  samples.clear();
+  tileOffsets.clear();
+  freeTiles.clear();
+  bakedTiles = 0;
+  if (resolution <= 0 || level.width <= 0 || level.height <= 0)
+    return;
+  while (resolution & (resolution - 1))
+    resolution &= resolution - 1;
+
+  // Tiles line up with CellGrid chunks (shifted by the border cell), so
+  // uniform chunks give constant tiles. A tile spans a chunk of cells at
+  // any resolution, so the tiles are classified once.
+  const int chunk = CellGrid::CHUNK_SIZE;
+  tilesX = (level.width + 2 + chunk - 1) >> CellGrid::CHUNK_SHIFT;
+  tilesZ = (level.height + 2 + chunk - 1) >> CellGrid::CHUNK_SHIFT;
+  std::vector<uint8_t> kinds = classifyTiles(level, tilesX, tilesZ);
+  bakedTiles = std::count(kinds.begin(), kinds.end(), 2);
+  size_t tileSamples = 0;
+  const size_t budget = size_t(Config::SDF_MAX_MEGABYTES) << 20;
+  for (;; resolution /= 2) {
+    if (resolution < 2) {
+      std::cerr << "Distance field for " << level.width << "x"
+                << level.height << " level exceeds "
+                << Config::SDF_MAX_MEGABYTES
+                << " MB; using cell scans for collision" << std::endl;
+      bakedTiles = 0;
+      return;
+    }
+    tileShift = 0;
+    while ((1 << tileShift) < CellGrid::CHUNK_SIZE * resolution)
+      tileShift++;
+    samplesX = (level.width + 2) * resolution;
+    samplesZ = (level.height + 2) * resolution;
+    tileSamples = static_cast<size_t>(getTileStride()) * getTileStride();
+    if ((bakedTiles + 2) * tileSamples * sizeof(Sample) <= budget)
+      break;
+  }
+
+  samplesPerCell = resolution;
+  spacing = level.cellSize / resolution;
+  maxDistance = level.cellSize;
+  origin = glm::vec2(-level.getBoardWidth() / 2.0f - level.cellSize,
+                     -level.getBoardDepth() / 2.0f - level.cellSize);
+
+  // Shared constant tiles: far from any wall, and deep inside one
+  samples.resize((bakedTiles + 2) * tileSamples);
+  std::fill_n(samples.begin(), tileSamples,
+              Sample{maxDistance, glm::vec2(0.0f)});
+  std::fill_n(samples.begin() + tileSamples, tileSamples,
+              Sample{-maxDistance, glm::vec2(0.0f)});
+
+  tileOffsets.resize(kinds.size());
+  size_t next = 2;
+  const int edge = 1 << tileShift;
+  for (int tz = 0; tz < tilesZ; ++tz) {
+    for (int tx = 0; tx < tilesX; ++tx) {
+      size_t tile = static_cast<size_t>(tz) * tilesX + tx;
+      if (kinds[tile] < 2) {
+        tileOffsets[tile] = static_cast<int32_t>(kinds[tile] * tileSamples);
+        continue;
+      }
+      tileOffsets[tile] = static_cast<int32_t>(next * tileSamples);
+      Sample *dst = &samples[next * tileSamples];
+      for (int z = 0; z <= edge; ++z) {
+        for (int x = 0; x <= edge; ++x) {
+          *dst++ =
+              bakeSample(level, resolution, tx * edge + x, tz * edge + z);
+        }
+      }
+      next++;
+    }
+  }
+}
+
+void DistanceField::update(const Level &level, glm::ivec2 minCell,
+                           glm::ivec2 maxCell) {
+  if (!isBaked())
+    return;
+
+  // Samples whose 3x3 cell neighbourhood reaches a changed cell. Sample s
+  // lies in cell s / samplesPerCell - 1.
+  glm::ivec2 lo = glm::max(minCell * samplesPerCell, glm::ivec2(0));
+  glm::ivec2 hi = glm::min((maxCell + 3) * samplesPerCell - 1,
+                           glm::ivec2(samplesX - 1, samplesZ - 1));
+  if (lo.x > hi.x || lo.y > hi.y)
+    return;
+
+  // Tiles holding those samples, aprons included
+  const int edge = 1 << tileShift;
+  const int stride = getTileStride();
+  const size_t tileSamples = static_cast<size_t>(stride) * stride;
+  glm::ivec2 tileLo = glm::max((lo - 1) >> tileShift, glm::ivec2(0));
+  glm::ivec2 tileHi =
+      glm::min(hi >> tileShift, glm::ivec2(tilesX - 1, tilesZ - 1));
+  for (int tz = tileLo.y; tz <= tileHi.y; ++tz) {
+    for (int tx = tileLo.x; tx <= tileHi.x; ++tx) {
+      int32_t &offset = tileOffsets[static_cast<size_t>(tz) * tilesX + tx];
+      bool wasBaked = static_cast<size_t>(offset) >= 2 * tileSamples;
+      uint8_t kind = classifyTile(level, tx, tz);
+      if (kind < 2) {
+        if (wasBaked) {
+          freeTiles.push_back(offset);
+          bakedTiles--;
+        }
+        offset = static_cast<int32_t>(kind * tileSamples);
+        continue;
+      }
+
+      if (!wasBaked) {
+        // Every sample of a shared tile is its constant, and those away
+        // from the change keep it, so the new tile starts as a copy
+        int32_t shared = offset;
+        if (!freeTiles.empty()) {
+          offset = freeTiles.back();
+          freeTiles.pop_back();
+        } else {
+          offset = static_cast<int32_t>(samples.size());
+          samples.resize(samples.size() + tileSamples);
+        }
+        std::copy_n(samples.begin() + shared, tileSamples,
+                    samples.begin() + offset);
+        bakedTiles++;
+      }
+
+      glm::ivec2 corner(tx * edge, tz * edge);
+      glm::ivec2 from = glm::max(lo - corner, glm::ivec2(0));
+      glm::ivec2 to = glm::min(hi - corner, glm::ivec2(edge));
+      for (int z = from.y; z <= to.y; ++z) {
+        Sample *row = &samples[offset + static_cast<size_t>(z) * stride];
+        for (int x = from.x; x <= to.x; ++x)
+          row[x] = bakeSample(level, samplesPerCell, corner.x + x,
+                              corner.y + z);
+      }
+    }
+  }
+}
+
+DistanceField::Sample DistanceField::sample(glm::vec2 worldXZ) const {
+  float u = (worldXZ.x - origin.x) / spacing - 0.5f;
+  float v = (worldXZ.y - origin.y) / spacing - 0.5f;
+  int x0 = std::clamp(static_cast<int>(std::floor(u)), 0, samplesX - 2);
+  int z0 = std::clamp(static_cast<int>(std::floor(v)), 0, samplesZ - 2);
+  float tx = std::clamp(u - x0, 0.0f, 1.0f);
+  float tz = std::clamp(v - z0, 0.0f, 1.0f);
+
+  const Sample *row0 = &at(x0, z0);
+  const Sample *row1 = row0 + getTileStride();
+
+  float w00 = (1.0f - tx) * (1.0f - tz), w10 = tx * (1.0f - tz);
+  float w01 = (1.0f - tx) * tz, w11 = tx * tz;
+
+  Sample result;
+  result.distance = row0[0].distance * w00 + row0[1].distance * w10 +
+                    row1[0].distance * w01 + row1[1].distance * w11;
+  glm::vec2 g = row0[0].gradient * w00 + row0[1].gradient * w10 +
+                row1[0].gradient * w01 + row1[1].gradient * w11;
+  float len = glm::length(g);
+  result.gradient = len > 0.0001f ? g / len : glm::vec2(0.0f);
+  return result;
+}
@@ -0,0 +1,207 @@
+#include "FlowField.h"
+#include <algorithm>
+#include <functional>
+#include <queue>
+#include <utility>
+
+static bool isWalkable(CellType type) {
+  return type == CellType::Floor || type == CellType::Start ||
+         type == CellType::Goal;
+}
+
+// Neighbour offsets in the order of the mask bits
+static const glm::ivec2 STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+void FlowField::build(const CellGrid &cells, glm::ivec2 goalCell) {
+  width = cells.getWidth();
+  height = cells.getHeight();
+  goal = goalCell;
+  size_t count = static_cast<size_t>(width) * height;
+  distance.assign(count, UNREACHABLE);
+  masks.assign(count, 0);
+  walkable.assign(count, 0);
+  for (int y = 0; y < height; ++y) {
+    for (int x = 0; x < width; ++x)
+      walkable[index(x, y)] = isWalkable(cells.at(x, y));
+  }
+
+  if (inside(goal.x, goal.y) && walkable[index(goal.x, goal.y)]) {
+    std::vector<int> queue;
+    queue.reserve(count);
+    queue.push_back(static_cast<int>(index(goal.x, goal.y)));
+    distance[queue[0]] = 0;
+    for (size_t head = 0; head < queue.size(); ++head) {
+      int cell = queue[head];
+      int around[4];
+      int n = neighbours(cell, around);
+      for (int k = 0; k < n; ++k) {
+        if (distance[around[k]] == UNREACHABLE) {
+          distance[around[k]] = distance[cell] + 1;
+          queue.push_back(around[k]);
+        }
+      }
+    }
+  }
+
+  for (size_t i = 0; i < count; ++i)
+    refreshMask(static_cast<int>(i));
+  dirtyMin = glm::ivec2(0);
+  dirtyMax = glm::ivec2(width - 1, height - 1);
+}
+
+void FlowField::update(const CellGrid &cells,
+                       const std::vector<glm::ivec2> &changed) {
+  if (cells.getWidth() != width || cells.getHeight() != height) {
+    build(cells, goal);
+    return;
+  }
+
+  using Entry = std::pair<uint32_t, int>; // (distance, cell)
+  std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+  raised.clear();
+  touched.clear();
+
+  std::vector<int> opened;
+  for (glm::ivec2 c : changed) {
+    if (!inside(c.x, c.y))
+      continue;
+    int i = static_cast<int>(index(c.x, c.y));
+    bool now = isWalkable(cells.at(c.x, c.y));
+    if (now == (walkable[i] != 0))
+      continue;
+    walkable[i] = now;
+    touched.push_back(i);
+    if (now)
+      opened.push_back(i);
+    else if (distance[i] != UNREACHABLE)
+      open.push({distance[i], i});
+  }
+
+  // Raise: in order of old distance, a cell with no neighbour one step
+  // closer has lost its route, and so may the cells it was supporting
+  while (!open.empty()) {
+    auto [d, i] = open.top();
+    open.pop();
+    if (distance[i] != d || (walkable[i] && hasSupport(i)))
+      continue;
+    distance[i] = UNREACHABLE;
+    raised.push_back(i);
+    int around[4];
+    int n = neighbours(i, around);
+    for (int k = 0; k < n; ++k) {
+      if (distance[around[k]] == d + 1)
+        open.push({d + 1, around[k]});
+    }
+  }
+
+  // Lower: seed the raised and newly opened cells from their neighbours,
+  // then relax outwards in distance order
+  int goalCell = static_cast<int>(index(goal.x, goal.y));
+  auto seed = [&](int i) {
+    if (!walkable[i])
+      return;
+    uint32_t best = i == goalCell ? 0 : UNREACHABLE;
+    int around[4];
+    int n = neighbours(i, around);
+    for (int k = 0; k < n; ++k) {
+      if (distance[around[k]] != UNREACHABLE)
+        best = std::min(best, distance[around[k]] + 1);
+    }
+    if (best < distance[i]) {
+      distance[i] = best;
+      open.push({best, i});
+    }
+  };
+  for (int i : raised)
+    seed(i);
+  for (int i : opened)
+    seed(i);
+  while (!open.empty()) {
+    auto [d, i] = open.top();
+    open.pop();
+    if (distance[i] != d)
+      continue;
+    touched.push_back(i);
+    int around[4];
+    int n = neighbours(i, around);
+    for (int k = 0; k < n; ++k) {
+      if (distance[around[k]] > d + 1) {
+        distance[around[k]] = d + 1;
+        open.push({d + 1, around[k]});
+      }
+    }
+  }
+
+  // Masks depend on the cell and its neighbours' distances
+  touched.insert(touched.end(), raised.begin(), raised.end());
+  for (int i : touched) {
+    refreshMask(i);
+    int x = i % width, y = i / width;
+    for (glm::ivec2 step : STEPS) {
+      if (inside(x + step.x, y + step.y))
+        refreshMask(static_cast<int>(index(x + step.x, y + step.y)));
+    }
+  }
+}
+
+glm::vec2 FlowField::getDirection(int x, int y) const {
+  uint8_t mask = getMask(x, y);
+  glm::vec2 sum(0.0f);
+  for (int k = 0; k < 4; ++k) {
+    if (mask & (1u << k))
+      sum += glm::vec2(STEPS[k]);
+  }
+  // Opposite neighbours can tie (both sides of a pillar); take the first
+  if (mask && sum == glm::vec2(0.0f)) {
+    for (int k = 0; k < 4; ++k) {
+      if (mask & (1u << k))
+        return glm::vec2(STEPS[k]);
+    }
+  }
+  return mask ? glm::normalize(sum) : sum;
+}
+
+void FlowField::clearDirty() {
+  dirtyMin = glm::ivec2(INT_MAX);
+  dirtyMax = glm::ivec2(-1);
+}
+
+int FlowField::neighbours(int i, int out[4]) const {
+  int x = i % width, y = i / width;
+  int n = 0;
+  for (glm::ivec2 step : STEPS) {
+    int nx = x + step.x, ny = y + step.y;
+    if (inside(nx, ny) && walkable[index(nx, ny)])
+      out[n++] = static_cast<int>(index(nx, ny));
+  }
+  return n;
+}
+
+bool FlowField::hasSupport(int i) const {
+  int around[4];
+  int n = neighbours(i, around);
+  for (int k = 0; k < n; ++k) {
+    if (distance[around[k]] != UNREACHABLE &&
+        distance[around[k]] + 1 == distance[i])
+      return true;
+  }
+  return false;
+}
+
+void FlowField::refreshMask(int i) {
+  int x = i % width, y = i / width;
+  uint8_t mask = 0;
+  uint32_t d = distance[i];
+  if (d != UNREACHABLE && d > 0) {
+    for (int k = 0; k < 4; ++k) {
+      int nx = x + STEPS[k].x, ny = y + STEPS[k].y;
+      if (inside(nx, ny) && distance[index(nx, ny)] + 1 == d)
+        mask |= 1u << k;
+    }
+  }
+  if (mask == masks[i])
+    return;
+  masks[i] = mask;
+  dirtyMin = glm::min(dirtyMin, glm::ivec2(x, y));
+  dirtyMax = glm::max(dirtyMax, glm::ivec2(x, y));
+}
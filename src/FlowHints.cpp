@@ -0,0 +1,85 @@
+#include "FlowHints.h"
+#include "Config.h"
+#include "Primitives.h"
+
+bool FlowHints::init() {
+  if (!shader.load("assets/shaders/hint.vert", "assets/shaders/hint.frag"))
+    return false;
+  uniforms.model = shader.find<glm::mat4>(UNIFORM("model"));
+  uniforms.view = shader.find<glm::mat4>(UNIFORM("view"));
+  uniforms.projection = shader.find<glm::mat4>(UNIFORM("projection"));
+  uniforms.flowMap = shader.find<int>(UNIFORM("flowMap"));
+  uniforms.boardCells = shader.find<glm::ivec2>(UNIFORM("boardCells"));
+  uniforms.cellSize = shader.find<float>(UNIFORM("cellSize"));
+  uniforms.arrowHeight = shader.find<float>(UNIFORM("arrowHeight"));
+  uniforms.color = shader.find<glm::vec4>(UNIFORM("color"));
+  arrow = Primitives::createArrow(Config::HINT_ARROW_SIZE,
+                                  Config::HINT_ARROW_SIZE * 0.6f);
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  return true;
+}
+
+void FlowHints::sync(FlowField &field) {
+  if (!texture || !field.isDirty())
+    return;
+
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  if (field.getWidth() != width || field.getHeight() != height) {
+    width = field.getWidth();
+    height = field.getHeight();
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8UI, width, height, 0,
+                 GL_RED_INTEGER, GL_UNSIGNED_BYTE, field.getMasks());
+  } else {
+    // Only the changed rectangle, read straight out of the full mask array
+    glm::ivec2 min = field.getDirtyMin(), max = field.getDirtyMax();
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, width);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, min.x, min.y, max.x - min.x + 1,
+                    max.y - min.y + 1, GL_RED_INTEGER, GL_UNSIGNED_BYTE,
+                    field.getMasks() + static_cast<size_t>(min.y) * width +
+                        min.x);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  field.clearDirty();
+}
+
+void FlowHints::draw(const glm::mat4 &boardModel, const glm::mat4 &view,
+                     const glm::mat4 &projection, float cellSize) const {
+  if (!texture || width == 0 || height == 0)
+    return;
+
+  shader.use();
+  shader.set(uniforms.model, boardModel);
+  shader.set(uniforms.view, view);
+  shader.set(uniforms.projection, projection);
+  shader.set(uniforms.flowMap, 0);
+  shader.set(uniforms.boardCells, glm::ivec2(width, height));
+  shader.set(uniforms.cellSize, cellSize);
+  shader.set(uniforms.arrowHeight, Config::HINT_HEIGHT);
+  shader.set(uniforms.color,
+             glm::vec4(Config::HINT_COLOR_R, Config::HINT_COLOR_G,
+                       Config::HINT_COLOR_B, Config::HINT_ALPHA));
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glEnable(GL_BLEND);
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+  glDepthMask(GL_FALSE);
+  arrow.drawInstanced(static_cast<size_t>(width) * height);
+  glDepthMask(GL_TRUE);
+  glDisable(GL_BLEND);
+}
+
+void FlowHints::cleanup() {
+  arrow.cleanup();
+  if (texture)
+    glDeleteTextures(1, &texture);
+  texture = 0;
+  width = height = 0;
+}
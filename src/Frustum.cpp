@@ -0,0 +1,27 @@
+#include "Frustum.h"
+
+Frustum::Frustum(const glm::mat4 &clip) {
+  // glm is column-major: clip[c][r] is row r of column c
+  glm::vec4 rows[4];
+  for (int r = 0; r < 4; ++r)
+    rows[r] = glm::vec4(clip[0][r], clip[1][r], clip[2][r], clip[3][r]);
+  for (int axis = 0; axis < 3; ++axis) {
+    planes[2 * axis] = rows[3] + rows[axis];     // -w <= x
+    planes[2 * axis + 1] = rows[3] - rows[axis]; // x <= w
+  }
+  // Unit normals, so plane distances stay comparable between planes
+  for (glm::vec4 &plane : planes)
+    plane /= glm::length(glm::vec3(plane));
+}
+
+bool Frustum::intersects(const glm::vec3 &min, const glm::vec3 &max) const {
+  for (const glm::vec4 &plane : planes) {
+    // The box corner furthest along the plane's normal
+    glm::vec3 corner(plane.x >= 0.0f ? max.x : min.x,
+                     plane.y >= 0.0f ? max.y : min.y,
+                     plane.z >= 0.0f ? max.z : min.z);
+    if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f)
+      return false;
+  }
+  return true;
+}
@@ -0,0 +1,80 @@
+#include "InstanceBuffer.h"
+#include <algorithm>
+#include <cstddef>
+
+// Store `size` elements of `elementSize` bytes at the start of a buffer,
+// growing it with headroom so a slowly rising count doesn't reallocate
+// often. Unless it grows, only elements [first, last) are written.
+static void store(unsigned int buffer, size_t &capacity, const void *data,
+                  size_t size, size_t elementSize, size_t first,
+                  size_t last) {
+  glBindBuffer(GL_ARRAY_BUFFER, buffer);
+  if (size * elementSize > capacity) {
+    capacity = (size + size / 2) * elementSize;
+    glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_DYNAMIC_DRAW);
+    first = 0;
+    last = size;
+  }
+  last = std::min(last, size);
+  if (first < last)
+    glBufferSubData(GL_ARRAY_BUFFER, first * elementSize,
+                    (last - first) * elementSize,
+                    static_cast<const char *>(data) + first * elementSize);
+}
+
+void InstanceBuffer::ensureBuffers() {
+  if (!VBO)
+    glGenBuffers(1, &VBO);
+  if (!materialVBO)
+    glGenBuffers(1, &materialVBO);
+}
+
+void InstanceBuffer::attach(const Mesh &mesh, bool withMaterials) {
+  ensureBuffers();
+  glBindVertexArray(mesh.VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  // layout(location = 5) = per-instance offset and scale
+  glVertexAttribPointer(PLACEMENT_LOCATION, 4, GL_FLOAT, GL_FALSE,
+                        sizeof(glm::vec4), (void *)0);
+  glEnableVertexAttribArray(PLACEMENT_LOCATION);
+  glVertexAttribDivisor(PLACEMENT_LOCATION, 1);
+
+  if (withMaterials) {
+    // layout(location = 6) = albedo and metallic, (location = 7) = roughness
+    glBindBuffer(GL_ARRAY_BUFFER, materialVBO);
+    glVertexAttribPointer(MATERIAL_LOCATION, 4, GL_FLOAT, GL_FALSE,
+                          sizeof(Material), (void *)0);
+    glEnableVertexAttribArray(MATERIAL_LOCATION);
+    glVertexAttribDivisor(MATERIAL_LOCATION, 1);
+    glVertexAttribPointer(MATERIAL_LOCATION + 1, 1, GL_FLOAT, GL_FALSE,
+                          sizeof(Material),
+                          (void *)offsetof(Material, roughness));
+    glEnableVertexAttribArray(MATERIAL_LOCATION + 1);
+    glVertexAttribDivisor(MATERIAL_LOCATION + 1, 1);
+  }
+  glBindVertexArray(0);
+}
+
+void InstanceBuffer::upload(const std::vector<glm::vec4> &placements,
+                            size_t first, size_t last) {
+  ensureBuffers();
+  count = placements.size();
+  store(VBO, capacity, placements.data(), count, sizeof(glm::vec4), first,
+        last);
+}
+
+void InstanceBuffer::uploadMaterials(const std::vector<Material> &materials,
+                                     size_t first, size_t last) {
+  ensureBuffers();
+  store(materialVBO, materialCapacity, materials.data(), materials.size(),
+        sizeof(Material), first, last);
+}
+
+void InstanceBuffer::cleanup() {
+  if (VBO)
+    glDeleteBuffers(1, &VBO);
+  if (materialVBO)
+    glDeleteBuffers(1, &materialVBO);
+  VBO = materialVBO = 0;
+  capacity = materialCapacity = count = 0;
+}
@@ -1,34 +1,37 @@
 #include "Level.h"
+#include "LevelValidator.h"
 #include <algorithm>
 #include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <utility>
 
-Level::Level(const std::vector<std::string> &gridData, float cellSize)
-    : grid(gridData), cellSize(cellSize) {
-  height = static_cast<int>(grid.size());
-  width = 0;
-
-  for (int y = 0; y < height; ++y) {
-    width = std::max(width, static_cast<int>(grid[y].size()));
-    for (int x = 0; x < static_cast<int>(grid[y].size()); ++x) {
-      if (grid[y][x] == 'S')
-        startPos = {x, y};
-      else if (grid[y][x] == 'G')
-        goalPos = {x, y};
-      else if (grid[y][x] == 'O')
-        holePoss.push_back({x, y});
-    }
-  }
+Level::Level(const std::vector<std::string> &gridData, float cellSize,
+             int sdfSamplesPerCell)
+    : Level(CellGrid::fromText(gridData), cellSize, sdfSamplesPerCell) {}
+
+Level::Level(CellGrid grid, float cellSize, int sdfSamplesPerCell)
+    : cells(std::move(grid)), cellSize(cellSize) {
+  width = cells.getWidth();
+  height = cells.getHeight();
+
+  // Chunk summaries let these skip everything but the marked chunks
+  std::vector<glm::ivec2> marked;
+  cells.collect(CellType::Start, marked);
+  if (!marked.empty())
+    startPos = marked.back();
+  marked.clear();
+  cells.collect(CellType::Goal, marked);
+  if (!marked.empty())
+    goalPos = marked.back();
+  cells.collect(CellType::Hole, holePoss);
+
+  distanceField.bake(*this, sdfSamplesPerCell);
 }
 
 char Level::getCell(int x, int y) const {
-  if (y < 0 || y >= height)
-    return '#';
-  if (x < 0 || x >= static_cast<int>(grid[y].size()))
-    return '#';
-  return grid[y][x];
+  return CellGrid::toChar(cells.get(x, y));
 }
 
 glm::vec3 Level::gridToWorld(int x, int y) const {
@@ -50,7 +53,7 @@ glm::ivec2 Level::worldToGrid(glm::vec3 worldPos) const {
 
 bool Level::isOverHole(glm::vec3 worldPos, float radius) const {
   glm::ivec2 cell = worldToGrid(worldPos);
-  if (getCell(cell.x, cell.y) == 'O') {
+  if (cells.get(cell.x, cell.y) == CellType::Hole) {
     glm::vec3 holeCenter = gridToWorld(cell);
     float dist = glm::length(
         glm::vec2(worldPos.x - holeCenter.x, worldPos.z - holeCenter.z));
@@ -61,7 +64,7 @@ bool Level::isOverHole(glm::vec3 worldPos, float radius) const {
 
 bool Level::isAtGoal(glm::vec3 worldPos, float radius) const {
   glm::ivec2 cell = worldToGrid(worldPos);
-  if (getCell(cell.x, cell.y) == 'G') {
+  if (cells.get(cell.x, cell.y) == CellType::Goal) {
     glm::vec3 goalCenter = gridToWorld(cell);
     float dist = glm::length(
         glm::vec2(worldPos.x - goalCenter.x, worldPos.z - goalCenter.z));
@@ -71,6 +74,25 @@ bool Level::isAtGoal(glm::vec3 worldPos, float radius) const {
 }
 
 glm::vec3 Level::resolveWallCollision(glm::vec3 pos, float radius) const {
+  if (!distanceField.isBaked() || radius >= distanceField.getMaxDistance())
+    return resolveWallCollisionScan(pos, radius);
+
+  // Further lookups only happen when a push lands the ball against another
+  // wall (inside corners)
+  glm::vec3 result = pos;
+  for (int i = 0; i < Config::SDF_PUSH_ITERATIONS; ++i) {
+    DistanceField::Sample s =
+        distanceField.sample(glm::vec2(result.x, result.z));
+    if (s.distance >= radius)
+      break;
+    float overlap = radius - s.distance;
+    result.x += s.gradient.x * overlap;
+    result.z += s.gradient.y * overlap;
+  }
+  return result;
+}
+
+glm::vec3 Level::resolveWallCollisionScan(glm::vec3 pos, float radius) const {
   glm::vec3 result = pos;
   glm::ivec2 cell = worldToGrid(pos);
 
@@ -78,7 +100,7 @@ glm::vec3 Level::resolveWallCollision(glm::vec3 pos, float radius) const {
     for (int dx = -1; dx <= 1; ++dx) {
       int nx = cell.x + dx;
       int ny = cell.y + dy;
-      if (getCell(nx, ny) == '#') {
+      if (cells.isWall(nx, ny)) {
         glm::vec3 wallCenter = gridToWorld(nx, ny);
         float halfSize = cellSize / 2.0f;
         float closestX = std::clamp(result.x, wallCenter.x - halfSize,
@@ -99,15 +121,373 @@ glm::vec3 Level::resolveWallCollision(glm::vec3 pos, float radius) const {
   return result;
 }
 
-// Load a single level from a text file
-static bool loadLevelFromFile(const std::string &filepath, Level &outLevel) {
-  std::ifstream file(filepath);
-  if (!file.is_open()) {
-    std::cerr << "Failed to open level file: " << filepath << std::endl;
+// Ray p + t*d (t in 0..1) against a box [bmin, bmax] inflated by r with
+// rounded corners, i.e. a moving circle against a wall cell. Rays starting
+// inside the inflated box report no hit.
+static bool sweepCircleBox(glm::vec2 p, glm::vec2 d, glm::vec2 bmin,
+                           glm::vec2 bmax, float r, float &tHit,
+                           glm::vec2 &normal) {
+  float tEnter = -INFINITY, tExit = INFINITY;
+  glm::vec2 enterNormal(0.0f);
+  for (int axis = 0; axis < 2; ++axis) {
+    float lo = bmin[axis] - r, hi = bmax[axis] + r;
+    if (std::abs(d[axis]) < 1e-8f) {
+      if (p[axis] < lo || p[axis] > hi)
+        return false;
+      continue;
+    }
+    float t1 = (lo - p[axis]) / d[axis];
+    float t2 = (hi - p[axis]) / d[axis];
+    float sign = -1.0f;
+    if (t1 > t2) {
+      std::swap(t1, t2);
+      sign = 1.0f;
+    }
+    if (t1 > tEnter) {
+      tEnter = t1;
+      enterNormal = glm::vec2(0.0f);
+      enterNormal[axis] = sign;
+    }
+    tExit = std::min(tExit, t2);
+  }
+  if (tEnter < 0.0f || tEnter > 1.0f || tEnter > tExit)
     return false;
+
+  // Entering through a corner region: the rounded corner is a circle
+  glm::vec2 q = p + d * tEnter;
+  bool cornerX = q.x < bmin.x || q.x > bmax.x;
+  bool cornerZ = q.y < bmin.y || q.y > bmax.y;
+  if (cornerX && cornerZ) {
+    glm::vec2 c(q.x < bmin.x ? bmin.x : bmax.x, q.y < bmin.y ? bmin.y : bmax.y);
+    glm::vec2 m = p - c;
+    float a = glm::dot(d, d);
+    float b = glm::dot(m, d);
+    float cc = glm::dot(m, m) - r * r;
+    float disc = b * b - a * cc;
+    if (cc < 0.0f || disc < 0.0f)
+      return false;
+    float t = (-b - std::sqrt(disc)) / a;
+    if (t < 0.0f || t > 1.0f)
+      return false;
+    tHit = t;
+    normal = (p + d * t - c) / r;
+    return true;
   }
 
-  std::vector<std::string> gridData;
+  tHit = tEnter;
+  normal = enterNormal;
+  return true;
+}
+
+Level::SweepHit Level::sweepCircle(glm::vec3 from, glm::vec3 delta,
+                                   float radius) const {
+  SweepHit result;
+
+  // Work in cell units with the board corner at the origin
+  glm::vec2 boardMin(-getBoardWidth() / 2.0f, -getBoardDepth() / 2.0f);
+  glm::vec2 p = (glm::vec2(from.x, from.z) - boardMin) / cellSize;
+  glm::vec2 d = glm::vec2(delta.x, delta.z) / cellSize;
+  float r = radius / cellSize;
+  int reach = static_cast<int>(std::ceil(r));
+
+  // Amanatides-Woo traversal of the cells visited by the circle centre.
+  // Any wall the circle touches while its centre is in a cell lies within
+  // `reach` cells of it, so walls are tested as the centre walks.
+  glm::ivec2 cell(static_cast<int>(std::floor(p.x)),
+                  static_cast<int>(std::floor(p.y)));
+  glm::ivec2 step(d.x > 0.0f ? 1 : -1, d.y > 0.0f ? 1 : -1);
+  glm::vec2 tMax, tDelta;
+  for (int axis = 0; axis < 2; ++axis) {
+    if (std::abs(d[axis]) < 1e-8f) {
+      tMax[axis] = INFINITY;
+      tDelta[axis] = INFINITY;
+    } else {
+      float boundary = float(cell[axis] + (step[axis] > 0 ? 1 : 0));
+      tMax[axis] = (boundary - p[axis]) / d[axis];
+      tDelta[axis] = 1.0f / std::abs(d[axis]);
+    }
+  }
+
+  float bestT = INFINITY;
+  glm::vec2 bestNormal(0.0f);
+  while (true) {
+    for (int dy = -reach; dy <= reach; ++dy) {
+      for (int dx = -reach; dx <= reach; ++dx) {
+        int cx = cell.x + dx, cy = cell.y + dy;
+        if (!cells.isWall(cx, cy))
+          continue;
+        float t;
+        glm::vec2 n;
+        if (sweepCircleBox(p, d, glm::vec2(cx, cy), glm::vec2(cx + 1, cy + 1),
+                           r, t, n) &&
+            t < bestT) {
+          bestT = t;
+          bestNormal = n;
+        }
+      }
+    }
+
+    float tCellExit = std::min(tMax.x, tMax.y);
+    if (bestT <= tCellExit || tCellExit > 1.0f)
+      break;
+    if (tMax.x < tMax.y) {
+      cell.x += step.x;
+      tMax.x += tDelta.x;
+    } else {
+      cell.y += step.y;
+      tMax.y += tDelta.y;
+    }
+  }
+
+  if (bestT <= 1.0f) {
+    result.hit = true;
+    result.time = bestT;
+    result.normal = glm::vec3(bestNormal.x, 0.0f, bestNormal.y);
+    glm::vec3 centre = from + delta * bestT;
+    result.point = centre - result.normal * radius;
+    result.point.y = from.y;
+  }
+  return result;
+}
+
+Level::RayHit Level::raycast(const Ray &ray, uint32_t mask) const {
+  return traceRay(ray, mask, [&](glm::ivec2 c) {
+    return cells.chunkSummary(c.x, c.y).containsAny(mask);
+  });
+}
+
+template <typename ChunkTest>
+Level::RayHit Level::traceRay(const Ray &ray, uint32_t mask,
+                              ChunkTest hasMask) const {
+  RayHit result;
+  const int chunkShift = CellGrid::CHUNK_SHIFT;
+  const int chunk = CellGrid::CHUNK_SIZE;
+
+  // Cell units with the board corner at the origin; t stays in world units
+  // along the (unit) ray direction
+  glm::vec2 boardMin(-getBoardWidth() / 2.0f, -getBoardDepth() / 2.0f);
+  glm::vec2 p = (glm::vec2(ray.origin.x, ray.origin.z) - boardMin) / cellSize;
+  glm::vec2 d = glm::vec2(ray.direction.x, ray.direction.z) / cellSize;
+
+  glm::ivec2 cell(static_cast<int>(std::floor(p.x)),
+                  static_cast<int>(std::floor(p.y)));
+  glm::ivec2 step(d.x > 0.0f ? 1 : -1, d.y > 0.0f ? 1 : -1);
+  glm::vec2 tMax, tDelta;
+  auto cellBoundary = [&](int axis) {
+    if (std::abs(d[axis]) < 1e-8f)
+      return INFINITY;
+    float boundary = float(cell[axis] + (step[axis] > 0 ? 1 : 0));
+    return (boundary - p[axis]) / d[axis];
+  };
+  for (int axis = 0; axis < 2; ++axis) {
+    tMax[axis] = cellBoundary(axis);
+    tDelta[axis] =
+        std::abs(d[axis]) < 1e-8f ? INFINITY : 1.0f / std::abs(d[axis]);
+  }
+
+  float t = 0.0f;
+  int axis = -1; // Axis of the last step (-1: still in the start cell)
+  while (true) {
+    if (mask & cellBit(cells.get(cell.x, cell.y))) {
+      result.hit = true;
+      result.distance = t;
+      result.cell = cell;
+      result.point = ray.origin + ray.direction * t;
+      if (axis >= 0) {
+        glm::vec2 n(0.0f);
+        n[axis] = float(-step[axis]);
+        result.normal = glm::vec3(n.x, 0.0f, n.y);
+      }
+      return result;
+    }
+
+    // Off the board and heading further away: nothing left to hit
+    if ((cell.x < 0 && d.x <= 0.0f) || (cell.x >= width && d.x >= 0.0f) ||
+        (cell.y < 0 && d.y <= 0.0f) || (cell.y >= height && d.y >= 0.0f))
+      return result;
+
+    glm::ivec2 c(cell.x >> chunkShift, cell.y >> chunkShift);
+    bool onBoard = c.x >= 0 && c.y >= 0 && c.x < cells.getChunksX() &&
+                   c.y < cells.getChunksY();
+    if (onBoard && !hasMask(c)) {
+      // Nothing to hit in this chunk: jump straight to where the ray
+      // leaves it
+      glm::ivec2 lo = c * chunk, hi = lo + chunk - 1;
+      glm::vec2 tExit;
+      for (int a = 0; a < 2; ++a) {
+        float edge = float(step[a] > 0 ? hi[a] + 1 : lo[a]);
+        tExit[a] = std::abs(d[a]) < 1e-8f ? INFINITY : (edge - p[a]) / d[a];
+      }
+      axis = tExit.x < tExit.y ? 0 : 1;
+      int other = 1 - axis;
+      t = tExit[axis];
+      cell[axis] = step[axis] > 0 ? hi[axis] + 1 : lo[axis] - 1;
+      cell[other] = std::clamp(
+          static_cast<int>(std::floor(p[other] + d[other] * t)), lo[other],
+          hi[other]);
+      tMax.x = cellBoundary(0);
+      tMax.y = cellBoundary(1);
+    } else {
+      axis = tMax.x < tMax.y ? 0 : 1;
+      t = tMax[axis];
+      cell[axis] += step[axis];
+      tMax[axis] += tDelta[axis];
+    }
+    if (t > ray.maxDistance)
+      return result;
+  }
+}
+
+Level::RayHit Level::sphereCast(const Ray &ray, float radius) const {
+  std::vector<glm::ivec2> touching;
+  return castSphere(ray, radius, touching);
+}
+
+Level::RayHit Level::castSphere(const Ray &ray, float radius,
+                                std::vector<glm::ivec2> &touching) const {
+  RayHit result;
+  touching.clear();
+  if (overlapCircle(ray.origin, radius, touching) > 0) {
+    result.hit = true;
+    result.cell = touching.front();
+    result.point = ray.origin;
+    return result;
+  }
+
+  SweepHit sweep =
+      sweepCircle(ray.origin, ray.direction * ray.maxDistance, radius);
+  if (sweep.hit) {
+    result.hit = true;
+    result.distance = sweep.time * ray.maxDistance;
+    result.point = ray.origin + ray.direction * result.distance;
+    result.normal = sweep.normal;
+    result.cell = worldToGrid(sweep.point - sweep.normal * (cellSize * 0.5f));
+  }
+  return result;
+}
+
+size_t Level::overlapCircle(glm::vec3 centre, float radius,
+                            std::vector<glm::ivec2> &out,
+                            uint32_t mask) const {
+  glm::vec2 boardMin(-getBoardWidth() / 2.0f, -getBoardDepth() / 2.0f);
+  glm::vec2 c = (glm::vec2(centre.x, centre.z) - boardMin) / cellSize;
+  float r = radius / cellSize;
+  // Not clamped to the board: like everywhere else, off the board is wall
+  glm::ivec2 lo(glm::floor(c - r)), hi(glm::floor(c + r));
+
+  size_t found = 0;
+  for (int y = lo.y; y <= hi.y; ++y) {
+    for (int x = lo.x; x <= hi.x; ++x) {
+      if (!(mask & cellBit(cells.get(x, y))))
+        continue;
+      glm::vec2 closest =
+          glm::clamp(c, glm::vec2(x, y), glm::vec2(x + 1, y + 1));
+      glm::vec2 offset = c - closest;
+      if (glm::dot(offset, offset) < r * r) {
+        out.push_back({x, y});
+        found++;
+      }
+    }
+  }
+  return found;
+}
+
+namespace {
+
+// Whether each chunk holds a cell in `mask`, looked up once per batch
+class ChunkMemo {
+public:
+  ChunkMemo(const CellGrid &cells, uint32_t mask)
+      : cells(cells), mask(mask),
+        state(static_cast<size_t>(cells.getChunksX()) * cells.getChunksY(),
+              UNKNOWN) {}
+
+  bool hasMask(glm::ivec2 c) {
+    uint8_t &known = state[static_cast<size_t>(c.y) * cells.getChunksX() +
+                           c.x];
+    if (known == UNKNOWN)
+      known = cells.chunkSummary(c.x, c.y).containsAny(mask) ? 1 : 0;
+    return known != 0;
+  }
+
+private:
+  static constexpr uint8_t UNKNOWN = 2;
+  const CellGrid &cells;
+  uint32_t mask;
+  std::vector<uint8_t> state;
+};
+
+} // namespace
+
+std::vector<uint32_t> Level::castOrder(const Ray *rays, size_t count) const {
+  std::vector<uint32_t> order(count);
+  if (static_cast<int64_t>(width) * height < Config::RAYCAST_GROUP_MIN_CELLS) {
+    for (size_t i = 0; i < count; ++i)
+      order[i] = static_cast<uint32_t>(i);
+    return order;
+  }
+
+  // Counting sort on the start chunk; off-board origins go in a last bucket
+  size_t chunks = static_cast<size_t>(cells.getChunksX()) * cells.getChunksY();
+  std::vector<uint32_t> bucket(count), start(chunks + 2, 0);
+  for (size_t i = 0; i < count; ++i) {
+    glm::ivec2 cell = worldToGrid(rays[i].origin);
+    size_t chunk = chunks;
+    if (cell.x >= 0 && cell.y >= 0 && cell.x < width && cell.y < height)
+      chunk = static_cast<size_t>(cell.y >> CellGrid::CHUNK_SHIFT) *
+                  cells.getChunksX() +
+              (cell.x >> CellGrid::CHUNK_SHIFT);
+    bucket[i] = static_cast<uint32_t>(chunk);
+    start[chunk + 1]++;
+  }
+  for (size_t c = 1; c < start.size(); ++c)
+    start[c] += start[c - 1];
+  for (size_t i = 0; i < count; ++i)
+    order[start[bucket[i]]++] = static_cast<uint32_t>(i);
+  return order;
+}
+
+void Level::raycast(const Ray *rays, size_t count, RayHit *hits,
+                    uint32_t mask) const {
+  ChunkMemo chunks(cells, mask);
+  auto hasMask = [&chunks](glm::ivec2 c) { return chunks.hasMask(c); };
+  for (uint32_t i : castOrder(rays, count))
+    hits[i] = traceRay(rays[i], mask, hasMask);
+}
+
+void Level::sphereCast(const Ray *rays, size_t count, float radius,
+                       RayHit *hits) const {
+  ChunkMemo walls(cells, cellBit(CellType::Wall));
+  std::vector<glm::ivec2> touching;
+  glm::vec2 boardMin(-getBoardWidth() / 2.0f, -getBoardDepth() / 2.0f);
+  float r = radius / cellSize;
+  for (uint32_t i : castOrder(rays, count)) {
+    const Ray &ray = rays[i];
+    // Cells under the box around the whole sweep. If it stays on the board
+    // and inside chunks without walls, nothing can be touched.
+    glm::vec2 from = (glm::vec2(ray.origin.x, ray.origin.z) - boardMin) /
+                     cellSize;
+    glm::vec2 to = from + glm::vec2(ray.direction.x, ray.direction.z) *
+                              (ray.maxDistance / cellSize);
+    glm::ivec2 lo(glm::floor(glm::min(from, to) - r));
+    glm::ivec2 hi(glm::floor(glm::max(from, to) + r));
+    bool clear = lo.x >= 0 && lo.y >= 0 && hi.x < width && hi.y < height;
+    for (int cy = lo.y >> CellGrid::CHUNK_SHIFT;
+         clear && cy <= hi.y >> CellGrid::CHUNK_SHIFT; ++cy) {
+      for (int cx = lo.x >> CellGrid::CHUNK_SHIFT;
+           clear && cx <= hi.x >> CellGrid::CHUNK_SHIFT; ++cx)
+        clear = !walls.hasMask(glm::ivec2(cx, cy));
+    }
+    hits[i] = clear ? RayHit() : castSphere(ray, radius, touching);
+  }
+}
+
+bool LevelManager::readLevelFile(const std::string &filepath,
+                                 std::vector<std::string> &rows) {
+  std::ifstream file(filepath);
+  if (!file.is_open())
+    return false;
+
   std::string line;
   while (std::getline(file, line)) {
     // Skip empty lines and trim whitespace
@@ -117,43 +497,63 @@ static bool loadLevelFromFile(const std::string &filepath, Level &outLevel) {
         line.pop_back();
       }
       if (!line.empty()) {
-        gridData.push_back(line);
+        rows.push_back(line);
       }
     }
   }
-
-  if (gridData.empty()) {
-    std::cerr << "Level file is empty: " << filepath << std::endl;
-    return false;
-  }
-
-  outLevel = Level(gridData, 1.0f);
   return true;
 }
 
-void LevelManager::loadBuiltInLevels() {
-  levels.clear();
-
-  const std::string levelsDir = "assets/levels";
-
+std::vector<std::string>
+LevelManager::listLevelFiles(const std::string &directory) {
   // Collect all .txt files in the levels directory
   std::vector<std::string> levelFiles;
   try {
-    for (const auto &entry : std::filesystem::directory_iterator(levelsDir)) {
+    for (const auto &entry : std::filesystem::directory_iterator(directory)) {
       if (entry.is_regular_file() && entry.path().extension() == ".txt") {
         levelFiles.push_back(entry.path().string());
       }
     }
   } catch (const std::filesystem::filesystem_error &e) {
     std::cerr << "Failed to read levels directory: " << e.what() << std::endl;
-    return;
+    return {};
   }
 
   // Sort files alphabetically (level1.txt, level2.txt, etc.)
   std::sort(levelFiles.begin(), levelFiles.end());
+  return levelFiles;
+}
+
+// Load a single level from a text file
+static bool loadLevelFromFile(const std::string &filepath, Level &outLevel) {
+  std::vector<std::string> gridData;
+  if (!LevelManager::readLevelFile(filepath, gridData)) {
+    std::cerr << "Failed to open level file: " << filepath << std::endl;
+    return false;
+  }
+
+  if (gridData.empty()) {
+    std::cerr << "Level file is empty: " << filepath << std::endl;
+    return false;
+  }
+
+  // Loading only checks the file; MarbleTool validate checks the layout,
+  // but an unsolvable built-in level is worth a warning
+  LevelValidator::Report report;
+  LevelValidator().validate(CellGrid::fromText(gridData), report);
+  if (!report.isValid())
+    std::cerr << "Warning: " << filepath
+              << " has no single start with a route to the goal" << std::endl;
+
+  outLevel = Level(gridData, 1.0f);
+  return true;
+}
+
+void LevelManager::loadBuiltInLevels() {
+  levels.clear();
 
   // Load each level file
-  for (const auto &filepath : levelFiles) {
+  for (const auto &filepath : listLevelFiles("assets/levels")) {
     Level level;
     if (loadLevelFromFile(filepath, level)) {
       levels.push_back(std::move(level));
@@ -0,0 +1,175 @@
+#include "LevelEditor.h"
+#include <algorithm>
+#include <chrono>
+#include <climits>
+#include <cmath>
+
+void LevelEditor::attach(Level &newLevel, BoardGenerator::BoardMeshes &meshes,
+                         InstanceBuffer &markerBuffer, FlowField &flowField) {
+  level = &newLevel;
+  board = &meshes;
+  markers = &markerBuffer;
+  flow = &flowField;
+  lastEdit = Stats();
+}
+
+bool LevelEditor::pick(glm::vec2 ndc, const glm::mat4 &inverseClip,
+                       glm::ivec2 &cell) const {
+  if (!level)
+    return false;
+  glm::vec4 nearPoint = inverseClip * glm::vec4(ndc, -1.0f, 1.0f);
+  glm::vec4 farPoint = inverseClip * glm::vec4(ndc, 1.0f, 1.0f);
+  glm::vec3 from = glm::vec3(nearPoint) / nearPoint.w;
+  glm::vec3 direction = glm::vec3(farPoint) / farPoint.w - from;
+  if (std::abs(direction.y) < 1e-6f)
+    return false;
+
+  // Cell where the cursor ray crosses the plane at `height`
+  auto cross = [&](float height, glm::ivec2 &out) {
+    float t = (height - from.y) / direction.y;
+    if (t < 0.0f)
+      return false;
+    glm::vec3 p = from + direction * t;
+    glm::vec2 local =
+        (glm::vec2(p.x + level->getBoardWidth() / 2.0f,
+                   p.z + level->getBoardDepth() / 2.0f)) /
+        level->cellSize;
+    out = glm::ivec2(static_cast<int>(std::floor(local.x)),
+                     static_cast<int>(std::floor(local.y)));
+    return out.x >= 0 && out.y >= 0 && out.x < level->width &&
+           out.y < level->height;
+  };
+  float wallTop = level->cellSize * Config::WALL_HEIGHT_RATIO;
+  if (cross(wallTop, cell) && level->isWall(cell.x, cell.y))
+    return true;
+  return cross(0.0f, cell);
+}
+
+bool LevelEditor::paint(glm::ivec2 cell, CellType type) {
+  if (!level || cell.x < 0 || cell.y < 0 || cell.x >= level->width ||
+      cell.y >= level->height)
+    return false;
+  CellType old = level->cells.at(cell.x, cell.y);
+  if (old == type || old == CellType::Start || old == CellType::Goal)
+    return false;
+
+  auto begin = std::chrono::steady_clock::now();
+  changed.clear();
+  dirtyChunks.clear();
+  wallMin = glm::ivec2(INT_MAX);
+  wallMax = glm::ivec2(INT_MIN);
+  markerFirst = SIZE_MAX;
+  markerLast = 0;
+  markersChanged = false;
+
+  bool goalMoved = false;
+  if (type == CellType::Start) {
+    setCell(level->startPos, CellType::Floor);
+    level->startPos = cell;
+    setMarker(BoardGenerator::START_MARKER, cell, type);
+  } else if (type == CellType::Goal) {
+    setCell(level->goalPos, CellType::Floor);
+    level->goalPos = cell;
+    setMarker(BoardGenerator::GOAL_MARKER, cell, type);
+    goalMoved = true;
+  }
+  setCell(cell, type);
+
+  // Faces and collision only depend on which cells are walls
+  if (wallMin.x <= wallMax.x) {
+    level->distanceField.update(*level, wallMin, wallMax);
+    for (const glm::ivec2 &chunk : dirtyChunks)
+      BoardGenerator::rebuildChunk(
+          *level, chunk.x, chunk.y,
+          board->chunks[static_cast<size_t>(chunk.y) * board->chunksX +
+                        chunk.x],
+          floorScratch, wallScratch, meshScratch);
+  }
+
+  if (markersChanged) {
+    markers->upload(board->markerPlacements, markerFirst, markerLast);
+    markers->uploadMaterials(board->markerMaterials, markerFirst, markerLast);
+  }
+
+  if (goalMoved)
+    flow->build(level->cells, level->goalPos);
+  else
+    flow->update(level->cells, changed);
+
+  lastEdit.cells = static_cast<int>(changed.size());
+  lastEdit.chunks = static_cast<int>(dirtyChunks.size());
+  lastEdit.milliseconds = std::chrono::duration<double, std::milli>(
+                              std::chrono::steady_clock::now() - begin)
+                              .count();
+  return true;
+}
+
+void LevelEditor::setCell(glm::ivec2 cell, CellType type) {
+  CellType old = level->cells.at(cell.x, cell.y);
+  if (old == type)
+    return;
+  if (old == CellType::Hole)
+    removeHoleMarker(cell);
+  if (type == CellType::Hole) {
+    level->holePoss.push_back(cell);
+    setMarker(BoardGenerator::FIRST_HOLE_MARKER + level->holePoss.size() - 1,
+              cell, type);
+  }
+  level->cells.set(cell.x, cell.y, type);
+  changed.push_back(cell);
+
+  if ((old == CellType::Wall) == (type == CellType::Wall))
+    return;
+  wallMin = glm::min(wallMin, cell);
+  wallMax = glm::max(wallMax, cell);
+  // The cell's own chunk, and those of the neighbours whose sides face it
+  static const glm::ivec2 AROUND[5] = {
+      {0, 0}, {1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+  for (glm::ivec2 step : AROUND) {
+    glm::ivec2 next = cell + step;
+    if (next.x < 0 || next.y < 0 || next.x >= level->width ||
+        next.y >= level->height)
+      continue;
+    glm::ivec2 chunk = next / Config::BOARD_CHUNK_CELLS;
+    if (std::find(dirtyChunks.begin(), dirtyChunks.end(), chunk) ==
+        dirtyChunks.end())
+      dirtyChunks.push_back(chunk);
+  }
+}
+
+void LevelEditor::setMarker(size_t index, glm::ivec2 cell, CellType type) {
+  std::vector<glm::vec4> &placements = board->markerPlacements;
+  std::vector<InstanceBuffer::Material> &materials = board->markerMaterials;
+  if (index == placements.size()) {
+    placements.emplace_back();
+    materials.emplace_back();
+  }
+  placements[index] = BoardGenerator::markerPlacement(*level, cell, type);
+  materials[index] = BoardGenerator::markerMaterial(type);
+  markerFirst = std::min(markerFirst, index);
+  markerLast = std::max(markerLast, index + 1);
+  markersChanged = true;
+}
+
+// Holes are unordered, so the last one takes the removed one's place
+void LevelEditor::removeHoleMarker(glm::ivec2 cell) {
+  std::vector<glm::ivec2> &holes = level->holePoss;
+  auto it = std::find(holes.begin(), holes.end(), cell);
+  if (it == holes.end())
+    return;
+  size_t hole = static_cast<size_t>(it - holes.begin());
+  size_t index = BoardGenerator::FIRST_HOLE_MARKER + hole;
+  std::vector<glm::vec4> &placements = board->markerPlacements;
+  std::vector<InstanceBuffer::Material> &materials = board->markerMaterials;
+  *it = holes.back();
+  holes.pop_back();
+  placements[index] = placements.back();
+  placements.pop_back();
+  materials[index] = materials.back();
+  materials.pop_back();
+  if (index < placements.size()) {
+    markerFirst = std::min(markerFirst, index);
+    markerLast = std::max(markerLast, index + 1);
+  }
+  markersChanged = true;
+}
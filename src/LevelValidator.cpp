@@ -0,0 +1,219 @@
+#include "LevelValidator.h"
+#include "Level.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <bitset>
+#include <climits>
+
+static bool isOpen(CellType type) {
+  return type == CellType::Floor || type == CellType::Start ||
+         type == CellType::Goal;
+}
+
+static const glm::ivec2 STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+void LevelValidator::validate(const CellGrid &cells, Report &report) {
+  report.loaded = true;
+  report.width = cells.getWidth();
+  report.height = cells.getHeight();
+  report.starts = static_cast<int>(cells.count(CellType::Start));
+  report.goals = static_cast<int>(cells.count(CellType::Goal));
+  report.reachable = false;
+  report.pathLength = -1;
+  report.reachableCells = 0;
+  report.chokePoints.clear();
+  report.unreachableHoles.clear();
+  if (report.starts == 0 || report.goals == 0)
+    return;
+
+  // Same choice as the Level constructor when a marker appears twice
+  std::vector<glm::ivec2> marked;
+  cells.collect(CellType::Start, marked);
+  glm::ivec2 start = marked.back();
+  marked.clear();
+  cells.collect(CellType::Goal, marked);
+  glm::ivec2 goal = marked.back();
+
+  pack(cells);
+  report.pathLength = search(start, goal);
+  report.reachable = report.pathLength >= 0;
+  for (uint64_t word : visited)
+    report.reachableCells += std::bitset<64>(word).count();
+
+  if (report.reachable)
+    findChokePoints(start, goal, report.chokePoints);
+  findUnreachableHoles(cells, report.unreachableHoles);
+}
+
+void LevelValidator::pack(const CellGrid &cells) {
+  width = cells.getWidth();
+  height = cells.getHeight();
+  rowWords = (width + 63) >> 6;
+  size_t words = static_cast<size_t>(height + 2) * rowWords;
+  for (std::vector<uint64_t> *bits : {&open, &visited, &frontier, &next})
+    bits->assign(words, 0);
+
+  // Chunk by chunk: all-wall and all-hole chunks are skipped outright, and
+  // each chunk row is a run of CHUNK_SIZE bytes. Off-board padding cells
+  // are walls, so whole chunk rows can be read.
+  const int size = CellGrid::CHUNK_SIZE;
+  for (int cy = 0; cy < cells.getChunksY(); ++cy) {
+    for (int cx = 0; cx < cells.getChunksX(); ++cx) {
+      if (!cells.chunkSummary(cx, cy).containsAny(
+              cellBit(CellType::Floor) | cellBit(CellType::Start) |
+              cellBit(CellType::Goal)))
+        continue;
+      const CellType *chunk = cells.chunkData(cx, cy);
+      int rows = std::min(size, height - cy * size);
+      for (int r = 0; r < rows; ++r) {
+        int x0 = cx * size;
+        uint64_t bits = 0;
+        for (int i = 0; i < size; ++i)
+          bits |= uint64_t(isOpen(chunk[r * size + i])) << i;
+        open[wordIndex(x0, cy * size + r)] |= bits << (x0 & 63);
+      }
+    }
+  }
+}
+
+int LevelValidator::search(glm::ivec2 start, glm::ivec2 goal) {
+  uint64_t startBit = uint64_t(1) << (start.x & 63);
+  visited[wordIndex(start.x, start.y)] |= startBit;
+  frontier[wordIndex(start.x, start.y)] |= startBit;
+
+  // Rows [lo, hi] hold the whole frontier; everything else is zero
+  int lo = start.y, hi = start.y;
+  int layer = 0;
+  int found = start == goal ? 0 : -1;
+  while (lo <= hi) {
+    layer++;
+    int from = std::max(lo - 1, 0), to = std::min(hi + 1, height - 1);
+    int newLo = INT_MAX, newHi = -1;
+    for (int y = from; y <= to; ++y) {
+      const uint64_t *up = &frontier[wordIndex(0, y - 1)];
+      const uint64_t *row = &frontier[wordIndex(0, y)];
+      const uint64_t *down = &frontier[wordIndex(0, y + 1)];
+      const uint64_t *mask = &open[wordIndex(0, y)];
+      uint64_t *seen = &visited[wordIndex(0, y)];
+      uint64_t *out = &next[wordIndex(0, y)];
+      uint64_t any = 0;
+      for (int w = 0; w < rowWords; ++w) {
+        uint64_t c = row[w];
+        uint64_t spread = c | (c << 1) | (c >> 1) | up[w] | down[w];
+        // Carries between neighbouring words of the row
+        if (w > 0)
+          spread |= row[w - 1] >> 63;
+        if (w + 1 < rowWords)
+          spread |= row[w + 1] << 63;
+        uint64_t fresh = spread & mask[w] & ~seen[w];
+        out[w] = fresh;
+        seen[w] |= fresh;
+        any |= fresh;
+      }
+      if (any) {
+        newLo = std::min(newLo, y);
+        newHi = y;
+      }
+    }
+
+    std::fill(frontier.begin() + wordIndex(0, lo),
+              frontier.begin() + wordIndex(0, hi + 1), 0);
+    std::swap(frontier, next);
+    lo = newLo;
+    hi = newHi;
+    if (found < 0 && lo <= hi && testBit(frontier, goal.x, goal.y))
+      found = layer;
+  }
+  return found;
+}
+
+void LevelValidator::findChokePoints(glm::ivec2 start, glm::ivec2 goal,
+                                     std::vector<glm::ivec2> &out) {
+  // Iterative Tarjan over the reachable cells. A cell v is a choke point
+  // when one of its DFS children leads to the goal and cannot climb above v
+  // any other way (low[child] >= order[v]).
+  size_t cellCount = static_cast<size_t>(width) * height;
+  order.assign(cellCount, 0);
+  low.resize(cellCount);
+  toGoal.resize(cellCount);
+
+  struct Frame {
+    int cell;
+    int step;
+  };
+  std::vector<Frame> stack;
+  int counter = 1;
+  int startCell = start.y * width + start.x;
+  int goalCell = goal.y * width + goal.x;
+  auto enter = [&](int cell) {
+    order[cell] = low[cell] = counter++;
+    toGoal[cell] = cell == goalCell;
+    stack.push_back(Frame{cell, 0});
+  };
+  enter(startCell);
+
+  size_t firstChoke = out.size();
+  while (!stack.empty()) {
+    Frame &frame = stack.back();
+    if (frame.step < 4) {
+      glm::ivec2 n = glm::ivec2(frame.cell % width, frame.cell / width) +
+                     STEPS[frame.step++];
+      if (n.x < 0 || n.y < 0 || n.x >= width || n.y >= height ||
+          !testBit(open, n.x, n.y))
+        continue;
+      int cell = n.y * width + n.x;
+      if (order[cell] == 0)
+        enter(cell);
+      else
+        low[frame.cell] = std::min(low[frame.cell], order[cell]);
+      continue;
+    }
+
+    int child = frame.cell;
+    stack.pop_back();
+    if (stack.empty())
+      break;
+    int parent = stack.back().cell;
+    low[parent] = std::min(low[parent], low[child]);
+    if (toGoal[child]) {
+      toGoal[parent] = 1;
+      if (parent != startCell && low[child] >= order[parent])
+        out.push_back({parent % width, parent / width});
+    }
+  }
+  // Found goal-first; report them in the order the ball meets them
+  std::reverse(out.begin() + firstChoke, out.end());
+}
+
+void LevelValidator::findUnreachableHoles(const CellGrid &cells,
+                                          std::vector<glm::ivec2> &out) {
+  std::vector<glm::ivec2> holes;
+  cells.collect(CellType::Hole, holes);
+  for (glm::ivec2 hole : holes) {
+    bool touched = false;
+    for (glm::ivec2 step : STEPS) {
+      glm::ivec2 n = hole + step;
+      if (n.x >= 0 && n.y >= 0 && n.x < width && n.y < height &&
+          testBit(visited, n.x, n.y))
+        touched = true;
+    }
+    if (!touched)
+      out.push_back(hole);
+  }
+}
+
+std::vector<LevelValidator::Report>
+LevelValidator::validateFiles(const std::vector<std::string> &paths,
+                              ThreadPool &pool) {
+  std::vector<Report> reports(paths.size());
+  std::vector<LevelValidator> validators(pool.getThreadCount());
+  pool.parallelFor(paths.size(), [&](size_t i, unsigned worker) {
+    Report &report = reports[i];
+    report.path = paths[i];
+    std::vector<std::string> rows;
+    if (!LevelManager::readLevelFile(paths[i], rows) || rows.empty())
+      return;
+    validators[worker].validate(CellGrid::fromText(rows), report);
+  });
+  return reports;
+}
@@ -0,0 +1,345 @@
+// MarbleTool - Headless utilities for the marble maze (no window or GL).
+//
+//   MarbleTool verify <replay>...   Re-simulate replays and check them
+//   MarbleTool info <replay>...     Print what a replay contains
+//   MarbleTool validate [-v] [-j threads] <dir|level>...
+//                                   Check that levels can be solved
+//   MarbleTool play [-n attempts] [-j threads] [-s seed] <dir|level>...
+//                                   Estimate difficulty with the autoplayer
+//   MarbleTool maze [-a algorithm] [-s seed] [-d holes] [-j threads]
+//                   [-o level] <width> <height>
+//                                   Generate a maze level
+//
+// Levels are loaded from assets/levels relative to the working directory
+// and matched to replays by content hash.
+
+#include "Autoplayer.h"
+#include "Level.h"
+#include "LevelValidator.h"
+#include "MazeGenerator.h"
+#include "Replay.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+static const char *phaseName(GamePhase phase) {
+  switch (phase) {
+  case GamePhase::Won:
+    return "won";
+  case GamePhase::Failed:
+    return "failed";
+  default:
+    return "unfinished";
+  }
+}
+
+static const Level *findLevel(const LevelManager &levels, uint64_t hash,
+                              int &index) {
+  for (size_t i = 0; i < levels.levels.size(); ++i) {
+    if (Replay::hashLevel(levels.levels[i]) == hash) {
+      index = static_cast<int>(i);
+      return &levels.levels[i];
+    }
+  }
+  return nullptr;
+}
+
+static int usage() {
+  std::fprintf(stderr,
+               "usage: MarbleTool verify <replay>...\n"
+               "       MarbleTool info <replay>...\n"
+               "       MarbleTool validate [-v] [-j threads] <dir|level>...\n"
+               "       MarbleTool play [-n attempts] [-j threads] [-s seed] "
+               "<dir|level>...\n"
+               "       MarbleTool maze [-a backtracker|wilson|rooms] "
+               "[-s seed] [-d holes] [-j threads]\n"
+               "                       [-o level] <width> <height>\n");
+  return 2;
+}
+
+static void printCells(const char *label,
+                       const std::vector<glm::ivec2> &cells) {
+  std::printf("    %s:", label);
+  for (glm::ivec2 cell : cells)
+    std::printf(" (%d,%d)", cell.x, cell.y);
+  std::printf("\n");
+}
+
+// A level argument: a level file, or a directory of them
+static void addLevelPaths(const char *arg, std::vector<std::string> &paths) {
+  if (std::filesystem::is_directory(arg)) {
+    for (std::string &path : LevelManager::listLevelFiles(arg))
+      paths.push_back(std::move(path));
+  } else {
+    paths.push_back(arg);
+  }
+}
+
+static double secondsSince(std::chrono::steady_clock::time_point begin) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                       begin)
+      .count();
+}
+
+// Checks every level named or found in a named directory. Rejected levels
+// are always listed; -v lists the rest too, with their choke points.
+static int validateLevels(int argc, char **argv) {
+  bool verbose = false;
+  unsigned threads = 0;
+  std::vector<std::string> paths;
+  for (int i = 2; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-v") == 0)
+      verbose = true;
+    else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else
+      addLevelPaths(argv[i], paths);
+  }
+  if (paths.empty())
+    return usage();
+
+  ThreadPool pool(threads);
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<LevelValidator::Report> reports =
+      LevelValidator::validateFiles(paths, pool);
+  double seconds = secondsSince(begin);
+
+  int rejected = 0;
+  for (const LevelValidator::Report &report : reports) {
+    bool valid = report.isValid();
+    rejected += valid ? 0 : 1;
+    if (valid && !verbose)
+      continue;
+
+    const char *path = report.path.c_str();
+    if (!report.loaded) {
+      std::printf("%s: FAIL (not a readable level)\n", path);
+    } else if (report.starts != 1 || report.goals != 1) {
+      std::printf("%s: FAIL (%d starts, %d goals)\n", path, report.starts,
+                  report.goals);
+    } else if (!report.reachable) {
+      std::printf("%s: FAIL (goal unreachable, %zu cells reachable)\n", path,
+                  report.reachableCells);
+    } else {
+      std::printf("%s: OK, %dx%d, %d moves, %zu choke points, "
+                  "%zu unreachable holes\n",
+                  path, report.width, report.height, report.pathLength,
+                  report.chokePoints.size(), report.unreachableHoles.size());
+    }
+    if (verbose && !report.chokePoints.empty())
+      printCells("choke points", report.chokePoints);
+    if (verbose && !report.unreachableHoles.empty())
+      printCells("unreachable holes", report.unreachableHoles);
+  }
+
+  std::printf("%zu levels, %d rejected, in %.1f ms on %u threads "
+              "(%.0f levels/s)\n",
+              reports.size(), rejected, seconds * 1000.0,
+              pool.getThreadCount(),
+              seconds > 0.0 ? reports.size() / seconds : 0.0);
+  return rejected ? 1 : 0;
+}
+
+// Grades each level with the autoplayer: solve rate, median time to the
+// goal and how often the ball ends in a hole, plus rollout throughput
+static int playLevels(int argc, char **argv) {
+  Autoplayer::Settings settings;
+  unsigned threads = 0;
+  std::vector<std::string> paths;
+  for (int i = 2; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-n") == 0 && i + 1 < argc)
+      settings.attempts = std::max(1, std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+      threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc)
+      settings.seed = std::strtoull(argv[++i], nullptr, 10);
+    else
+      addLevelPaths(argv[i], paths);
+  }
+  if (paths.empty())
+    return usage();
+
+  // Building a level bakes its distance field, so load on the pool too
+  ThreadPool pool(threads);
+  std::vector<Level> levels(paths.size());
+  std::vector<char> loaded(paths.size(), 0);
+  pool.parallelFor(paths.size(), [&](size_t i, unsigned) {
+    std::vector<std::string> rows;
+    if (LevelManager::readLevelFile(paths[i], rows) && !rows.empty()) {
+      levels[i] = Level(rows, Config::CELL_SIZE);
+      loaded[i] = 1;
+    }
+  });
+  std::vector<const Level *> playable;
+  std::vector<size_t> playableIndex;
+  for (size_t i = 0; i < paths.size(); ++i) {
+    if (loaded[i]) {
+      playable.push_back(&levels[i]);
+      playableIndex.push_back(i);
+    } else {
+      std::printf("%s: not a readable level\n", paths[i].c_str());
+    }
+  }
+
+  auto begin = std::chrono::steady_clock::now();
+  std::vector<Autoplayer::LevelResult> results =
+      Autoplayer::grade(playable, settings, pool);
+  double seconds = secondsSince(begin);
+
+  uint64_t rollouts = 0, ticks = 0;
+  for (size_t i = 0; i < results.size(); ++i) {
+    const Autoplayer::LevelResult &result = results[i];
+    std::printf("%s: solved %.0f%% (%d/%d), median %.2f s, fell %.0f%%, "
+                "timed out %d\n",
+                paths[playableIndex[i]].c_str(), result.solveRate * 100.0f,
+                result.solved, result.attempts, result.medianSeconds,
+                result.fallRate * 100.0f, result.timedOut);
+    rollouts += result.rollouts;
+    ticks += result.ticks;
+  }
+
+  // Per thread (one per hardware thread by default), so packs graded on
+  // different machines can be compared
+  threads = pool.getThreadCount();
+  double perThread = seconds > 0.0 ? 1.0 / (seconds * threads) : 0.0;
+  std::printf("%zu levels x %d attempts in %.2f s on %u threads: "
+              "%llu rollouts, %.0f rollouts/s per thread "
+              "(%.2f M ball updates/s per thread)\n",
+              results.size(), settings.attempts, seconds, threads,
+              static_cast<unsigned long long>(rollouts), rollouts * perThread,
+              ticks * perThread / 1e6);
+  return playable.size() == paths.size() ? 0 : 1;
+}
+
+// Generates one maze, reports how long it and the Level built from it took,
+// and optionally writes it out as a level file
+static int generateMaze(int argc, char **argv) {
+  MazeGenerator::Settings settings;
+  unsigned threads = 0;
+  const char *output = nullptr;
+  std::vector<int> size;
+  for (int i = 2; i < argc; ++i) {
+    if (std::strcmp(argv[i], "-a") == 0 && i + 1 < argc) {
+      if (!MazeGenerator::parseAlgorithm(argv[++i], settings.algorithm))
+        return usage();
+    } else if (std::strcmp(argv[i], "-s") == 0 && i + 1 < argc) {
+      settings.seed = std::strtoull(argv[++i], nullptr, 10);
+    } else if (std::strcmp(argv[i], "-d") == 0 && i + 1 < argc) {
+      settings.holeDensity = static_cast<float>(std::atof(argv[++i]));
+    } else if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-o") == 0 && i + 1 < argc) {
+      output = argv[++i];
+    } else {
+      size.push_back(std::atoi(argv[i]));
+    }
+  }
+  if (size.size() != 2)
+    return usage();
+  settings.width = size[0];
+  settings.height = size[1];
+
+  ThreadPool pool(threads);
+  MazeGenerator generator(settings);
+  auto begin = std::chrono::steady_clock::now();
+  CellGrid cells = generator.generate(pool);
+  double seconds = secondsSince(begin);
+
+  glm::ivec2 start = generator.getStart(), goal = generator.getGoal();
+  std::printf("%dx%d %s maze, seed %llu: %.1f ms on %u threads "
+              "(%zu tiles, %zu chunks allocated)\n",
+              cells.getWidth(), cells.getHeight(),
+              MazeGenerator::algorithmName(settings.algorithm),
+              static_cast<unsigned long long>(settings.seed),
+              seconds * 1000.0, pool.getThreadCount(),
+              generator.getTileCount(), cells.getAllocatedChunks());
+  std::printf("start (%d,%d), goal (%d,%d), %d moves apart, %zu holes\n",
+              start.x, start.y, goal.x, goal.y, generator.getPathLength(),
+              cells.count(CellType::Hole));
+
+  // The game and the tools play a maze as a Level, which bakes its SDF
+  begin = std::chrono::steady_clock::now();
+  Level level(std::move(cells));
+  seconds = secondsSince(begin);
+  const DistanceField &sdf = level.distanceField;
+  std::printf("level built in %.1f ms (SDF %d samples per cell, %zu tiles "
+              "baked, %.1f MB)\n",
+              seconds * 1000.0, sdf.getSamplesPerCell(), sdf.getBakedTiles(),
+              sdf.getMemoryBytes() / 1048576.0);
+
+  if (output) {
+    std::ofstream file(output);
+    for (const std::string &row : level.cells.toText())
+      file << row << '\n';
+    if (!file) {
+      std::fprintf(stderr, "%s: could not write the level\n", output);
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3)
+    return usage();
+  if (std::strcmp(argv[1], "validate") == 0)
+    return validateLevels(argc, argv);
+  if (std::strcmp(argv[1], "play") == 0)
+    return playLevels(argc, argv);
+  if (std::strcmp(argv[1], "maze") == 0)
+    return generateMaze(argc, argv);
+  bool verify = std::strcmp(argv[1], "verify") == 0;
+  if (!verify && std::strcmp(argv[1], "info") != 0)
+    return usage();
+
+  LevelManager levels;
+  levels.loadBuiltInLevels();
+
+  int failures = 0;
+  for (int i = 2; i < argc; ++i) {
+    Replay replay;
+    if (!replay.load(argv[i])) {
+      std::printf("%s: not a readable replay\n", argv[i]);
+      failures++;
+      continue;
+    }
+
+    int levelIndex = -1;
+    const Level *level = findLevel(levels, replay.levelHash, levelIndex);
+    float seconds = replay.getTickCount() / replay.settings.tickRate;
+    if (!verify) {
+      std::printf("%s: level %d, %llu ticks (%.2f s), %s%s\n", argv[i],
+                  levelIndex + 1,
+                  static_cast<unsigned long long>(replay.getTickCount()),
+                  seconds, phaseName(replay.outcome.phase),
+                  replay.multiMarble ? ", multi-marble" : "");
+      continue;
+    }
+    if (!level) {
+      std::printf("%s: FAIL (no loaded level matches)\n", argv[i]);
+      failures++;
+      continue;
+    }
+
+    Replay::Verification result = replay.verify(*level);
+    if (result.ok) {
+      std::printf("%s: OK, level %d %s after %.2f s, replayed in %.2f ms "
+                  "(%.0fx real time)\n",
+                  argv[i], levelIndex + 1, phaseName(result.replayed.phase),
+                  seconds, result.seconds * 1000.0,
+                  result.seconds > 0.0 ? seconds / result.seconds : 0.0);
+    } else {
+      std::printf("%s: FAIL (%s)\n", argv[i], result.error.c_str());
+      failures++;
+    }
+  }
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,255 @@
+#include "MarbleWorld.h"
+#include "Config.h"
+#include "Level.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+MarbleWorld::MarbleWorld(float radius) : marbles(radius), radius(radius) {}
+
+void MarbleWorld::spawn(const Level &level, int count, uint32_t seed) {
+  // Four slots per free cell, one in each quadrant, so marbles start apart
+  std::vector<glm::ivec2> floorCells;
+  level.cells.collect(CellType::Floor, floorCells);
+
+  std::vector<glm::vec3> slots;
+  float offset = level.cellSize * 0.25f;
+  for (glm::ivec2 cell : floorCells) {
+    glm::vec3 centre = level.gridToWorld(cell);
+    for (int q = 0; q < 4; ++q) {
+      slots.push_back(centre + glm::vec3(q & 1 ? offset : -offset, radius,
+                                         q & 2 ? offset : -offset));
+    }
+  }
+
+  std::mt19937 rng(seed);
+  std::shuffle(slots.begin(), slots.end(), rng);
+  slots.resize(std::min(slots.size(), static_cast<size_t>(count)));
+
+  marbles.reserve(marbles.size() + slots.size());
+  for (const glm::vec3 &pos : slots) {
+    Ball ball;
+    ball.radius = radius;
+    ball.position = pos;
+    ball.previousPosition = pos;
+    marbles.add(ball);
+  }
+}
+
+void MarbleWorld::clear() {
+  marbles.clear();
+  contacts.clear();
+  marblesHome = 0;
+  marblesLost = 0;
+}
+
+void MarbleWorld::step(float dt, glm::vec2 tiltRadians, const Level &level,
+                       Ball *player) {
+  buildHash(level);
+  findContacts(level, dt, player);
+  solveContacts(player);
+  marbles.step(dt, tiltRadians, level);
+  removeFinished();
+}
+
+void MarbleWorld::buildHash(const Level &level) {
+  hashWidth = std::max(level.width, 1);
+  hashHeight = std::max(level.height, 1);
+  const size_t count = marbles.size();
+  const float halfW = level.getBoardWidth() / 2.0f;
+  const float halfD = level.getBoardDepth() / 2.0f;
+
+  sortKeys.clear();
+  for (size_t i = 0; i < count; ++i) {
+    if (marbles.isFalling(i))
+      continue;
+    int cx = static_cast<int>((marbles.px[i] + halfW) / level.cellSize);
+    int cy = static_cast<int>((marbles.pz[i] + halfD) / level.cellSize);
+    cx = std::clamp(cx, 0, hashWidth - 1);
+    cy = std::clamp(cy, 0, hashHeight - 1);
+    uint64_t cell = static_cast<uint64_t>(cy) * hashWidth + cx;
+    sortKeys.push_back(cell << 32 | i);
+  }
+  // Keys go in by lane, so a stable sort by cell leaves each cell's lanes
+  // in order; that is also the order contacts are solved in. LSD radix
+  // sort, 11 bits of the cell per pass.
+  const uint64_t lastCell = static_cast<uint64_t>(hashWidth) * hashHeight - 1;
+  sortScratch.resize(sortKeys.size());
+  for (int shift = 32; (lastCell << 32) >> shift != 0; shift += 11) {
+    uint32_t offsets[2049] = {};
+    for (uint64_t key : sortKeys)
+      offsets[((key >> shift) & 2047) + 1]++;
+    for (int d = 0; d < 2048; ++d)
+      offsets[d + 1] += offsets[d];
+    for (uint64_t key : sortKeys)
+      sortScratch[offsets[(key >> shift) & 2047]++] = key;
+    sortKeys.swap(sortScratch);
+  }
+
+  cellLanes.resize(sortKeys.size());
+  runs.clear();
+  for (size_t k = 0; k < sortKeys.size(); ++k) {
+    uint32_t cell = static_cast<uint32_t>(sortKeys[k] >> 32);
+    cellLanes[k] = static_cast<uint32_t>(sortKeys[k]);
+    if (runs.empty() || runs.back().cell != cell)
+      runs.push_back({cell, static_cast<uint32_t>(k), 0});
+    runs.back().end = static_cast<uint32_t>(k + 1);
+  }
+
+  // At most half full
+  size_t slots = 16;
+  while (slots < runs.size() * 2)
+    slots *= 2;
+  table.assign(slots, EMPTY);
+  tableMask = static_cast<uint32_t>(slots - 1);
+  for (uint32_t r = 0; r < runs.size(); ++r) {
+    uint32_t slot = (runs[r].cell * 2654435761u) & tableMask;
+    while (table[slot] != EMPTY)
+      slot = (slot + 1) & tableMask;
+    table[slot] = r;
+  }
+}
+
+const MarbleWorld::Run *MarbleWorld::findRun(uint32_t cell) const {
+  for (uint32_t slot = (cell * 2654435761u) & tableMask;;
+       slot = (slot + 1) & tableMask) {
+    if (table[slot] == EMPTY)
+      return nullptr;
+    if (runs[table[slot]].cell == cell)
+      return &runs[table[slot]];
+  }
+}
+
+void MarbleWorld::findContacts(const Level &level, float dt,
+                               const Ball *player) {
+  contacts.clear();
+  const float invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+
+  auto addContact = [&](uint32_t a, glm::vec2 pa, glm::vec2 va, uint32_t b,
+                        glm::vec2 pb, glm::vec2 vb, float minDist) {
+    glm::vec2 d = pb - pa;
+    float dist2 = glm::dot(d, d);
+    if (dist2 >= minDist * minDist || dist2 < 1e-12f)
+      return;
+    float dist = std::sqrt(dist2);
+    Contact c;
+    c.a = a;
+    c.b = b;
+    c.normal = d / dist;
+    c.penetration = minDist - dist;
+    float vn = glm::dot(vb - va, c.normal);
+    float restitution =
+        vn < -Config::MARBLE_RESTITUTION_THRESHOLD
+            ? -Config::MARBLE_RESTITUTION * vn
+            : 0.0f;
+    float pushOut = Config::MARBLE_BAUMGARTE *
+                    std::max(c.penetration - Config::MARBLE_SLOP, 0.0f) *
+                    invDt;
+    c.bias = std::max(restitution, pushOut);
+    c.impulse = 0.0f;
+    contacts.push_back(c);
+  };
+  auto lanePos = [&](uint32_t i) {
+    return glm::vec2(marbles.px[i], marbles.pz[i]);
+  };
+  auto laneVel = [&](uint32_t i) {
+    return glm::vec2(marbles.vx[i], marbles.vz[i]);
+  };
+
+  // Each cell is paired with itself and four forward neighbours, so every
+  // pair of adjacent cells is visited exactly once
+  static const int forward[4][2] = {{1, 0}, {-1, 1}, {0, 1}, {1, 1}};
+  const float minDist = 2.0f * radius;
+  for (const Run &run : runs) {
+    int cx = static_cast<int>(run.cell % hashWidth);
+    int cy = static_cast<int>(run.cell / hashWidth);
+    for (uint32_t i = run.begin; i < run.end; ++i) {
+      uint32_t a = cellLanes[i];
+      glm::vec2 pa = lanePos(a), va = laneVel(a);
+      for (uint32_t j = i + 1; j < run.end; ++j) {
+        uint32_t b = cellLanes[j];
+        addContact(a, pa, va, b, lanePos(b), laneVel(b), minDist);
+      }
+      for (const auto &f : forward) {
+        int nx = cx + f[0], ny = cy + f[1];
+        if (nx < 0 || nx >= hashWidth || ny >= hashHeight)
+          continue;
+        const Run *n = findRun(static_cast<uint32_t>(ny * hashWidth + nx));
+        if (!n)
+          continue;
+        for (uint32_t j = n->begin; j < n->end; ++j) {
+          uint32_t b = cellLanes[j];
+          addContact(a, pa, va, b, lanePos(b), laneVel(b), minDist);
+        }
+      }
+    }
+  }
+
+  if (player && !player->isFalling) {
+    glm::vec2 pp(player->position.x, player->position.z);
+    glm::vec2 pv(player->velocity.x, player->velocity.z);
+    glm::ivec2 pc = level.worldToGrid(player->position);
+    int reach = static_cast<int>(
+        std::ceil((player->radius + radius) / level.cellSize));
+    for (int dy = -reach; dy <= reach; ++dy) {
+      for (int dx = -reach; dx <= reach; ++dx) {
+        int nx = pc.x + dx, ny = pc.y + dy;
+        if (nx < 0 || nx >= hashWidth || ny < 0 || ny >= hashHeight)
+          continue;
+        const Run *n = findRun(static_cast<uint32_t>(ny * hashWidth + nx));
+        if (!n)
+          continue;
+        for (uint32_t j = n->begin; j < n->end; ++j) {
+          uint32_t a = cellLanes[j];
+          addContact(a, lanePos(a), laneVel(a), PLAYER, pp, pv,
+                     player->radius + radius);
+        }
+      }
+    }
+  }
+}
+
+void MarbleWorld::solveContacts(Ball *player) {
+  // Equal masses: the effective mass of every contact is 1/2
+  for (int it = 0; it < Config::MARBLE_SOLVER_ITERATIONS; ++it) {
+    for (Contact &c : contacts) {
+      float &vax = marbles.vx[c.a], &vaz = marbles.vz[c.a];
+      float &vbx = c.b == PLAYER ? player->velocity.x : marbles.vx[c.b];
+      float &vbz = c.b == PLAYER ? player->velocity.z : marbles.vz[c.b];
+
+      float vn = (vbx - vax) * c.normal.x + (vbz - vaz) * c.normal.y;
+      float lambda = (c.bias - vn) * 0.5f;
+      float total = std::max(c.impulse + lambda, 0.0f);
+      lambda = total - c.impulse;
+      c.impulse = total;
+
+      vax -= c.normal.x * lambda;
+      vaz -= c.normal.y * lambda;
+      vbx += c.normal.x * lambda;
+      vbz += c.normal.y * lambda;
+    }
+  }
+}
+
+void MarbleWorld::removeFinished() {
+  for (size_t i = marbles.size(); i-- > 0;) {
+    if (marbles.hasFallenInHole(i)) {
+      marblesLost++;
+      marbles.remove(i);
+    } else if (marbles.isAtGoal(i)) {
+      marblesHome++;
+      marbles.remove(i);
+    }
+  }
+}
+
+void MarbleWorld::getPositions(std::vector<glm::vec3> &previous,
+                               std::vector<glm::vec3> &current) const {
+  previous.resize(marbles.size());
+  current.resize(marbles.size());
+  for (size_t i = 0; i < marbles.size(); ++i) {
+    previous[i] = glm::vec3(marbles.prevX[i], marbles.prevY[i],
+                            marbles.prevZ[i]);
+    current[i] = marbles.getPosition(i);
+  }
+}
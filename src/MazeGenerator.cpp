@@ -0,0 +1,559 @@
+#include "MazeGenerator.h"
+#include "ThreadPool.h"
+#include <algorithm>
+
+// Directions in the order of Tile::doors; k ^ 1 is the opposite of k
+static const glm::ivec2 STEPS[4] = {{1, 0}, {-1, 0}, {0, 1}, {0, -1}};
+
+// Rooms: one placement attempt per ROOM_AREA maze cells, sides in maze
+// cells between ROOM_MIN and ROOM_MAX
+static constexpr int ROOM_AREA = 40;
+static constexpr int ROOM_MIN = 2;
+static constexpr int ROOM_MAX = 6;
+
+// Independent streams per tile (splitmix64 of the inputs)
+static uint64_t tileSeed(uint64_t seed, size_t tile, uint64_t stream) {
+  uint64_t z = seed * 0x9e3779b97f4a7c15ull + tile * 0xbf58476d1ce4e5b9ull +
+               stream * 0x94d049bb133111ebull;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+  return z ^ (z >> 31);
+}
+
+// Maze cells not yet carved are 0 in Scratch::state
+static constexpr uint8_t IN_MAZE = 1;
+static constexpr uint8_t OUTSIDE = 2;
+
+// Small random choices, sliced off 64-bit draws
+class Choices {
+public:
+  explicit Choices(std::mt19937_64 &rng) : rng(rng) {}
+  // In [0, n) for n <= 4, from 8 bits
+  unsigned pick(unsigned n) { return (take(8) * n) >> 8; }
+  // One of four directions, from 2 bits
+  unsigned direction() { return take(2); }
+
+private:
+  std::mt19937_64 &rng;
+  uint64_t bits = 0;
+  int left = 0;
+
+  unsigned take(int count) {
+    if (left < count) {
+      bits = rng();
+      left = 64;
+    }
+    unsigned r = static_cast<unsigned>(bits & ((1u << count) - 1));
+    bits >>= count;
+    left -= count;
+    return r;
+  }
+};
+
+int MazeGenerator::Tile::step(int direction) const {
+  return STEPS[direction].y * stride + STEPS[direction].x;
+}
+
+MazeGenerator::MazeGenerator(const Settings &s) : settings(s) {
+  // At least two maze cells, so that start and goal differ
+  settings.width = std::max(settings.width, 5);
+  settings.height = std::max(settings.height, 3);
+  settings.holeDensity = glm::clamp(settings.holeDensity, 0.0f, 1.0f);
+  // Two board cells per maze cell, so tiles span whole chunks
+  const int align = CellGrid::CHUNK_SIZE / 2;
+  tileCells = std::max(align, (settings.tileCells + align - 1) / align * align);
+  mazeSize = glm::ivec2(settings.width - 1, settings.height - 1) / 2;
+  tileCount = (mazeSize + tileCells - 1) / tileCells;
+}
+
+CellGrid MazeGenerator::generate(ThreadPool &pool) {
+  planTiles();
+  scratch.assign(pool.getThreadCount(), Scratch());
+  pool.parallelFor(tiles.size(), [&](size_t i, unsigned worker) {
+    carve(tiles[i], i, scratch[worker]);
+  });
+
+  // Double sweep: the farthest cell from anywhere ends a longest route, and
+  // the farthest cell from that ends it at the other side. This is exact
+  // on a tree and close with the loops inside rooms.
+  int startTile = 0, startCell = 0, goalTile = 0, goalCell = 0, steps = 0;
+  sweep(startTile, startCell, steps);
+  reroot(startTile, startCell, pool);
+  sweep(goalTile, goalCell, steps);
+  start = boardCell(tiles[startTile], startCell);
+  goal = boardCell(tiles[goalTile], goalCell);
+  pathLength = 2 * steps;
+
+  // The route climbs the tile tree from the goal's tile to the start's
+  int childDoor = -1;
+  for (int t = goalTile;;) {
+    Tile &tile = tiles[t];
+    tile.routeTo = childDoor < 0 ? goalCell : tile.doors[childDoor];
+    tile.routeFrom = tile.parent < 0 ? startCell : tile.doors[tile.parent];
+    if (tile.parent < 0)
+      break;
+    childDoor = tile.parent ^ 1;
+    t = neighbourTile(t, tile.parent);
+  }
+
+  CellGrid grid(settings.width, settings.height, CellType::Wall);
+  pool.parallelFor(tiles.size(), [&](size_t i, unsigned worker) {
+    finish(tiles[i], i, grid, scratch[worker]);
+  });
+  return grid;
+}
+
+const char *MazeGenerator::algorithmName(MazeAlgorithm algorithm) {
+  switch (algorithm) {
+  case MazeAlgorithm::Wilson:
+    return "wilson";
+  case MazeAlgorithm::Rooms:
+    return "rooms";
+  default:
+    return "backtracker";
+  }
+}
+
+bool MazeGenerator::parseAlgorithm(const std::string &name,
+                                   MazeAlgorithm &out) {
+  for (MazeAlgorithm algorithm :
+       {MazeAlgorithm::Backtracker, MazeAlgorithm::Wilson,
+        MazeAlgorithm::Rooms}) {
+    if (name == algorithmName(algorithm)) {
+      out = algorithm;
+      return true;
+    }
+  }
+  return false;
+}
+
+int MazeGenerator::neighbourTile(int tile, int direction) const {
+  glm::ivec2 t =
+      glm::ivec2(tile % tileCount.x, tile / tileCount.x) + STEPS[direction];
+  if (t.x < 0 || t.y < 0 || t.x >= tileCount.x || t.y >= tileCount.y)
+    return -1;
+  return t.y * tileCount.x + t.x;
+}
+
+glm::ivec2 MazeGenerator::boardCell(const Tile &tile, int cell) const {
+  return tile.origin + glm::ivec2(cell % tile.stride, cell / tile.stride);
+}
+
+void MazeGenerator::planTiles() {
+  tiles.assign(static_cast<size_t>(tileCount.x) * tileCount.y, Tile());
+  for (int ty = 0; ty < tileCount.y; ++ty) {
+    for (int tx = 0; tx < tileCount.x; ++tx) {
+      Tile &tile = tiles[ty * tileCount.x + tx];
+      glm::ivec2 first = glm::ivec2(tx, ty) * tileCells;
+      tile.count = glm::min(mazeSize - first, glm::ivec2(tileCells));
+      tile.origin = first * 2;
+      // The last tile of a row or column also takes the far edge
+      glm::ivec2 end = tile.origin + 2 * tileCells;
+      if (tx + 1 == tileCount.x)
+        end.x = settings.width;
+      if (ty + 1 == tileCount.y)
+        end.y = settings.height;
+      tile.size = end - tile.origin;
+      tile.stride = std::max(tile.size.x, 2 * tile.count.x + 1);
+      tile.rows = std::max(tile.size.y, 2 * tile.count.y + 1);
+    }
+  }
+
+  // Random depth-first spanning tree over the tiles, rooted at tile 0,
+  // with one door through each edge it uses
+  std::mt19937_64 rng(settings.seed);
+  std::vector<uint8_t> seen(tiles.size(), 0);
+  std::vector<int> stack = {0};
+  seen[0] = 1;
+  while (!stack.empty()) {
+    int t = stack.back();
+    int options[4];
+    unsigned n = 0;
+    for (int k = 0; k < 4; ++k) {
+      int u = neighbourTile(t, k);
+      if (u >= 0 && !seen[u])
+        options[n++] = k;
+    }
+    if (n == 0) {
+      stack.pop_back();
+      continue;
+    }
+
+    int k = options[rng() % n];
+    int u = neighbourTile(t, k);
+    Tile &a = tiles[t], &b = tiles[u];
+    // Neighbours in a tile row share their rows of maze cells, and
+    // neighbours in a column their columns
+    if (k < 2) {
+      int y = static_cast<int>(rng() % a.count.y);
+      a.doors[k] = a.offset(k == 0 ? a.count.x - 1 : 0, y);
+      b.doors[k ^ 1] = b.offset(k == 0 ? 0 : b.count.x - 1, y);
+    } else {
+      int x = static_cast<int>(rng() % a.count.x);
+      a.doors[k] = a.offset(x, k == 2 ? a.count.y - 1 : 0);
+      b.doors[k ^ 1] = b.offset(x, k == 2 ? 0 : b.count.y - 1);
+    }
+    b.parent = k ^ 1;
+    seen[u] = 1;
+    stack.push_back(u);
+  }
+}
+
+void MazeGenerator::carve(Tile &tile, size_t index, Scratch &s) const {
+  tile.cells.assign(static_cast<size_t>(tile.stride) * tile.rows,
+                    CellType::Wall);
+  std::mt19937_64 rng(tileSeed(settings.seed, index, 0));
+  switch (settings.algorithm) {
+  case MazeAlgorithm::Backtracker:
+    backtrack(tile, rng, s);
+    break;
+  case MazeAlgorithm::Wilson:
+    wilson(tile, rng, s);
+    break;
+  case MazeAlgorithm::Rooms:
+    rooms(tile, rng, s);
+    break;
+  }
+
+  // The first sweep starts from any open cell of the root tile
+  int source = tile.parent >= 0 ? tile.doors[tile.parent] : -1;
+  for (int i = 0; source < 0; ++i) {
+    int cell = tile.offset(i % tile.count.x, i / tile.count.x);
+    if (tile.cells[cell] != CellType::Wall)
+      source = cell;
+  }
+  search(tile, source, tile.search, s);
+}
+
+uint8_t *MazeGenerator::clearState(const Tile &tile, Scratch &s) const {
+  // Two rows of padding, so the cell two steps up or down from any maze
+  // cell can be read
+  size_t pad = 2 * static_cast<size_t>(tile.stride);
+  s.state.assign(tile.cells.size() + 2 * pad, OUTSIDE);
+  uint8_t *state = s.state.data() + pad;
+  for (int y = 0; y < tile.count.y; ++y) {
+    uint8_t *row = state + tile.offset(0, y);
+    for (int x = 0; x < tile.count.x; ++x)
+      row[2 * x] = 0;
+  }
+  return state;
+}
+
+void MazeGenerator::backtrack(Tile &tile, std::mt19937_64 &rng,
+                              Scratch &s) const {
+  uint8_t *state = clearState(tile, s);
+  const int step[4] = {tile.step(0), tile.step(1), tile.step(2),
+                       tile.step(3)};
+  Choices choices(rng);
+  int first = tile.offset(static_cast<int>(rng() % tile.count.x),
+                          static_cast<int>(rng() % tile.count.y));
+  state[first] = IN_MAZE;
+  tile.cells[first] = CellType::Floor;
+  s.queue.clear();
+  s.queue.push_back(first);
+
+  // Iterative, with the stack in s.queue: extend the path to a random
+  // unvisited neighbour, or back up when there is none
+  while (!s.queue.empty()) {
+    int cell = s.queue.back();
+    int options[4];
+    unsigned n = 0;
+    for (int k = 0; k < 4; ++k) {
+      options[n] = step[k];
+      n += state[cell + 2 * step[k]] == 0;
+    }
+    if (n == 0) {
+      s.queue.pop_back();
+      continue;
+    }
+    int offset = options[choices.pick(n)];
+    int next = cell + 2 * offset;
+    tile.cells[cell + offset] = CellType::Floor;
+    tile.cells[next] = CellType::Floor;
+    state[next] = IN_MAZE;
+    s.queue.push_back(next);
+  }
+}
+
+void MazeGenerator::wilson(Tile &tile, std::mt19937_64 &rng,
+                           Scratch &s) const {
+  uint8_t *state = clearState(tile, s);
+  const int step[4] = {tile.step(0), tile.step(1), tile.step(2),
+                       tile.step(3)};
+  Choices choices(rng);
+  std::vector<int> &exits = s.distance; // Taken by the current walk
+  exits.resize(tile.cells.size());
+  int first = tile.offset(static_cast<int>(rng() % tile.count.x),
+                          static_cast<int>(rng() % tile.count.y));
+  state[first] = IN_MAZE;
+  tile.cells[first] = CellType::Floor;
+
+  for (int y = 0; y < tile.count.y; ++y) {
+    for (int x = 0; x < tile.count.x; ++x) {
+      int cell = tile.offset(x, y);
+      if (state[cell] == IN_MAZE)
+        continue;
+      // Walk at random until the maze is hit. A cell the walk comes back
+      // to gets its exit overwritten, which erases the loop.
+      int at = cell;
+      while (state[at] != IN_MAZE) {
+        int k;
+        do {
+          k = static_cast<int>(choices.direction());
+        } while (state[at + 2 * step[k]] == OUTSIDE);
+        exits[at] = step[k];
+        at += 2 * step[k];
+      }
+      // Add the loop-erased walk to the maze
+      for (at = cell; state[at] != IN_MAZE; at += 2 * exits[at]) {
+        state[at] = IN_MAZE;
+        tile.cells[at] = CellType::Floor;
+        tile.cells[at + exits[at]] = CellType::Floor;
+      }
+    }
+  }
+}
+
+void MazeGenerator::rooms(Tile &tile, std::mt19937_64 &rng,
+                          Scratch &s) const {
+  s.marks.assign(tile.cells.size(), 0); // Room cells, and doors below
+  int cells = tile.count.x * tile.count.y;
+  int placed = 0;
+  for (int attempt = std::max(1, cells / ROOM_AREA); attempt > 0;
+       --attempt) {
+    glm::ivec2 extent(ROOM_MIN + rng() % (ROOM_MAX - ROOM_MIN + 1),
+                      ROOM_MIN + rng() % (ROOM_MAX - ROOM_MIN + 1));
+    if (extent.x > tile.count.x || extent.y > tile.count.y)
+      continue;
+    glm::ivec2 at(rng() % (tile.count.x - extent.x + 1),
+                  rng() % (tile.count.y - extent.y + 1));
+    // Rooms keep at least a corridor apart
+    glm::ivec2 lo = glm::max(at - 1, glm::ivec2(0));
+    glm::ivec2 hi = glm::min(at + extent, tile.count - 1);
+    bool clear = true;
+    for (int y = lo.y; y <= hi.y && clear; ++y) {
+      for (int x = lo.x; x <= hi.x; ++x)
+        clear = clear && !s.marks[tile.offset(x, y)];
+    }
+    if (!clear)
+      continue;
+
+    // Open the whole rectangle, walls between its cells included
+    placed++;
+    for (int y = at.y; y < at.y + extent.y; ++y) {
+      for (int x = at.x; x < at.x + extent.x; ++x)
+        s.marks[tile.offset(x, y)] = 1;
+    }
+    for (int y = 2 * at.y + 1; y < 2 * (at.y + extent.y); ++y) {
+      std::fill_n(&tile.cells[static_cast<size_t>(y) * tile.stride +
+                              2 * at.x + 1],
+                  2 * extent.x - 1, CellType::Floor);
+    }
+  }
+
+  // A maze through everything joins the rooms; then dead ends are filled
+  // in until only corridors between rooms and doors are left. A tile too
+  // small for a room keeps its whole maze.
+  backtrack(tile, rng, s);
+  if (placed == 0)
+    return;
+  const int step[4] = {tile.step(0), tile.step(1), tile.step(2),
+                       tile.step(3)};
+  // Doors are kept like room cells
+  for (int door : tile.doors) {
+    if (door >= 0)
+      s.marks[door] = 1;
+  }
+  const uint8_t *kept = s.marks.data();
+  CellType *maze = tile.cells.data();
+  auto exits = [&](int cell, int &last) {
+    int n = 0;
+    for (int k = 0; k < 4; ++k) {
+      bool open = maze[cell + step[k]] != CellType::Wall;
+      last = open ? step[k] : last;
+      n += open;
+    }
+    return n;
+  };
+
+  // Every cell is joined to a room, so filling until no dead end is left
+  // gives the same maze in any order: each dead end is followed back as
+  // soon as it is found
+  int offset = 0;
+  for (int y = 0; y < tile.count.y; ++y) {
+    for (int x = 0; x < tile.count.x; ++x) {
+      for (int cell = tile.offset(x, y);
+           !kept[cell] && exits(cell, offset) == 1; cell += 2 * offset) {
+        maze[cell] = CellType::Wall;
+        maze[cell + offset] = CellType::Wall;
+      }
+    }
+  }
+}
+
+void MazeGenerator::search(const Tile &tile, int source, Search &out,
+                           Scratch &s, int target) const {
+  // Doors are still closed here, so the tile's wall lines keep the search
+  // inside the buffer. Maze walls are random, so the neighbours are pushed
+  // without branches: every candidate is written and the tail only moves
+  // past the ones that are open and new.
+  const int step[4] = {tile.step(0), tile.step(1), tile.step(2),
+                       tile.step(3)};
+  const CellType *cells = tile.cells.data();
+  size_t pad = 2 * static_cast<size_t>(tile.stride);
+  s.distance.assign(tile.cells.size() + 2 * pad, -1);
+  s.queue.resize(static_cast<size_t>(tile.count.x) * tile.count.y + 4);
+  int *distance = s.distance.data() + pad;
+  int *queue = s.queue.data();
+  size_t tail = 1;
+  queue[0] = source;
+  distance[source] = 0;
+  for (size_t head = 0; head < tail; ++head) {
+    int cell = queue[head];
+    if (cell == target)
+      break;
+    int d = distance[cell] + 1;
+    for (int k = 0; k < 4; ++k) {
+      int next = cell + 2 * step[k];
+      bool fresh = (cells[cell + step[k]] != CellType::Wall) &
+                   (distance[next] < 0);
+      distance[next] = fresh ? d : distance[next];
+      queue[tail] = next;
+      tail += fresh;
+    }
+  }
+
+  // Breadth-first, so the last cell taken is a farthest one
+  out = Search();
+  out.source = source;
+  out.farthest = queue[tail - 1];
+  out.farthestDistance = distance[out.farthest];
+  for (int k = 0; k < 4; ++k) {
+    if (tile.doors[k] >= 0)
+      out.doorDistance[k] = distance[tile.doors[k]];
+  }
+}
+
+void MazeGenerator::reroot(int tile, int source, ThreadPool &pool) {
+  std::vector<int> chain = {tile};
+  while (tiles[chain.back()].parent >= 0)
+    chain.push_back(neighbourTile(chain.back(), tiles[chain.back()].parent));
+  // Parent doors on the way to the old root now point back towards `tile`
+  for (size_t i = chain.size() - 1; i > 0; --i)
+    tiles[chain[i]].parent = tiles[chain[i - 1]].parent ^ 1;
+  tiles[tile].parent = -1;
+  root = tile;
+
+  pool.parallelFor(chain.size(), [&](size_t i, unsigned worker) {
+    Tile &t = tiles[chain[i]];
+    search(t, i == 0 ? source : t.doors[t.parent], t.search,
+           scratch[worker]);
+  });
+}
+
+void MazeGenerator::sweep(int &farthestTile, int &farthestCell,
+                          int &distance) const {
+  // A route into a tile's subtree crosses its parent door, so distances
+  // add up down the tree: the door's distance, then the tile's own search
+  struct Visit {
+    int tile;
+    int base; // Steps from the root's source to the parent door's cell
+  };
+  std::vector<Visit> stack = {{root, 0}};
+  distance = -1;
+  while (!stack.empty()) {
+    Visit visit = stack.back();
+    stack.pop_back();
+    const Tile &tile = tiles[visit.tile];
+    if (visit.base + tile.search.farthestDistance > distance) {
+      distance = visit.base + tile.search.farthestDistance;
+      farthestTile = visit.tile;
+      farthestCell = tile.search.farthest;
+    }
+    for (int k = 0; k < 4; ++k) {
+      if (tile.doors[k] >= 0 && k != tile.parent)
+        stack.push_back({neighbourTile(visit.tile, k),
+                         visit.base + tile.search.doorDistance[k] + 1});
+    }
+  }
+}
+
+void MazeGenerator::finish(Tile &tile, size_t index, CellGrid &grid,
+                           Scratch &s) const {
+  // Mark the route through this tile so no hole lands on it
+  s.marks.assign(tile.cells.size(), 0);
+  if (tile.routeFrom >= 0) {
+    Search route;
+    search(tile, tile.routeFrom, route, s, tile.routeTo);
+    const int *distance = s.distance.data() + 2 * tile.stride;
+    int cell = tile.routeTo;
+    s.marks[cell] = 1;
+    while (cell != tile.routeFrom) {
+      for (int k = 0; k < 4; ++k) {
+        int wall = cell + tile.step(k), next = cell + 2 * tile.step(k);
+        if (tile.cells[wall] != CellType::Wall &&
+            distance[next] == distance[cell] - 1) {
+          s.marks[wall] = s.marks[next] = 1;
+          cell = next;
+          break;
+        }
+      }
+    }
+  }
+
+  // Doors to the left and above go through this tile's own wall lines
+  if (tile.doors[1] >= 0)
+    tile.cells[tile.doors[1] + tile.step(1)] = CellType::Floor;
+  if (tile.doors[3] >= 0)
+    tile.cells[tile.doors[3] + tile.step(3)] = CellType::Floor;
+
+  // Holes: count down a geometric number of candidates between them
+  // instead of rolling for every cell. The wall lines on the left and top
+  // only hold doors, so they are skipped.
+  if (settings.holeDensity > 0.0f) {
+    std::mt19937_64 rng(tileSeed(settings.seed, index, 1));
+    std::geometric_distribution<int> gaps(
+        std::min(settings.holeDensity, 0.999f));
+    auto gap = [&] { return settings.holeDensity < 1.0f ? gaps(rng) : 0; };
+    int skip = gap();
+    for (int y = 1; y < tile.size.y; ++y) {
+      CellType *row = &tile.cells[static_cast<size_t>(y) * tile.stride];
+      const uint8_t *onRoute = &s.marks[static_cast<size_t>(y) * tile.stride];
+      for (int x = 1; x < tile.size.x; ++x) {
+        skip -= (row[x] == CellType::Floor) & !onRoute[x];
+        if (skip < 0) {
+          row[x] = CellType::Hole;
+          skip = gap();
+        }
+      }
+    }
+  }
+
+  for (auto [cell, type] : {std::make_pair(start, CellType::Start),
+                            std::make_pair(goal, CellType::Goal)}) {
+    glm::ivec2 local = cell - tile.origin;
+    if (local.x >= 0 && local.y >= 0 && local.x < tile.size.x &&
+        local.y < tile.size.y)
+      tile.cells[static_cast<size_t>(local.y) * tile.stride + local.x] =
+          type;
+  }
+
+  // Tiles start on chunk boundaries, and only the last tile in a row or
+  // column ends inside a chunk (at the board edge)
+  const int size = CellGrid::CHUNK_SIZE;
+  CellType block[CellGrid::CHUNK_CELLS];
+  for (int y0 = 0; y0 < tile.size.y; y0 += size) {
+    for (int x0 = 0; x0 < tile.size.x; x0 += size) {
+      int w = std::min(size, tile.size.x - x0);
+      int h = std::min(size, tile.size.y - y0);
+      for (int y = 0; y < h; ++y)
+        std::copy_n(
+            &tile.cells[static_cast<size_t>(y0 + y) * tile.stride + x0], w,
+            block + y * size);
+      grid.setChunk((tile.origin.x + x0) >> CellGrid::CHUNK_SHIFT,
+                    (tile.origin.y + y0) >> CellGrid::CHUNK_SHIFT, block);
+    }
+  }
+  // The board has the cells now
+  std::vector<CellType>().swap(tile.cells);
+}
@@ -2,7 +2,7 @@
 
 Mesh::Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices)
     : vertices(std::move(vertices)), indices(std::move(indices)), VAO(0),
-      VBO(0), EBO(0) {
+      VBO(0), EBO(0), vertexCapacity(0), indexCapacity(0) {
   setupMesh();
 }
 
@@ -50,6 +50,40 @@ void Mesh::setupMesh() {
   glEnableVertexAttribArray(4);
 
   glBindVertexArray(0);
+  vertexCapacity = vertices.size();
+  indexCapacity = indices.size();
+}
+
+void Mesh::update(std::vector<Vertex> &newVertices,
+                  std::vector<unsigned int> &newIndices) {
+  vertices.swap(newVertices);
+  indices.swap(newIndices);
+  if (!VAO) {
+    setupMesh();
+    return;
+  }
+
+  // Buffers that are too small grow with headroom, so a chunk that is
+  // edited again and again settles into rewriting them in place
+  glBindVertexArray(VAO);
+  glBindBuffer(GL_ARRAY_BUFFER, VBO);
+  if (vertices.size() > vertexCapacity) {
+    vertexCapacity = vertices.size() + vertices.size() / 2;
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * sizeof(Vertex), nullptr,
+                 GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(Vertex),
+                  vertices.data());
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+  if (indices.size() > indexCapacity) {
+    indexCapacity = indices.size() + indices.size() / 2;
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER,
+                 indexCapacity * sizeof(unsigned int), nullptr,
+                 GL_DYNAMIC_DRAW);
+  }
+  glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, 0,
+                  indices.size() * sizeof(unsigned int), indices.data());
+  glBindVertexArray(0);
 }
 
 void Mesh::draw() const {
@@ -59,6 +93,15 @@ void Mesh::draw() const {
   glBindVertexArray(0);
 }
 
+void Mesh::drawInstanced(size_t count) const {
+  if (count == 0)
+    return;
+  glBindVertexArray(VAO);
+  glDrawElementsInstanced(GL_TRIANGLES, static_cast<GLsizei>(indices.size()),
+                          GL_UNSIGNED_INT, 0, static_cast<GLsizei>(count));
+  glBindVertexArray(0);
+}
+
 void Mesh::cleanup() {
   if (VAO)
     glDeleteVertexArrays(1, &VAO);
@@ -67,4 +110,5 @@ void Mesh::cleanup() {
   if (EBO)
     glDeleteBuffers(1, &EBO);
   VAO = VBO = EBO = 0;
+  vertexCapacity = indexCapacity = 0;
 }
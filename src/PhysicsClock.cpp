@@ -0,0 +1,26 @@
+#include "PhysicsClock.h"
+#include <algorithm>
+
+PhysicsClock::PhysicsClock(float tickRate, int maxStepsPerFrame)
+    : step(1.0f / tickRate), maxSteps(std::max(1, maxStepsPerFrame)) {}
+
+int PhysicsClock::advance(float frameDelta) {
+  accumulator += std::max(0.0f, frameDelta);
+
+  int steps = static_cast<int>(accumulator / step);
+  if (steps > maxSteps) {
+    // Spiral-of-death guard: run the cap and drop the backlog instead of
+    // trying to catch up (the game slows down rather than freezing)
+    steps = maxSteps;
+    accumulator = 0.0f;
+    droppedFrames++;
+  } else {
+    accumulator -= steps * step;
+  }
+  return steps;
+}
+
+void PhysicsClock::reset() {
+  accumulator = 0.0f;
+  droppedFrames = 0;
+}
@@ -0,0 +1,110 @@
+#include "PhysicsThread.h"
+#include <chrono>
+
+PhysicsThread::PhysicsThread(Simulation &simulation, float tickRate,
+                             int maxStepsPerFrame)
+    : sim(simulation), clock(tickRate, maxStepsPerFrame) {}
+
+PhysicsThread::~PhysicsThread() { stop(); }
+
+double PhysicsThread::now() {
+  using namespace std::chrono;
+  return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+void PhysicsThread::start(bool useThread) {
+  stop();
+  threaded = useThread;
+  clock.reset();
+  lastTime = now();
+  publishNow();
+  if (threaded) {
+    running = true;
+    thread = std::thread(&PhysicsThread::run, this);
+  }
+}
+
+void PhysicsThread::stop() {
+  running = false;
+  if (thread.joinable())
+    thread.join();
+}
+
+void PhysicsThread::setInput(glm::vec2 tiltRadians, bool rewind,
+                             uint32_t rewindTicks) {
+  // If the queue is full the physics side is far behind; the next frame
+  // will send a newer tilt anyway
+  inputs.push(Input{tiltRadians, rewind, rewindTicks});
+}
+
+void PhysicsThread::pump(float frameDelta) {
+  if (threaded)
+    return;
+  lastTime += frameDelta;
+  advance(lastTime);
+}
+
+void PhysicsThread::run() {
+  while (running.load(std::memory_order_relaxed)) {
+    advance(now());
+
+    // Sleep until the next tick is due
+    float wait = clock.getStep() * (1.0f - clock.getAlpha());
+    std::this_thread::sleep_for(std::chrono::duration<float>(wait));
+  }
+}
+
+void PhysicsThread::advance(double time) {
+  Input input;
+  bool rewound = false;
+  while (inputs.pop(input)) {
+    tilt = input.tilt;
+    rewinding = input.rewinding;
+    if (input.rewindTicks > 0)
+      rewound |= sim.rewind(input.rewindTicks);
+  }
+
+  float frameDelta = static_cast<float>(time - lastTime);
+  if (threaded)
+    lastTime = time;
+
+  int steps = clock.advance(frameDelta);
+  for (int i = 0; i < steps && !rewinding; ++i)
+    sim.tick(clock.getStep(), tilt);
+
+  if (steps > 0 || rewound)
+    publish(time - clock.getAlpha() * clock.getStep());
+}
+
+void PhysicsThread::publishNow() { publish(now()); }
+
+void PhysicsThread::publish(double tickTime) {
+  Snapshot &s = snapshots.getWriteBuffer();
+  s.phase = sim.phase;
+  s.ballPrevious = sim.ball.previousPosition;
+  s.ballPosition = sim.ball.position;
+  sim.marbles.getPositions(s.marblePrevious, s.marblePosition);
+  s.marblesHome = sim.marbles.getMarblesHome();
+  s.marblesLost = sim.marbles.getMarblesLost();
+  s.tilt = sim.tilt;
+  s.rewindSeconds = sim.getRewindTicks() * clock.getStep();
+  s.tick = sim.tickCount;
+  s.tickTime = tickTime;
+  s.finishedReplay = sim.getFinishedReplay();
+  snapshots.publish();
+}
+
+const PhysicsThread::Snapshot &PhysicsThread::latest() {
+  snapshots.fetch();
+  return snapshots.getReadBuffer();
+}
+
+float PhysicsThread::getAlpha(const Snapshot &snapshot) const {
+  if (snapshot.phase != GamePhase::Playing)
+    return 1.0f;
+  if (!threaded)
+    return clock.getAlpha();
+  float alpha =
+      static_cast<float>((now() - snapshot.tickTime) / clock.getStep());
+  return alpha < 0.0f ? 0.0f : (alpha > 1.0f ? 1.0f : alpha);
+}
@@ -419,4 +419,23 @@ Mesh createPlane(float width, float depth) {
   return Mesh(vertices, indices);
 }
 
+Mesh createArrow(float length, float width) {
+  // Shaft then head, in the XZ plane; wound to face +Y
+  float tail = -length / 2.0f, neck = length * 0.05f, tip = length / 2.0f;
+  float shaft = width * 0.18f, head = width / 2.0f;
+  glm::vec2 outline[7] = {{tail, -shaft}, {neck, -shaft}, {neck, shaft},
+                          {tail, shaft},  {neck, -head},  {tip, 0.0f},
+                          {neck, head}};
+
+  std::vector<Vertex> vertices;
+  for (glm::vec2 p : outline) {
+    glm::vec2 uv((p.x - tail) / length, (p.y + head) / width);
+    vertices.push_back({{p.x, 0, p.y}, {0, 1, 0}, uv, {1, 0, 0}, {0, 0, 1}});
+  }
+
+  std::vector<unsigned int> indices = {0, 3, 2, 0, 2, 1, 4, 6, 5};
+
+  return Mesh(vertices, indices);
+}
+
 } // namespace Primitives
@@ -0,0 +1,152 @@
+#include "ProgramCache.h"
+#include "Config.h"
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <iterator>
+#include <random>
+#include <vector>
+
+namespace ProgramCache {
+
+namespace {
+
+const char MAGIC[4] = {'M', 'P', 'B', 'C'};
+const uint32_t VERSION = 1;
+
+// Stored in front of the driver's binary
+struct Header {
+  char magic[4];
+  uint32_t version;
+  uint64_t key;
+  uint32_t format; // Driver binary format (GLenum)
+  uint32_t length;
+};
+
+Stats stats;
+
+bool enabled() {
+  if (!*Config::SHADER_CACHE_DIRECTORY)
+    return false;
+  static GLint formats = -1;
+  if (formats < 0)
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+  return formats > 0;
+}
+
+uint64_t hash(uint64_t h, const char *text) {
+  // FNV-1a, 64-bit; a zero byte separates the fields
+  for (const char *c = text ? text : ""; ; ++c) {
+    h = (h ^ static_cast<uint8_t>(*c)) * 1099511628211ull;
+    if (!*c)
+      return h;
+  }
+}
+
+std::string path(uint64_t key) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "%016llx.bin",
+                static_cast<unsigned long long>(key));
+  return std::string(Config::SHADER_CACHE_DIRECTORY) + "/" + name;
+}
+
+uint64_t temporarySuffix() {
+  static std::mt19937_64 rng(
+      (uint64_t(std::random_device{}()) << 32) ^ std::random_device{}());
+  return rng();
+}
+
+} // namespace
+
+uint64_t key(const std::string &vertexCode, const std::string &fragmentCode) {
+  uint64_t h = 14695981039346656037ull;
+  for (GLenum name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    h = hash(h, reinterpret_cast<const char *>(glGetString(name)));
+  h = hash(h, vertexCode.c_str());
+  return hash(h, fragmentCode.c_str());
+}
+
+void prepare(unsigned int program) {
+  if (enabled())
+    glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+bool load(unsigned int program, uint64_t key) {
+  if (!enabled())
+    return false;
+  std::ifstream file(path(key), std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<char> bytes((std::istreambuf_iterator<char>(file)),
+                          std::istreambuf_iterator<char>());
+  Header header;
+  if (bytes.size() < sizeof(header))
+    return false;
+  std::memcpy(&header, bytes.data(), sizeof(header));
+  if (std::memcmp(header.magic, MAGIC, 4) != 0 ||
+      header.version != VERSION || header.key != key ||
+      header.length != bytes.size() - sizeof(header))
+    return false;
+
+  glProgramBinary(program, header.format, bytes.data() + sizeof(header),
+                  static_cast<GLsizei>(header.length));
+  GLint linked = 0;
+  glGetProgramiv(program, GL_LINK_STATUS, &linked);
+  if (linked)
+    ++stats.hits;
+  return linked != 0;
+}
+
+void store(unsigned int program, uint64_t key) {
+  ++stats.misses;
+  if (!enabled())
+    return;
+  GLint length = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0)
+    return;
+
+  Header header;
+  std::memcpy(header.magic, MAGIC, 4);
+  header.version = VERSION;
+  header.key = key;
+  std::vector<char> bytes(sizeof(header) + length);
+  GLsizei written = 0;
+  GLenum format = 0;
+  glGetProgramBinary(program, length, &written, &format,
+                     bytes.data() + sizeof(header));
+  if (written <= 0)
+    return;
+  header.format = format;
+  header.length = static_cast<uint32_t>(written);
+  std::memcpy(bytes.data(), &header, sizeof(header));
+  bytes.resize(sizeof(header) + written);
+
+  // Written aside and renamed, so a second instance never reads half a
+  // file. The temporary name is unique per call, so two instances storing
+  // the same program at once don't write into one file either.
+  std::error_code ec;
+  std::filesystem::create_directories(Config::SHADER_CACHE_DIRECTORY, ec);
+  char suffix[32];
+  std::snprintf(suffix, sizeof(suffix), ".%016llx.tmp",
+                static_cast<unsigned long long>(temporarySuffix()));
+  std::string target = path(key), temporary = target + suffix;
+  bool saved = false;
+  {
+    std::ofstream file(temporary, std::ios::binary);
+    if (!file.is_open())
+      return;
+    file.write(bytes.data(), bytes.size());
+    saved = file.good();
+  }
+  if (saved)
+    std::filesystem::rename(temporary, target, ec);
+  if (!saved || ec)
+    std::filesystem::remove(temporary, ec);
+}
+
+const Stats &getStats() { return stats; }
+
+} // namespace ProgramCache
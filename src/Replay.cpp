@@ -0,0 +1,387 @@
+#include "Replay.h"
+#include "Config.h"
+#include "Level.h"
+#include "PhysicsClock.h"
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+const char MAGIC[4] = {'M', 'R', 'P', 'L'};
+const uint16_t VERSION = 2;
+const float TILT_UNITS_PER_RADIAN = 1048576.0f; // 2^20
+
+void writeVarint(std::vector<uint8_t> &out, uint64_t value) {
+  while (value >= 0x80) {
+    out.push_back(static_cast<uint8_t>(value | 0x80));
+    value >>= 7;
+  }
+  out.push_back(static_cast<uint8_t>(value));
+}
+
+bool readVarint(const uint8_t *&p, const uint8_t *end, uint64_t &value) {
+  value = 0;
+  for (int shift = 0; shift < 64 && p < end; shift += 7) {
+    uint8_t byte = *p++;
+    value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if (!(byte & 0x80))
+      return true;
+  }
+  return false;
+}
+
+uint64_t zigzag(int64_t v) {
+  return (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63);
+}
+int64_t unzigzag(uint64_t v) {
+  return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+}
+
+void encodeChange(std::vector<uint8_t> &out, uint64_t ticks,
+                  glm::ivec2 delta) {
+  writeVarint(out, ticks);
+  writeVarint(out, zigzag(delta.x));
+  writeVarint(out, zigzag(delta.y));
+}
+
+// Fixed-size little-endian fields
+template <typename T> void writeRaw(std::vector<uint8_t> &out, T value) {
+  static_assert(sizeof(T) <= 8, "writeRaw: scalar types only");
+  uint64_t bits = 0;
+  std::memcpy(&bits, &value, sizeof(T));
+  for (size_t i = 0; i < sizeof(T); ++i)
+    out.push_back(static_cast<uint8_t>(bits >> (8 * i)));
+}
+
+template <typename T>
+bool readRaw(const uint8_t *&p, const uint8_t *end, T &value) {
+  if (end - p < static_cast<ptrdiff_t>(sizeof(T)))
+    return false;
+  uint64_t bits = 0;
+  for (size_t i = 0; i < sizeof(T); ++i)
+    bits |= static_cast<uint64_t>(p[i]) << (8 * i);
+  std::memcpy(&value, &bits, sizeof(T));
+  p += sizeof(T);
+  return true;
+}
+
+uint64_t maxTicks() {
+  return static_cast<uint64_t>(Config::PHYSICS_TICK_RATE * 60.0f) *
+         Config::REPLAY_MAX_MINUTES;
+}
+
+bool sameBits(glm::vec3 a, glm::vec3 b) {
+  return std::memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+}
+
+} // namespace
+
+Replay::Settings Replay::Settings::current() {
+  Settings s;
+  s.tickRate = Config::PHYSICS_TICK_RATE;
+  s.gravity = Config::BALL_GRAVITY;
+  s.friction = Config::BALL_FRICTION;
+  s.maxSpeed = Config::BALL_MAX_SPEED;
+  s.bounce = Config::BALL_BOUNCE;
+  s.ballRadius = Config::BALL_RADIUS;
+  s.contactSkin = Config::BALL_CONTACT_SKIN;
+  s.frictionReferenceRate = Config::BALL_FRICTION_REFERENCE_RATE;
+  s.maxSweepContacts = Config::BALL_MAX_SWEEP_CONTACTS;
+  s.sdfSamplesPerCell = Config::SDF_SAMPLES_PER_CELL;
+  s.sdfMaxMegabytes = Config::SDF_MAX_MEGABYTES;
+  s.sdfPushIterations = Config::SDF_PUSH_ITERATIONS;
+  s.marbleCount = Config::MARBLE_COUNT;
+  s.marbleIterations = Config::MARBLE_SOLVER_ITERATIONS;
+  s.marbleRestitution = Config::MARBLE_RESTITUTION;
+  s.marbleRestitutionThreshold = Config::MARBLE_RESTITUTION_THRESHOLD;
+  s.marbleBaumgarte = Config::MARBLE_BAUMGARTE;
+  s.marbleSlop = Config::MARBLE_SLOP;
+  return s;
+}
+
+bool Replay::Settings::operator==(const Settings &o) const {
+  return tickRate == o.tickRate && gravity == o.gravity &&
+         friction == o.friction && maxSpeed == o.maxSpeed &&
+         bounce == o.bounce && ballRadius == o.ballRadius &&
+         contactSkin == o.contactSkin &&
+         frictionReferenceRate == o.frictionReferenceRate &&
+         maxSweepContacts == o.maxSweepContacts &&
+         sdfSamplesPerCell == o.sdfSamplesPerCell &&
+         sdfMaxMegabytes == o.sdfMaxMegabytes &&
+         sdfPushIterations == o.sdfPushIterations &&
+         marbleCount == o.marbleCount &&
+         marbleIterations == o.marbleIterations &&
+         marbleRestitution == o.marbleRestitution &&
+         marbleRestitutionThreshold == o.marbleRestitutionThreshold &&
+         marbleBaumgarte == o.marbleBaumgarte && marbleSlop == o.marbleSlop;
+}
+
+uint64_t Replay::hashLevel(const Level &level) {
+  // FNV-1a over the size, cell size and every cell
+  uint64_t hash = 14695981039346656037ull;
+  auto mix = [&hash](uint8_t byte) {
+    hash ^= byte;
+    hash *= 1099511628211ull;
+  };
+  std::vector<uint8_t> header;
+  writeRaw(header, static_cast<int32_t>(level.width));
+  writeRaw(header, static_cast<int32_t>(level.height));
+  writeRaw(header, level.cellSize);
+  for (uint8_t byte : header)
+    mix(byte);
+  for (int y = 0; y < level.height; ++y) {
+    for (int x = 0; x < level.width; ++x)
+      mix(static_cast<uint8_t>(level.cells.at(x, y)));
+  }
+  return hash;
+}
+
+glm::ivec2 Replay::tiltToUnits(glm::vec2 tiltRadians) {
+  return glm::ivec2(
+      static_cast<int>(std::lround(tiltRadians.x * TILT_UNITS_PER_RADIAN)),
+      static_cast<int>(std::lround(tiltRadians.y * TILT_UNITS_PER_RADIAN)));
+}
+
+glm::vec2 Replay::unitsToTilt(glm::ivec2 units) {
+  return glm::vec2(units) / TILT_UNITS_PER_RADIAN;
+}
+
+void Replay::begin(const Level &level, bool multi, uint32_t seed) {
+  levelHash = hashLevel(level);
+  settings = Settings::current();
+  multiMarble = multi;
+  marbleSeed = seed;
+  outcome = Outcome();
+  inputs.clear();
+  ticks = 0;
+  finished = false;
+  current = glm::ivec2(0);
+  pendingDelta = glm::ivec2(0);
+  pendingTicks = 0;
+}
+
+void Replay::record(glm::vec2 tiltRadians) {
+  glm::ivec2 units = tiltToUnits(tiltRadians);
+  if (pendingTicks > 0 && units == current) {
+    pendingTicks++;
+  } else {
+    flush();
+    pendingDelta = units - current;
+    current = units;
+    pendingTicks = 1;
+  }
+  ticks++;
+}
+
+void Replay::flush() {
+  if (pendingTicks > 0)
+    encodeChange(inputs, pendingTicks, pendingDelta);
+  pendingTicks = 0;
+}
+
+void Replay::finish(const Simulation &simulation) {
+  flush();
+  outcome.phase = simulation.phase;
+  outcome.ticks = simulation.tickCount;
+  outcome.position = simulation.ball.position;
+  outcome.velocity = simulation.ball.velocity;
+  finished = true;
+}
+
+void Replay::discard() {
+  inputs.clear();
+  ticks = 0;
+  finished = false;
+  pendingTicks = 0;
+}
+
+template <typename Visit> bool Replay::forEachChange(Visit visit) const {
+  uint64_t seen = 0;
+  glm::ivec2 units(0);
+  auto change = [&](uint64_t run, glm::ivec2 delta) {
+    if (run > ticks - seen)
+      return false;
+    seen += run;
+    units += delta;
+    visit(run, unitsToTilt(units));
+    return true;
+  };
+  const uint8_t *p = inputs.data(), *end = p + inputs.size();
+  while (p < end) {
+    uint64_t run, dx, dz;
+    if (!readVarint(p, end, run) || !readVarint(p, end, dx) ||
+        !readVarint(p, end, dz) ||
+        !change(run, glm::ivec2(static_cast<int>(unzigzag(dx)),
+                                static_cast<int>(unzigzag(dz)))))
+      return false;
+  }
+  if (pendingTicks > 0 && !change(pendingTicks, pendingDelta))
+    return false;
+  return seen == ticks;
+}
+
+std::vector<glm::vec2> Replay::decodeInputs() const {
+  // Check that the runs add up before allocating for them
+  if (!forEachChange([](uint64_t, glm::vec2) {}))
+    return {};
+  std::vector<glm::vec2> tilts;
+  tilts.reserve(ticks);
+  forEachChange([&tilts](uint64_t run, glm::vec2 tilt) {
+    tilts.insert(tilts.end(), run, tilt);
+  });
+  return tilts;
+}
+
+Replay::Verification Replay::verify(const Level &level) const {
+  Verification result;
+  if (hashLevel(level) != levelHash) {
+    result.error = "level does not match";
+    return result;
+  }
+  if (!(settings == Settings::current())) {
+    result.error = "recorded with different physics settings";
+    return result;
+  }
+  if (!forEachChange([](uint64_t, glm::vec2) {})) {
+    result.error = "corrupt input stream";
+    return result;
+  }
+
+  auto start = std::chrono::steady_clock::now();
+  Simulation sim;
+  sim.setLevel(&level);
+  sim.setMarbleSeed(marbleSeed);
+  sim.setMultiMarble(multiMarble); // Restarts with that seed
+  const float step = PhysicsClock(settings.tickRate, 1).getStep();
+  // Fed straight from the stream; a long run is never expanded in memory
+  forEachChange([&](uint64_t run, glm::vec2 tilt) {
+    for (uint64_t i = 0; i < run && sim.phase == GamePhase::Playing; ++i)
+      sim.tick(step, tilt);
+  });
+  result.seconds = std::chrono::duration<double>(
+                       std::chrono::steady_clock::now() - start)
+                       .count();
+
+  result.replayed.phase = sim.phase;
+  result.replayed.ticks = sim.tickCount;
+  result.replayed.position = sim.ball.position;
+  result.replayed.velocity = sim.ball.velocity;
+
+  if (result.replayed.ticks != outcome.ticks)
+    result.error = "tick count differs";
+  else if (result.replayed.phase != outcome.phase)
+    result.error = "outcome differs";
+  else if (!sameBits(result.replayed.position, outcome.position) ||
+           !sameBits(result.replayed.velocity, outcome.velocity))
+    result.error = "final ball state differs";
+  result.ok = result.error.empty();
+  return result;
+}
+
+std::vector<uint8_t> Replay::serialize() const {
+  std::vector<uint8_t> out(MAGIC, MAGIC + 4);
+  writeRaw(out, VERSION);
+  writeRaw(out, static_cast<uint8_t>((multiMarble ? 1 : 0) |
+                                     (finished ? 2 : 0)));
+  writeRaw(out, static_cast<uint8_t>(0));
+  writeRaw(out, levelHash);
+
+  const Settings &s = settings;
+  for (float f : {s.tickRate, s.gravity, s.friction, s.maxSpeed, s.bounce,
+                  s.ballRadius, s.contactSkin, s.frictionReferenceRate})
+    writeRaw(out, f);
+  for (int32_t i : {s.maxSweepContacts, s.sdfSamplesPerCell,
+                    s.sdfMaxMegabytes, s.sdfPushIterations, s.marbleCount,
+                    s.marbleIterations})
+    writeRaw(out, i);
+  for (float f : {s.marbleRestitution, s.marbleRestitutionThreshold,
+                  s.marbleBaumgarte, s.marbleSlop})
+    writeRaw(out, f);
+  writeRaw(out, marbleSeed);
+
+  writeRaw(out, static_cast<uint8_t>(outcome.phase));
+  writeRaw(out, outcome.ticks);
+  for (int i = 0; i < 3; ++i)
+    writeRaw(out, outcome.position[i]);
+  for (int i = 0; i < 3; ++i)
+    writeRaw(out, outcome.velocity[i]);
+
+  std::vector<uint8_t> stream = inputs;
+  if (pendingTicks > 0)
+    encodeChange(stream, pendingTicks, pendingDelta);
+  writeVarint(out, ticks);
+  writeVarint(out, stream.size());
+  out.insert(out.end(), stream.begin(), stream.end());
+  return out;
+}
+
+bool Replay::deserialize(const std::vector<uint8_t> &bytes) {
+  const uint8_t *p = bytes.data(), *end = p + bytes.size();
+  if (bytes.size() < 4 || std::memcmp(p, MAGIC, 4) != 0)
+    return false;
+  p += 4;
+
+  Replay r;
+  uint16_t version;
+  uint8_t flags = 0, reserved = 0, phase = 0;
+  Settings &s = r.settings;
+  bool ok = readRaw(p, end, version) && version == VERSION &&
+            readRaw(p, end, flags) && readRaw(p, end, reserved) &&
+            readRaw(p, end, r.levelHash);
+  for (float *f : {&s.tickRate, &s.gravity, &s.friction, &s.maxSpeed,
+                   &s.bounce, &s.ballRadius, &s.contactSkin,
+                   &s.frictionReferenceRate})
+    ok = ok && readRaw(p, end, *f);
+  for (int32_t *i : {&s.maxSweepContacts, &s.sdfSamplesPerCell,
+                     &s.sdfMaxMegabytes, &s.sdfPushIterations,
+                     &s.marbleCount, &s.marbleIterations})
+    ok = ok && readRaw(p, end, *i);
+  for (float *f : {&s.marbleRestitution, &s.marbleRestitutionThreshold,
+                   &s.marbleBaumgarte, &s.marbleSlop})
+    ok = ok && readRaw(p, end, *f);
+  ok = ok && readRaw(p, end, r.marbleSeed) && readRaw(p, end, phase) &&
+       phase <= static_cast<uint8_t>(GamePhase::Failed) &&
+       readRaw(p, end, r.outcome.ticks);
+  for (int i = 0; i < 3; ++i)
+    ok = ok && readRaw(p, end, r.outcome.position[i]);
+  for (int i = 0; i < 3; ++i)
+    ok = ok && readRaw(p, end, r.outcome.velocity[i]);
+
+  uint64_t streamSize = 0;
+  // Saved runs are finished, so every recorded tick was simulated
+  ok = ok && readVarint(p, end, r.ticks) && r.ticks == r.outcome.ticks &&
+       r.ticks <= maxTicks() && readVarint(p, end, streamSize) &&
+       streamSize == static_cast<uint64_t>(end - p);
+  if (!ok)
+    return false;
+
+  r.multiMarble = flags & 1;
+  r.finished = flags & 2;
+  r.outcome.phase = static_cast<GamePhase>(phase);
+  r.inputs.assign(p, end);
+  *this = std::move(r);
+  return true;
+}
+
+bool Replay::save(const std::string &path) const {
+  if (ticks > maxTicks())
+    return false;
+  std::ofstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<uint8_t> bytes = serialize();
+  file.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+  return file.good();
+}
+
+bool Replay::load(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file.is_open())
+    return false;
+  std::vector<uint8_t> bytes((std::istreambuf_iterator<char>(file)),
+                             std::istreambuf_iterator<char>());
+  return deserialize(bytes);
+}
@@ -0,0 +1,196 @@
+#include "RewindBuffer.h"
+#include "Ball.h"
+#include <algorithm>
+#include <cstring>
+
+void RewindBuffer::Frame::apply(Ball &ball) const {
+  ball.position = position;
+  ball.velocity = velocity;
+  ball.previousPosition = previousPosition;
+  ball.fallProgress = fallProgress;
+  ball.isFalling = isFalling;
+}
+
+RewindBuffer::RewindBuffer(size_t arenaBytes, int interval)
+    : arena(std::max<size_t>(arenaBytes, 4 * MAX_FRAME_BYTES)),
+      keyframeInterval(std::max(interval, 1)),
+      segments(arena.size() / (WORDS * 4) + 1) {}
+
+void RewindBuffer::clear() {
+  writePos = 0;
+  usedBytes = 0;
+  firstSegment = 0;
+  segmentCount = 0;
+  newestTick = 0;
+}
+
+uint64_t RewindBuffer::getOldestTick() const {
+  return segmentCount ? segment(0).firstTick : 0;
+}
+
+void RewindBuffer::toWords(const Frame &f, uint32_t *w) {
+  std::memcpy(w + 0, &f.position, 12);
+  std::memcpy(w + 3, &f.velocity, 12);
+  std::memcpy(w + 6, &f.previousPosition, 12);
+  std::memcpy(w + 9, &f.fallProgress, 4);
+  w[10] = f.isFalling ? 1u : 0u;
+  std::memcpy(w + 11, &f.tilt, 8);
+}
+
+void RewindBuffer::fromWords(const uint32_t *w, Frame &f) {
+  std::memcpy(&f.position, w + 0, 12);
+  std::memcpy(&f.velocity, w + 3, 12);
+  std::memcpy(&f.previousPosition, w + 6, 12);
+  std::memcpy(&f.fallProgress, w + 9, 4);
+  f.isFalling = w[10] != 0;
+  std::memcpy(&f.tilt, w + 11, 8);
+}
+
+void RewindBuffer::predict(const uint32_t *previous, uint32_t *prediction) {
+  std::copy_n(previous, WORDS, prediction);
+  // Last tick's position becomes this tick's previousPosition
+  std::copy_n(previous, 3, prediction + 6);
+}
+
+void RewindBuffer::write(const uint8_t *bytes, size_t count) {
+  for (size_t i = 0; i < count; ++i) {
+    arena[writePos] = bytes[i];
+    writePos = writePos + 1 == arena.size() ? 0 : writePos + 1;
+  }
+}
+
+void RewindBuffer::push(uint64_t tick, const Ball &ball, glm::vec2 tilt) {
+  Frame frame;
+  frame.position = ball.position;
+  frame.velocity = ball.velocity;
+  frame.previousPosition = ball.previousPosition;
+  frame.fallProgress = ball.fallProgress;
+  frame.isFalling = ball.isFalling;
+  frame.tilt = tilt;
+  uint32_t words[WORDS];
+  toWords(frame, words);
+
+  bool keyframe = segmentCount == 0 || tick != newestTick + 1 ||
+                  segment(segmentCount - 1).frames >= keyframeInterval;
+
+  uint8_t buffer[MAX_FRAME_BYTES];
+  size_t length = 0;
+  auto encode = [&]() {
+    length = 0;
+    if (keyframe) {
+      for (uint32_t word : words) {
+        for (int b = 0; b < 4; ++b)
+          buffer[length++] = static_cast<uint8_t>(word >> (8 * b));
+      }
+      return;
+    }
+    uint32_t prediction[WORDS];
+    predict(last, prediction);
+    for (int i = 0; i < WORDS; ++i) {
+      uint32_t x = words[i] ^ prediction[i];
+      while (x >= 0x80) {
+        buffer[length++] = static_cast<uint8_t>(x | 0x80);
+        x >>= 7;
+      }
+      buffer[length++] = static_cast<uint8_t>(x);
+    }
+  };
+  encode();
+
+  // Make room by dropping the oldest segments. If that would drop the
+  // segment being extended, start a fresh keyframe instead.
+  while (usedBytes + length > arena.size() ||
+         (keyframe && segmentCount == segments.size())) {
+    if (!keyframe && segmentCount == 1) {
+      keyframe = true;
+      encode();
+    }
+    usedBytes -= segment(0).bytes;
+    firstSegment = (firstSegment + 1) % segments.size();
+    segmentCount--;
+  }
+
+  if (keyframe) {
+    segment(segmentCount) = Segment{tick, writePos, 0, 0};
+    segmentCount++;
+  }
+  Segment &current = segment(segmentCount - 1);
+  write(buffer, length);
+  current.bytes += length;
+  current.frames++;
+  usedBytes += length;
+  newestTick = tick;
+  std::copy_n(words, WORDS, last);
+}
+
+size_t RewindBuffer::decode(const Segment &seg, int frameIndex,
+                            uint32_t *words) const {
+  size_t pos = seg.offset;
+  auto next = [&]() {
+    uint8_t byte = arena[pos];
+    pos = pos + 1 == arena.size() ? 0 : pos + 1;
+    return byte;
+  };
+
+  for (int i = 0; i < WORDS; ++i) {
+    uint32_t word = 0;
+    for (int b = 0; b < 4; ++b)
+      word |= static_cast<uint32_t>(next()) << (8 * b);
+    words[i] = word;
+  }
+  size_t consumed = WORDS * 4;
+
+  for (int f = 1; f <= frameIndex; ++f) {
+    uint32_t prediction[WORDS];
+    predict(words, prediction);
+    for (int i = 0; i < WORDS; ++i) {
+      uint32_t x = 0;
+      for (int shift = 0;; shift += 7) {
+        uint8_t byte = next();
+        consumed++;
+        x |= static_cast<uint32_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          break;
+      }
+      words[i] = x ^ prediction[i];
+    }
+  }
+  return consumed;
+}
+
+bool RewindBuffer::restore(uint64_t tick, Frame &out) const {
+  for (size_t i = segmentCount; i-- > 0;) {
+    const Segment &seg = segment(i);
+    if (tick < seg.firstTick)
+      continue;
+    if (tick >= seg.firstTick + seg.frames)
+      return false;
+    uint32_t words[WORDS];
+    decode(seg, static_cast<int>(tick - seg.firstTick), words);
+    fromWords(words, out);
+    return true;
+  }
+  return false;
+}
+
+void RewindBuffer::truncateAfter(uint64_t tick) {
+  if (segmentCount == 0 || tick >= newestTick)
+    return;
+  if (tick < getOldestTick()) {
+    clear();
+    return;
+  }
+
+  size_t i = segmentCount;
+  while (segment(i - 1).firstTick > tick)
+    usedBytes -= segment(--i).bytes;
+  Segment &seg = segment(i - 1);
+  int frameIndex = static_cast<int>(tick - seg.firstTick);
+  size_t consumed = decode(seg, frameIndex, last);
+  usedBytes -= seg.bytes - consumed;
+  seg.bytes = consumed;
+  seg.frames = frameIndex + 1;
+  writePos = (seg.offset + consumed) % arena.size();
+  segmentCount = i;
+  newestTick = tick;
+}
@@ -1,58 +1,201 @@
 #include "Shader.h"
+#include "ProgramCache.h"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <utility>
+
+// Same value for the KHR and ARB extensions
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+bool Shader::readFile(const std::string &path, std::string &out) {
+  std::ifstream file;
+  file.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  try {
+    file.open(path);
+    std::stringstream stream;
+    stream << file.rdbuf();
+    out = stream.str();
+  } catch (std::ifstream::failure &e) {
+    std::cerr << "ERROR::SHADER::FILE_NOT_READ: " << path << ": " << e.what()
+              << std::endl;
+    return false;
+  }
+  return true;
+}
 
 bool Shader::load(const std::string &vertexPath,
                   const std::string &fragmentPath) {
   // 1. Read shader source code from files
   std::string vertexCode, fragmentCode;
-  std::ifstream vShaderFile, fShaderFile;
-
-  vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
-  fShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+  if (!readFile(vertexPath, vertexCode) ||
+      !readFile(fragmentPath, fragmentCode))
+    return false;
+  return compile(vertexCode, fragmentCode);
+}
 
-  try {
-    vShaderFile.open(vertexPath);
-    fShaderFile.open(fragmentPath);
+// Defines go straight after the #version line, which must stay first. The
+// #line keeps compile errors pointing at the lines of the file.
+static std::string withDefines(const std::string &source,
+                               const std::string &defines) {
+  if (defines.empty())
+    return source;
+  size_t line = source.compare(0, 8, "#version") == 0 ? source.find('\n')
+                                                      : std::string::npos;
+  if (line == std::string::npos)
+    return defines + "#line 1\n" + source;
+  return source.substr(0, line + 1) + defines + "#line 2\n" +
+         source.substr(line + 1);
+}
 
-    std::stringstream vShaderStream, fShaderStream;
-    vShaderStream << vShaderFile.rdbuf();
-    fShaderStream << fShaderFile.rdbuf();
+bool Shader::compile(const std::string &vertexCode,
+                     const std::string &fragmentCode,
+                     const std::string &defines) {
+  submit(vertexCode, fragmentCode, defines);
+  return poll(true) == Status::Ready;
+}
 
-    vShaderFile.close();
-    fShaderFile.close();
+void Shader::submit(const std::string &vertexCode,
+                    const std::string &fragmentCode,
+                    const std::string &defines) {
+  cleanup();
+  std::string vertexSource = withDefines(vertexCode, defines);
+  std::string fragmentSource = withDefines(fragmentCode, defines);
 
-    vertexCode = vShaderStream.str();
-    fragmentCode = fShaderStream.str();
-  } catch (std::ifstream::failure &e) {
-    std::cerr << "ERROR::SHADER::FILE_NOT_READ: " << e.what() << std::endl;
-    return false;
+  // 2. A binary saved by an earlier launch skips compiling and linking
+  pendingKey = ProgramCache::key(vertexSource, fragmentSource);
+  ID = glCreateProgram();
+  if (ProgramCache::load(ID, pendingKey)) {
+    listUniforms();
+    status = Status::Ready;
+    return;
   }
+  glDeleteProgram(ID);
+  ID = 0;
+  status = Status::Pending;
 
-  // 2. Compile shaders
-  unsigned int vertex = compileShader(vertexCode, GL_VERTEX_SHADER);
-  if (!checkCompileErrors(vertex, "VERTEX"))
-    return false;
-
-  unsigned int fragment = compileShader(fragmentCode, GL_FRAGMENT_SHADER);
-  if (!checkCompileErrors(fragment, "FRAGMENT"))
-    return false;
+  // 3. Compile shaders and link program, leaving the driver to it. A
+  // driver without parallel compile would do it all at the first status
+  // query, so poll() hands it over a stage at a time instead.
+  if (!parallelCompile) {
+    stagedVertex = std::move(vertexSource);
+    stagedFragment = std::move(fragmentSource);
+    stagesLeft = 3;
+    return;
+  }
+  pendingVertex = compileShader(vertexSource, GL_VERTEX_SHADER);
+  pendingFragment = compileShader(fragmentSource, GL_FRAGMENT_SHADER);
+  link();
+}
 
-  // 3. Link program
+void Shader::link() {
   ID = glCreateProgram();
-  glAttachShader(ID, vertex);
-  glAttachShader(ID, fragment);
+  ProgramCache::prepare(ID);
+  glAttachShader(ID, pendingVertex);
+  glAttachShader(ID, pendingFragment);
   glLinkProgram(ID);
+}
 
-  if (!checkCompileErrors(ID, "PROGRAM"))
-    return false;
+void Shader::step() {
+  // The status query makes a lazy driver compile now, not at the link
+  GLint done = GL_FALSE;
+  switch (stagesLeft--) {
+  case 3:
+    pendingVertex = compileShader(stagedVertex, GL_VERTEX_SHADER);
+    glGetShaderiv(pendingVertex, GL_COMPILE_STATUS, &done);
+    std::string().swap(stagedVertex);
+    break;
+  case 2:
+    pendingFragment = compileShader(stagedFragment, GL_FRAGMENT_SHADER);
+    glGetShaderiv(pendingFragment, GL_COMPILE_STATUS, &done);
+    std::string().swap(stagedFragment);
+    break;
+  default:
+    link(); // Waited for by poll()'s checks
+    break;
+  }
+}
+
+Shader::Status Shader::poll(bool wait) {
+  if (status != Status::Pending)
+    return status;
+  if (stagesLeft > 0) {
+    do
+      step();
+    while (wait && stagesLeft > 0);
+    if (stagesLeft > 0)
+      return status;
+  } else if (!wait && parallelCompile) {
+    GLint done = GL_FALSE;
+    glGetProgramiv(ID, GL_COMPLETION_STATUS_KHR, &done);
+    if (!done)
+      return status;
+  }
 
-  // 4. Clean up individual shaders (they're now linked into the program)
-  glDeleteShader(vertex);
-  glDeleteShader(fragment);
+  // 4. Check each step, reporting the first that failed
+  bool ok = checkCompileErrors(pendingVertex, "VERTEX") &&
+            checkCompileErrors(pendingFragment, "FRAGMENT") &&
+            checkCompileErrors(ID, "PROGRAM");
 
-  return true;
+  // 5. Clean up individual shaders (they're now linked into the program)
+  glDeleteShader(pendingVertex);
+  glDeleteShader(pendingFragment);
+  pendingVertex = pendingFragment = 0;
+
+  if (!ok) {
+    cleanup();
+    return status;
+  }
+  listUniforms();
+  ProgramCache::store(ID, pendingKey);
+  status = Status::Ready;
+  return status;
+}
+
+bool Shader::parallelCompile = false;
+
+bool Shader::enableParallelCompile(GLADloadproc load) {
+  using MaxThreads = void(APIENTRYP)(GLuint count);
+  GLint count = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+  for (GLint i = 0; i < count; ++i) {
+    std::string name =
+        reinterpret_cast<const char *>(glGetStringi(GL_EXTENSIONS, i));
+    const char *function = nullptr;
+    if (name == "GL_KHR_parallel_shader_compile")
+      function = "glMaxShaderCompilerThreadsKHR";
+    else if (name == "GL_ARB_parallel_shader_compile")
+      function = "glMaxShaderCompilerThreadsARB";
+    else
+      continue;
+    // As many threads as the driver likes
+    auto maxThreads = reinterpret_cast<MaxThreads>(load(function));
+    if (maxThreads)
+      maxThreads(0xFFFFFFFFu);
+    parallelCompile = true;
+    return true;
+  }
+  return false;
+}
+
+void Shader::cleanup() {
+  if (pendingVertex)
+    glDeleteShader(pendingVertex);
+  if (pendingFragment)
+    glDeleteShader(pendingFragment);
+  pendingVertex = pendingFragment = 0;
+  std::string().swap(stagedVertex);
+  std::string().swap(stagedFragment);
+  stagesLeft = 0;
+  if (ID)
+    glDeleteProgram(ID);
+  ID = 0;
+  entries.clear();
+  names.clear();
+  status = Status::Failed;
 }
 
 unsigned int Shader::compileShader(const std::string &source, GLenum type) {
@@ -88,44 +231,167 @@ bool Shader::checkCompileErrors(unsigned int shader, const std::string &type) {
 
 void Shader::use() const { glUseProgram(ID); }
 
-int Shader::getUniformLocation(const std::string &name) const {
-  auto it = uniformCache.find(name);
-  if (it != uniformCache.end()) {
-    return it->second;
+Shader::UniformStats Shader::stats;
+
+void Shader::listUniforms() {
+  entries.clear();
+  names.clear();
+  GLint count = 0, maxLength = 0;
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+  glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxLength);
+  std::vector<char> buffer(std::max(maxLength, 1));
+  auto add = [&](const std::string &name, GLenum type) {
+    int location = glGetUniformLocation(ID, name.c_str());
+    if (location < 0)
+      return;
+    int entry = static_cast<int>(entries.size());
+    names.push_back({uniformHash(name.c_str()), entry});
+    entries.push_back({location, type, false, {}});
+  };
+  for (GLint i = 0; i < count; ++i) {
+    GLint size = 0;
+    GLenum type = 0;
+    glGetActiveUniform(ID, i, maxLength, nullptr, &size, &type,
+                       buffer.data());
+    // Block members have no location; they are set through their buffer
+    std::string name = buffer.data();
+    if (glGetUniformLocation(ID, name.c_str()) < 0)
+      continue;
+    // Arrays are listed once, as "name[0]"; every element gets an entry,
+    // and the bare name is another name for the first, sharing its shadow
+    size_t bracket = name.rfind("[0]");
+    if (size > 1 && bracket == name.size() - 3) {
+      size_t first = entries.size();
+      for (GLint k = 0; k < size; ++k)
+        add(name.substr(0, bracket) + "[" + std::to_string(k) + "]", type);
+      if (entries.size() > first) {
+        name.resize(bracket);
+        names.push_back({uniformHash(name.c_str()), static_cast<int>(first)});
+      }
+    } else {
+      add(name, type);
+    }
+  }
+
+  std::sort(names.begin(), names.end(),
+            [](const Name &a, const Name &b) { return a.hash < b.hash; });
+  for (size_t i = 1; i < names.size(); ++i) {
+    if (names[i].hash == names[i - 1].hash)
+      std::cerr << "WARNING::SHADER::UNIFORM_HASH_COLLISION (program " << ID
+                << ")" << std::endl;
+  }
+}
+
+int Shader::findEntry(uint32_t hash) const {
+  auto it = std::lower_bound(
+      names.begin(), names.end(), hash,
+      [](const Name &name, uint32_t value) { return name.hash < value; });
+  if (it == names.end() || it->hash != hash)
+    return -1;
+  return it->entry;
+}
+
+void Shader::reportMismatch(int entry) const {
+  std::cerr << "ERROR::SHADER::UNIFORM_TYPE_MISMATCH (program " << ID
+            << ", location " << entries[entry].location << ")" << std::endl;
+}
+
+bool Shader::accepts(GLenum declared, GLenum wanted) {
+  if (declared == wanted)
+    return true;
+  // Samplers are set by texture unit
+  switch (declared) {
+  case GL_SAMPLER_2D:
+  case GL_SAMPLER_3D:
+  case GL_SAMPLER_CUBE:
+  case GL_SAMPLER_2D_SHADOW:
+  case GL_SAMPLER_2D_ARRAY:
+  case GL_INT_SAMPLER_2D:
+  case GL_UNSIGNED_INT_SAMPLER_2D:
+    return wanted == GL_INT;
+  default:
+    return false;
   }
-  int location = glGetUniformLocation(ID, name.c_str());
-  uniformCache[name] = location;
-  return location;
 }
 
-void Shader::setBool(const std::string &name, bool value) const {
-  glUniform1i(getUniformLocation(name), (int)value);
+Shader::UniformStats Shader::takeUniformStats() {
+  UniformStats taken = stats;
+  stats = UniformStats();
+  return taken;
+}
+
+void Shader::setBool(UniformName name, bool value) const {
+  set(Uniform<bool>{findEntry(name.hash)}, value);
+}
+
+void Shader::setInt(UniformName name, int value) const {
+  set(Uniform<int>{findEntry(name.hash)}, value);
+}
+
+void Shader::setFloat(UniformName name, float value) const {
+  set(Uniform<float>{findEntry(name.hash)}, value);
+}
+
+void Shader::setVec2(UniformName name, const glm::vec2 &value) const {
+  set(Uniform<glm::vec2>{findEntry(name.hash)}, value);
+}
+
+void Shader::setIVec2(UniformName name, const glm::ivec2 &value) const {
+  set(Uniform<glm::ivec2>{findEntry(name.hash)}, value);
+}
+
+void Shader::setVec3(UniformName name, const glm::vec3 &value) const {
+  set(Uniform<glm::vec3>{findEntry(name.hash)}, value);
+}
+
+void Shader::setVec4(UniformName name, const glm::vec4 &value) const {
+  set(Uniform<glm::vec4>{findEntry(name.hash)}, value);
+}
+
+void Shader::setMat3(UniformName name, const glm::mat3 &value) const {
+  set(Uniform<glm::mat3>{findEntry(name.hash)}, value);
+}
+
+void Shader::setMat4(UniformName name, const glm::mat4 &value) const {
+  set(Uniform<glm::mat4>{findEntry(name.hash)}, value);
+}
+
+void Shader::send(int location, bool value) {
+  glUniform1i(location, (int)value);
+}
+
+void Shader::send(int location, int value) { glUniform1i(location, value); }
+
+void Shader::send(int location, float value) {
+  glUniform1f(location, value);
 }
 
-void Shader::setInt(const std::string &name, int value) const {
-  glUniform1i(getUniformLocation(name), value);
+void Shader::send(int location, const glm::vec2 &value) {
+  glUniform2fv(location, 1, &value[0]);
 }
 
-void Shader::setFloat(const std::string &name, float value) const {
-  glUniform1f(getUniformLocation(name), value);
+void Shader::send(int location, const glm::ivec2 &value) {
+  glUniform2iv(location, 1, &value[0]);
 }
 
-void Shader::setVec2(const std::string &name, const glm::vec2 &value) const {
-  glUniform2fv(getUniformLocation(name), 1, &value[0]);
+void Shader::send(int location, const glm::vec3 &value) {
+  glUniform3fv(location, 1, &value[0]);
 }
 
-void Shader::setVec3(const std::string &name, const glm::vec3 &value) const {
-  glUniform3fv(getUniformLocation(name), 1, &value[0]);
+void Shader::send(int location, const glm::vec4 &value) {
+  glUniform4fv(location, 1, &value[0]);
 }
 
-void Shader::setVec4(const std::string &name, const glm::vec4 &value) const {
-  glUniform4fv(getUniformLocation(name), 1, &value[0]);
+void Shader::send(int location, const glm::mat3 &value) {
+  glUniformMatrix3fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
-void Shader::setMat3(const std::string &name, const glm::mat3 &value) const {
-  glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE, &value[0][0]);
+void Shader::send(int location, const glm::mat4 &value) {
+  glUniformMatrix4fv(location, 1, GL_FALSE, &value[0][0]);
 }
 
-void Shader::setMat4(const std::string &name, const glm::mat4 &value) const {
-  glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE, &value[0][0]);
+void Shader::bindBlock(const std::string &name, unsigned int binding) const {
+  unsigned int index = glGetUniformBlockIndex(ID, name.c_str());
+  if (index != GL_INVALID_INDEX)
+    glUniformBlockBinding(ID, index, binding);
 }
@@ -0,0 +1,104 @@
+#include "ShaderPermutations.h"
+#include <bitset>
+#include <iostream>
+#include <utility>
+
+bool ShaderPermutations::load(const std::string &vertexPath,
+                              const std::string &fragmentPath,
+                              std::vector<std::string> features,
+                              Setup setupHook) {
+  cleanup();
+  featureNames = std::move(features);
+  setup = std::move(setupHook);
+  return Shader::readFile(vertexPath, vertexCode) &&
+         Shader::readFile(fragmentPath, fragmentCode);
+}
+
+void ShaderPermutations::request(uint32_t features) {
+  if (variants.count(features))
+    return;
+  Shader &shader = variants[features];
+  order.push_back(features);
+  shader.submit(vertexCode, fragmentCode, defines(features));
+  // Programs from the cache are ready straight away
+  if (shader.getStatus() == Shader::Status::Ready)
+    finish(features, shader);
+}
+
+const Shader *ShaderPermutations::require(uint32_t features) {
+  request(features);
+  Shader &shader = variants[features];
+  if (shader.getStatus() == Shader::Status::Pending) {
+    shader.poll(true);
+    finish(features, shader);
+  }
+  return shader.getStatus() == Shader::Status::Ready ? &shader : nullptr;
+}
+
+const Shader *ShaderPermutations::get(uint32_t features) {
+  request(features);
+  const Shader *best = nullptr;
+  int bestCount = -1;
+  for (auto &[mask, shader] : variants) {
+    if (shader.getStatus() != Shader::Status::Ready ||
+        (mask & ~features) != 0)
+      continue;
+    if (mask == features)
+      return &shader;
+    int count = static_cast<int>(std::bitset<32>(mask).count());
+    if (count > bestCount) {
+      best = &shader;
+      bestCount = count;
+    }
+  }
+  return best;
+}
+
+void ShaderPermutations::update() {
+  for (uint32_t mask : order) {
+    Shader &shader = variants[mask];
+    if (shader.getStatus() != Shader::Status::Pending)
+      continue;
+    if (shader.poll(false) != Shader::Status::Pending)
+      finish(mask, shader);
+    // Without parallel compile that poll did a stage on this thread; the
+    // rest waits for later frames
+    if (!Shader::hasParallelCompile())
+      return;
+  }
+}
+
+size_t ShaderPermutations::getPendingCount() const {
+  size_t count = 0;
+  for (const auto &variant : variants)
+    count += variant.second.getStatus() == Shader::Status::Pending;
+  return count;
+}
+
+void ShaderPermutations::finish(uint32_t features, Shader &shader) {
+  if (shader.getStatus() != Shader::Status::Ready) {
+    std::cerr << "ERROR::SHADER::VARIANT_FAILED (features " << features << ")"
+              << std::endl;
+    return;
+  }
+  if (setup) {
+    shader.use();
+    setup(shader);
+  }
+}
+
+std::string ShaderPermutations::defines(uint32_t features) const {
+  std::string text;
+  for (size_t i = 0; i < featureNames.size(); ++i) {
+    if (features & (1u << i))
+      text += "#define " + featureNames[i] + "\n";
+  }
+  return text;
+}
+
+void ShaderPermutations::cleanup() {
+  for (auto &variant : variants)
+    variant.second.cleanup();
+  variants.clear();
+  order.clear();
+}
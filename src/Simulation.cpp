@@ -0,0 +1,88 @@
+#include "Simulation.h"
+#include "Config.h"
+#include "Level.h"
+#include "Replay.h"
+#include <algorithm>
+
+Simulation::Simulation()
+    : marbles(Config::BALL_RADIUS),
+      history(Config::REWIND_ARENA_BYTES, Config::REWIND_KEYFRAME_INTERVAL) {}
+
+void Simulation::setMultiMarble(bool enabled) {
+  multiMarble = enabled;
+  restart();
+}
+
+void Simulation::restart() {
+  if (level)
+    ball.reset(*level);
+  marbleSeed = nextMarbleSeed++;
+  marbles.clear();
+  if (multiMarble && level)
+    marbles.spawn(*level, Config::MARBLE_COUNT, marbleSeed);
+  phase = GamePhase::Playing;
+  tickCount = 0;
+  tilt = glm::vec2(0.0f);
+  recording = recorder && level;
+  if (recording)
+    recorder->begin(*level, multiMarble, marbleSeed);
+
+  // The marble crowd is not recorded, so rewind is single-ball only
+  history.clear();
+  if (!multiMarble)
+    history.push(tickCount, ball, tilt);
+}
+
+void Simulation::tick(float dt, glm::vec2 tiltRadians) {
+  if (!level || phase != GamePhase::Playing)
+    return;
+
+  tiltRadians = Replay::quantizeTilt(tiltRadians);
+  tilt = tiltRadians;
+  if (recording)
+    recorder->record(tiltRadians);
+
+  if (multiMarble)
+    marbles.step(dt, tiltRadians, *level, &ball);
+  ball.update(dt, tiltRadians, *level);
+  tickCount++;
+  if (!multiMarble)
+    history.push(tickCount, ball, tilt);
+
+  if (ball.hasFallenInHole())
+    phase = GamePhase::Failed;
+  else if (level->isAtGoal(ball.position, ball.radius))
+    phase = GamePhase::Won;
+
+  // The recorder is reused by the next run; a copy goes out instead
+  if (recording && phase != GamePhase::Playing) {
+    recorder->finish(*this);
+    finishedReplay = std::make_shared<const Replay>(*recorder);
+    recording = false;
+  }
+}
+
+bool Simulation::rewind(uint64_t ticks) {
+  if (multiMarble || phase == GamePhase::Won || history.isEmpty())
+    return false;
+  uint64_t target = tickCount - std::min(ticks, getRewindTicks());
+  RewindBuffer::Frame frame;
+  if (!history.restore(target, frame))
+    return false;
+
+  frame.apply(ball);
+  tilt = frame.tilt;
+  tickCount = target;
+  phase = GamePhase::Playing;
+  history.truncateAfter(target);
+  if (recording)
+    recorder->discard();
+  recording = false;
+  return true;
+}
+
+uint64_t Simulation::getRewindTicks() const {
+  if (multiMarble || history.isEmpty())
+    return 0;
+  return tickCount - history.getOldestTick();
+}
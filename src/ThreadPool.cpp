@@ -0,0 +1,132 @@
+#include "ThreadPool.h"
+#include <algorithm>
+
+// Most indices a batch can hold with both bounds in 32 bits
+static constexpr size_t MAX_BATCH = 0xffffffffu;
+
+static uint64_t packSlice(uint64_t begin, uint64_t end) {
+  return begin | (end << 32);
+}
+
+ThreadPool::ThreadPool(unsigned threads) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  slices = std::make_unique<Slice[]>(threads);
+  workers.reserve(threads - 1);
+  for (unsigned i = 1; i < threads; ++i)
+    workers.emplace_back(&ThreadPool::workerLoop, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    quitting = true;
+  }
+  wake.notify_all();
+  for (std::thread &worker : workers)
+    worker.join();
+}
+
+void ThreadPool::parallelFor(size_t itemCount, const Body &itemBody) {
+  if (itemCount == 0)
+    return;
+  if (workers.empty() || itemCount == 1) {
+    for (size_t i = 0; i < itemCount; ++i)
+      itemBody(i, 0);
+    return;
+  }
+  for (size_t first = 0; first < itemCount; first += MAX_BATCH)
+    runBatch(first, std::min(MAX_BATCH, itemCount - first), itemBody);
+}
+
+void ThreadPool::runBatch(size_t first, size_t itemCount,
+                          const Body &itemBody) {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    body = &itemBody;
+    base = first;
+    unsigned threads = getThreadCount();
+    for (unsigned i = 0; i < threads; ++i) {
+      slices[i].bounds.store(packSlice(itemCount * i / threads,
+                                       itemCount * (i + 1) / threads),
+                             std::memory_order_relaxed);
+    }
+    busy = static_cast<unsigned>(workers.size());
+    generation++;
+  }
+  wake.notify_all();
+
+  drain(0);
+
+  // Workers that arrive late find nothing left to steal and check out
+  std::unique_lock<std::mutex> lock(mutex);
+  done.wait(lock, [this] { return busy == 0; });
+  body = nullptr;
+}
+
+void ThreadPool::workerLoop(unsigned worker) {
+  uint64_t seen = 0;
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&] { return quitting || generation != seen; });
+      if (quitting)
+        return;
+      seen = generation;
+    }
+
+    drain(worker);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (--busy == 0)
+      done.notify_one();
+  }
+}
+
+void ThreadPool::drain(unsigned worker) {
+  size_t index;
+  for (;;) {
+    while (takeFront(worker, index))
+      (*body)(base + index, worker);
+    if (!steal(worker))
+      return;
+  }
+}
+
+bool ThreadPool::takeFront(unsigned worker, size_t &index) {
+  std::atomic<uint64_t> &bounds = slices[worker].bounds;
+  uint64_t slice = bounds.load(std::memory_order_acquire);
+  for (;;) {
+    uint64_t begin = slice & 0xffffffffu, end = slice >> 32;
+    if (begin >= end)
+      return false;
+    if (bounds.compare_exchange_weak(slice, packSlice(begin + 1, end),
+                                     std::memory_order_acq_rel)) {
+      index = static_cast<size_t>(begin);
+      return true;
+    }
+  }
+}
+
+// Move the back half of some other thread's slice into ours. Our own slice
+// is empty here, so no one else writes to it until we fill it.
+bool ThreadPool::steal(unsigned worker) {
+  unsigned threads = getThreadCount();
+  for (unsigned i = 1; i < threads; ++i) {
+    std::atomic<uint64_t> &victim = slices[(worker + i) % threads].bounds;
+    uint64_t slice = victim.load(std::memory_order_acquire);
+    for (;;) {
+      uint64_t begin = slice & 0xffffffffu, end = slice >> 32;
+      if (begin >= end)
+        break;
+      uint64_t middle = begin + (end - begin) / 2;
+      if (victim.compare_exchange_weak(slice, packSlice(begin, middle),
+                                       std::memory_order_acq_rel)) {
+        slices[worker].bounds.store(packSlice(middle, end),
+                                    std::memory_order_release);
+        return true;
+      }
+    }
+  }
+  return false;
+}
@@ -0,0 +1,90 @@
+#include "UniformRing.h"
+#include <cstring>
+
+void UniformRing::beginFrame() {
+  if (!UBO) {
+    glGenBuffers(1, &UBO);
+    GLint align = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &align);
+    if (align > 0)
+      alignment = static_cast<size_t>(align);
+  }
+  region = (region + 1) % Config::UNIFORM_RING_FRAMES;
+  wait(region);
+  staging.clear();
+}
+
+UniformRing::Range UniformRing::stage(const void *data, size_t size) {
+  size_t offset = (staging.size() + alignment - 1) / alignment * alignment;
+  staging.resize(offset + size);
+  std::memcpy(staging.data() + offset, data, size);
+  return {offset, size};
+}
+
+void UniformRing::flush() {
+  if (staging.empty())
+    return;
+  glBindBuffer(GL_UNIFORM_BUFFER, UBO);
+  if (staging.size() > regionBytes) {
+    // Orphaning the old storage lets the GPU keep reading it, so the
+    // fences guarding it no longer matter
+    regionBytes = (staging.size() + staging.size() / 2 + alignment - 1) /
+                  alignment * alignment;
+    glBufferData(GL_UNIFORM_BUFFER, regionBytes * Config::UNIFORM_RING_FRAMES,
+                 nullptr, GL_DYNAMIC_DRAW);
+    for (GLsync &fence : fences) {
+      if (fence)
+        glDeleteSync(fence);
+      fence = nullptr;
+    }
+  }
+
+  size_t base = region * regionBytes;
+  void *mapped = glMapBufferRange(GL_UNIFORM_BUFFER, base, staging.size(),
+                                  GL_MAP_WRITE_BIT |
+                                      GL_MAP_INVALIDATE_RANGE_BIT |
+                                      GL_MAP_UNSYNCHRONIZED_BIT);
+  if (mapped) {
+    std::memcpy(mapped, staging.data(), staging.size());
+    glUnmapBuffer(GL_UNIFORM_BUFFER);
+  } else {
+    glBufferSubData(GL_UNIFORM_BUFFER, base, staging.size(), staging.data());
+  }
+}
+
+void UniformRing::bind(unsigned int binding, Range range) const {
+  glBindBufferRange(GL_UNIFORM_BUFFER, binding, UBO,
+                    region * regionBytes + range.offset, range.size);
+}
+
+void UniformRing::endFrame() {
+  if (!UBO)
+    return;
+  if (fences[region])
+    glDeleteSync(fences[region]);
+  fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void UniformRing::wait(int index) {
+  if (!fences[index])
+    return;
+  // Flush once so the fence is sure to be signalled, then keep waiting
+  GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+  while (glClientWaitSync(fences[index], flags, 1000000) ==
+         GL_TIMEOUT_EXPIRED)
+    flags = 0;
+  glDeleteSync(fences[index]);
+  fences[index] = nullptr;
+}
+
+void UniformRing::cleanup() {
+  for (GLsync &fence : fences) {
+    if (fence)
+      glDeleteSync(fence);
+    fence = nullptr;
+  }
+  if (UBO)
+    glDeleteBuffers(1, &UBO);
+  UBO = 0;
+  regionBytes = 0;
+}
@@ -1,7 +1,7 @@
 /*
  * Marble Maze - OpenGL Final Project
  * Controls: Arrows=Tilt, WASD=Pan, Q/E=Orbit, Scroll=Zoom, F=Reset, R=Restart,
- * N=Next
+ * N=Next, H=Hints, Tab=Edit level (1-5 brush, left mouse paint, right erase)
  */
 
 #include <glad/glad.h>
@@ -12,52 +12,127 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+
 #include "imgui.h"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_opengl3.h"
 
-#include "Ball.h"
 #include "BoardGenerator.h"
 #include "Camera.h"
 #include "Config.h"
+#include "FlowField.h"
+#include "FlowHints.h"
+#include "Frustum.h"
+#include "InstanceBuffer.h"
 #include "Level.h"
+#include "LevelEditor.h"
 #include "Mesh.h"
+#include "PhysicsThread.h"
 #include "Primitives.h"
+#include "ProgramCache.h"
+#include "Replay.h"
 #include "Shader.h"
+#include "ShaderPermutations.h"
+#include "Simulation.h"
 #include "Texture.h"
+#include "ThreadPool.h"
+#include "UniformBlocks.h"
+#include "UniformRing.h"
 
 int screenWidth = 1280, screenHeight = 720;
 Camera camera(glm::vec3(0.0f), Config::CAMERA_INITIAL_DISTANCE);
 
-enum class GamePhase { Playing, Won, Failed };
-GamePhase gamePhase = GamePhase::Playing;
-
 LevelManager levelManager;
-Ball ball;
 BoardGenerator::BoardMeshes boardMeshes;
+ThreadPool meshWorkers; // Board chunks are meshed in parallel
+// Holes, start and goal: one shared cylinder, instanced per level
+Mesh markerMesh;
+InstanceBuffer markerInstances;
 glm::vec2 boardTilt = glm::vec2(0.0f);
 
+// Way to the goal from every cell, drawn as arrows when hints are on
+FlowField flowField;
+FlowHints flowHints;
+bool showHints = Config::SHOW_HINTS;
+
+// Feature bits of the PBR shader variants, in the order they are loaded
+constexpr uint32_t PBR_INSTANCING = 1;
+constexpr uint32_t PBR_INSTANCE_MATERIAL = 2;
+constexpr uint32_t PBR_TEXTURE_MAPS = 4 | 8 | 16; // Albedo, normal and ARM
+
+// Board chunks inside the view frustum last frame
+std::vector<const BoardGenerator::BoardChunk *> visibleChunks;
+// Uniform values sent and skipped as unchanged last frame
+Shader::UniformStats uniformStats;
+// PBR variants still compiling, as of this frame's update
+size_t shadersPending = 0;
+
+// Level editing (Tab). Physics is stopped while it is on.
+LevelEditor editor;
+bool editing = false;
+CellType brush = CellType::Wall;
+bool mouseLeft = false, mouseRight = false;
+glm::vec2 cursorNdc = glm::vec2(0.0f);
+glm::ivec2 lastPainted = glm::ivec2(-1); // Cell painted by this stroke
+
+// Ball, marbles (M key) and game phase, advanced by the physics thread
+Simulation simulation;
+PhysicsThread physics(simulation, Config::PHYSICS_TICK_RATE,
+                      Config::PHYSICS_MAX_STEPS_PER_FRAME);
+GamePhase gamePhase = GamePhase::Playing; // As of the latest snapshot
+Replay replay; // Recorder for the current run, only touched by physics
+std::shared_ptr<const Replay> savedReplay; // Last finished run written out
+
 float deltaTime = 0.0f, lastFrame = 0.0f;
 bool keyW = false, keyA = false, keyS = false, keyD = false, keyQ = false,
      keyE = false;
 bool keyUp = false, keyDown = false, keyLeft = false, keyRight = false;
+bool keyRewind = false;
+float rewindTicks = 0.0f; // Fractional ticks owed to the rewind
 
 void setupBoard() {
-  boardMeshes.floor.cleanup();
-  boardMeshes.walls.cleanup();
-  boardMeshes.holeMarker.cleanup();
-  boardMeshes.frame.cleanup();
-  boardMeshes.startMarker.cleanup();
-  boardMeshes.goalMarker.cleanup();
-  boardMeshes = BoardGenerator::generateBoard(levelManager.getCurrentLevel());
+  boardMeshes.cleanup();
+  boardMeshes = BoardGenerator::generateBoard(levelManager.getCurrentLevel(),
+                                              meshWorkers);
+  markerInstances.upload(boardMeshes.markerPlacements);
+  markerInstances.uploadMaterials(boardMeshes.markerMaterials);
+
+  Level &level = levelManager.getCurrentLevel();
+  flowField.build(level.cells, level.goalPos);
+  flowHints.sync(flowField);
+  editor.attach(level, boardMeshes, markerInstances, flowField);
 }
 
+// Called with the physics thread stopped
 void restartLevel() {
-  ball.reset(levelManager.getCurrentLevel());
+  simulation.setLevel(&levelManager.getCurrentLevel());
+  simulation.restart();
   boardTilt = glm::vec2(0.0f);
   gamePhase = GamePhase::Playing;
 }
 
+// Write a finished run to REPLAY_DIRECTORY. It is the simulation's copy,
+// handed over in a snapshot, so the physics thread never writes to it.
+void saveReplay(const Replay &run) {
+  std::error_code ec;
+  std::filesystem::create_directories(Config::REPLAY_DIRECTORY, ec);
+
+  char stamp[32];
+  std::time_t now = std::time(nullptr);
+  std::strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", std::localtime(&now));
+  bool won = run.outcome.phase == GamePhase::Won;
+  std::string path = std::string(Config::REPLAY_DIRECTORY) + "/level" +
+                     std::to_string(levelManager.currentLevelIndex + 1) + "-" +
+                     stamp + (won ? "-won" : "-lost") + ".mrp";
+  if (run.save(path))
+    std::cout << "Saved replay: " << path << std::endl;
+  else
+    std::cerr << "Failed to save replay: " << path << std::endl;
+}
+
 void framebufferSizeCallback(GLFWwindow *w, int width, int height) {
   screenWidth = width;
   screenHeight = height;
@@ -70,6 +145,26 @@ void scrollCallback(GLFWwindow *w, double x, double y) {
   camera.processZoom(static_cast<float>(y) * Config::CAMERA_ZOOM_SPEED);
 }
 
+void mouseButtonCallback(GLFWwindow *w, int button, int action, int mods) {
+  bool pressed = action == GLFW_PRESS;
+  if (pressed && ImGui::GetIO().WantCaptureMouse)
+    return;
+  if (button == GLFW_MOUSE_BUTTON_LEFT)
+    mouseLeft = pressed;
+  if (button == GLFW_MOUSE_BUTTON_RIGHT)
+    mouseRight = pressed;
+  if (!pressed)
+    lastPainted = glm::ivec2(-1);
+}
+
+void cursorPosCallback(GLFWwindow *w, double x, double y) {
+  int width, height;
+  glfwGetWindowSize(w, &width, &height);
+  if (width > 0 && height > 0)
+    cursorNdc = glm::vec2(2.0f * static_cast<float>(x) / width - 1.0f,
+                          1.0f - 2.0f * static_cast<float>(y) / height);
+}
+
 void keyCallback(GLFWwindow *w, int key, int sc, int action, int mods) {
   if (ImGui::GetIO().WantCaptureKeyboard)
     return;
@@ -94,6 +189,8 @@ void keyCallback(GLFWwindow *w, int key, int sc, int action, int mods) {
     keyLeft = pressed;
   if (key == GLFW_KEY_RIGHT)
     keyRight = pressed;
+  if (key == GLFW_KEY_BACKSPACE)
+    keyRewind = pressed;
 
   if (action == GLFW_PRESS) {
     if (key == GLFW_KEY_F) {
@@ -101,12 +198,42 @@ void keyCallback(GLFWwindow *w, int key, int sc, int action, int mods) {
       camera.Distance = Config::CAMERA_INITIAL_DISTANCE;
       camera.Pitch = Config::CAMERA_INITIAL_PITCH;
     }
-    if (key == GLFW_KEY_R)
+    if (key == GLFW_KEY_R && !editing) {
+      physics.stop();
       restartLevel();
-    if (key == GLFW_KEY_N && gamePhase == GamePhase::Won &&
-        levelManager.nextLevel()) {
+      physics.start(Config::PHYSICS_ON_THREAD);
+    }
+    if (key == GLFW_KEY_H)
+      showHints = !showHints;
+    if (key == GLFW_KEY_TAB) {
+      // Editing starts from a still, level board; playing again restarts
+      physics.stop();
+      editing = !editing;
+      boardTilt = glm::vec2(0.0f);
+      if (!editing) {
+        restartLevel();
+        physics.start(Config::PHYSICS_ON_THREAD);
+      }
+    }
+    if (editing && key >= GLFW_KEY_1 && key <= GLFW_KEY_5) {
+      static const CellType BRUSHES[5] = {CellType::Floor, CellType::Wall,
+                                          CellType::Hole, CellType::Start,
+                                          CellType::Goal};
+      brush = BRUSHES[key - GLFW_KEY_1];
+    }
+    if (key == GLFW_KEY_M && !editing) {
+      physics.stop();
+      simulation.setMultiMarble(!simulation.isMultiMarble());
+      boardTilt = glm::vec2(0.0f);
+      physics.start(Config::PHYSICS_ON_THREAD);
+    }
+    if (key == GLFW_KEY_N && !editing && gamePhase == GamePhase::Won &&
+        levelManager.hasNextLevel()) {
+      physics.stop();
+      levelManager.nextLevel();
       setupBoard();
       restartLevel();
+      physics.start(Config::PHYSICS_ON_THREAD);
     }
     if (key == GLFW_KEY_ESCAPE)
       glfwSetWindowShouldClose(w, true);
@@ -130,7 +257,7 @@ void processInput() {
   if (keyE)
     camera.processOrbit(orbitAmount, 0);
 
-  if (gamePhase == GamePhase::Playing) {
+  if (gamePhase == GamePhase::Playing && !editing) {
     float maxTilt = glm::radians(Config::MAX_TILT_DEGREES);
     float tiltDelta = glm::radians(Config::TILT_SPEED_DEGREES) * deltaTime;
     float returnDelta =
@@ -163,18 +290,49 @@ void processInput() {
   }
 }
 
-void updateGame() {
-  if (gamePhase == GamePhase::Playing) {
-    Level &level = levelManager.getCurrentLevel();
-    ball.update(deltaTime, boardTilt, level);
-    if (ball.hasFallenInHole())
-      gamePhase = GamePhase::Failed;
-    else if (level.isAtGoal(ball.position, ball.radius))
-      gamePhase = GamePhase::Won;
+const PhysicsThread::Snapshot &updateGame() {
+  if (editing)
+    return physics.latest();
+
+  // Holding Backspace runs the ball's history backwards
+  bool rewinding = keyRewind && gamePhase != GamePhase::Won &&
+                   !simulation.isMultiMarble();
+  uint32_t ticks = 0;
+  if (rewinding) {
+    rewindTicks +=
+        deltaTime * Config::PHYSICS_TICK_RATE * Config::REWIND_SPEED;
+    ticks = static_cast<uint32_t>(rewindTicks);
+    rewindTicks -= ticks;
   }
+  physics.setInput(boardTilt, rewinding, ticks);
+  physics.pump(deltaTime);
+  const PhysicsThread::Snapshot &state = physics.latest();
+  if (rewinding)
+    boardTilt = state.tilt; // Resume with the tilt from that moment
+  if (state.finishedReplay != savedReplay) {
+    savedReplay = state.finishedReplay;
+    if (savedReplay)
+      saveReplay(*savedReplay);
+  }
+  gamePhase = state.phase;
+  return state;
 }
 
-void renderUI() {
+// Paint the brush (or floor, with the right button) on the cell under the
+// cursor, once per cell per stroke
+void editBoard(const glm::mat4 &boardClip) {
+  if (!mouseLeft && !mouseRight)
+    return;
+  glm::ivec2 cell;
+  if (!editor.pick(cursorNdc, glm::inverse(boardClip), cell) ||
+      cell == lastPainted)
+    return;
+  lastPainted = cell;
+  if (editor.paint(cell, mouseLeft ? brush : CellType::Floor))
+    flowHints.sync(flowField);
+}
+
+void renderUI(const PhysicsThread::Snapshot &state) {
   ImGui::SetNextWindowPos(ImVec2(10, 10));
   ImGui::SetNextWindowBgAlpha(0.7f);
   ImGui::Begin("Game", nullptr,
@@ -183,7 +341,15 @@ void renderUI() {
   ImGui::Text("Level %d / %d", levelManager.currentLevelIndex + 1,
               (int)levelManager.levels.size());
   ImGui::Separator();
-  if (gamePhase == GamePhase::Playing) {
+  if (editing) {
+    const LevelEditor::Stats &edit = editor.getLastEdit();
+    ImGui::TextColored(ImVec4(0.5f, 0.8f, 1.0f, 1.0f), "EDITING");
+    ImGui::Text("Brush: %c (1-5)", CellGrid::toChar(brush));
+    ImGui::Text("Left paint, right erase");
+    ImGui::Text("Last edit: %d cells, %d chunks", edit.cells, edit.chunks);
+    ImGui::Text("           %.3f ms", edit.milliseconds);
+    ImGui::Text("Tab to play");
+  } else if (gamePhase == GamePhase::Playing) {
     ImGui::TextColored(ImVec4(0.5f, 1.0f, 0.5f, 1.0f), "Playing...");
     ImGui::Text("Arrow Keys to tilt");
   } else if (gamePhase == GamePhase::Won) {
@@ -194,8 +360,23 @@ void renderUI() {
     ImGui::TextColored(ImVec4(1.0f, 0.3f, 0.3f, 1.0f), "FELL IN HOLE!");
     ImGui::Text("Press R to restart");
   }
+  if (!editing && !simulation.isMultiMarble() && gamePhase != GamePhase::Won)
+    ImGui::Text("Backspace: rewind (%.0f s)", state.rewindSeconds);
+  if (simulation.isMultiMarble()) {
+    ImGui::Separator();
+    ImGui::Text("Marbles: %d rolling", (int)state.marblePosition.size());
+    ImGui::Text("Home %d / Lost %d", state.marblesHome, state.marblesLost);
+  }
   ImGui::Separator();
   ImGui::Text("FPS: %.0f", ImGui::GetIO().Framerate);
+  ImGui::Text("Board chunks: %d / %d", (int)visibleChunks.size(),
+              (int)boardMeshes.chunks.size());
+  ImGui::Text("Uniforms: %d sent, %d skipped", uniformStats.sent,
+              uniformStats.skipped);
+  if (shadersPending)
+    ImGui::Text("Shaders: %d compiling, %s", (int)shadersPending,
+                Shader::hasParallelCompile() ? "in parallel"
+                                             : "a stage per frame");
   ImGui::End();
 
   ImGui::SetNextWindowPos(ImVec2(screenWidth - 180.0f, 10));
@@ -209,6 +390,10 @@ void renderUI() {
   ImGui::BulletText("Scroll: Zoom");
   ImGui::BulletText("F: Reset");
   ImGui::BulletText("R: Restart");
+  ImGui::BulletText("M: Multi-marble");
+  ImGui::BulletText("H: Hints");
+  ImGui::BulletText("Backspace: Rewind");
+  ImGui::BulletText("Tab: Edit level");
   ImGui::End();
 }
 
@@ -233,9 +418,17 @@ int main() {
   glfwSetFramebufferSizeCallback(window, framebufferSizeCallback);
   glfwSetScrollCallback(window, scrollCallback);
   glfwSetKeyCallback(window, keyCallback);
+  glfwSetMouseButtonCallback(window, mouseButtonCallback);
+  glfwSetCursorPosCallback(window, cursorPosCallback);
 
   if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
     return -1;
+  if (Shader::enableParallelCompile((GLADloadproc)glfwGetProcAddress))
+    std::cout << "Parallel shader compile: on" << std::endl;
+  else
+    std::cout << "Parallel shader compile: not supported; shader variants "
+                 "compile a stage per frame"
+              << std::endl;
 
   glEnable(GL_DEPTH_TEST);
   glEnable(GL_CULL_FACE);
@@ -246,9 +439,29 @@ int main() {
   ImGui_ImplGlfw_InitForOpenGL(window, true);
   ImGui_ImplOpenGL3_Init("#version 410");
 
-  Shader pbrShader;
-  if (!pbrShader.load("assets/shaders/pbr.vert", "assets/shaders/pbr.frag"))
+  ShaderPermutations pbrShaders;
+  if (!pbrShaders.load("assets/shaders/pbr.vert", "assets/shaders/pbr.frag",
+                       {"INSTANCING", "INSTANCE_MATERIAL", "ALBEDO_MAP",
+                        "NORMAL_MAP", "ARM_MAP"},
+                       [](const Shader &shader) {
+                         shader.bindBlock("FrameBlock",
+                                          UniformBlocks::FRAME_BINDING);
+                         shader.bindBlock("MaterialBlock",
+                                          UniformBlocks::MATERIAL_BINDING);
+                         shader.bindBlock("ObjectBlock",
+                                          UniformBlocks::OBJECT_BINDING);
+                         shader.setInt(UNIFORM("albedoMap"), 0);
+                         shader.setInt(UNIFORM("normalMap"), 1);
+                         shader.setInt(UNIFORM("armMap"), 2);
+                       }))
     return -1;
+  // The plain and instanced variants stand in for the others while they
+  // compile. With parallel compile the driver works on them while the
+  // textures load.
+  double shaderStart = glfwGetTime();
+  pbrShaders.request(0);
+  pbrShaders.request(PBR_INSTANCING);
+  UniformRing uniforms;
 
   Texture woodAlbedo, woodNormal, woodARM;
   Texture ballAlbedo, ballNormal, ballARM;
@@ -275,11 +488,39 @@ int main() {
       ballARM.loadFromFile("assets/textures/green_metal_rust_arm.png", false);
 #endif
 
+  // The variants every frame draws with, submitted up front and finished
+  // by pbrShaders.update(): as the driver gets through them with parallel
+  // compile, a stage per frame without
+  const uint32_t woodFeatures = woodTexturesLoaded ? PBR_TEXTURE_MAPS : 0;
+  const uint32_t ballFeatures = ballTexturesLoaded ? PBR_TEXTURE_MAPS : 0;
+  const uint32_t markerFeatures = PBR_INSTANCING | PBR_INSTANCE_MATERIAL;
+  pbrShaders.request(woodFeatures);
+  pbrShaders.request(ballFeatures);
+  pbrShaders.request(markerFeatures);
+  if (!pbrShaders.require(0) || !pbrShaders.require(PBR_INSTANCING))
+    return -1;
+  bool shadersReported = false;
+
+  if (!flowHints.init())
+    std::cerr << "Hint shaders failed to load; hints disabled" << std::endl;
+
+  markerMesh = BoardGenerator::createMarkerMesh();
+  markerInstances.attach(markerMesh, true);
+
   levelManager.loadBuiltInLevels();
+  if (Config::RECORD_REPLAYS)
+    simulation.setRecorder(&replay);
   setupBoard();
   restartLevel();
+  physics.start(Config::PHYSICS_ON_THREAD);
 
   Mesh ballMesh = Primitives::createSphere(Config::BALL_RADIUS, 48, 24);
+
+  // Marbles share one lower-poly sphere drawn with a single instanced call
+  Mesh marbleMesh = Primitives::createSphere(Config::BALL_RADIUS, 24, 12);
+  InstanceBuffer marbleInstances;
+  marbleInstances.attach(marbleMesh);
+  std::vector<glm::vec4> marblePlacements;
   camera.Pitch = Config::CAMERA_INITIAL_PITCH;
   camera.Yaw = -90.0f;
   camera.Distance = Config::CAMERA_INITIAL_DISTANCE;
@@ -291,12 +532,24 @@ int main() {
 
     glfwPollEvents();
     processInput();
-    updateGame();
+    const PhysicsThread::Snapshot &state = updateGame();
+
+    pbrShaders.update();
+    shadersPending = pbrShaders.getPendingCount();
+    if (!shadersReported && shadersPending == 0) {
+      const ProgramCache::Stats &programs = ProgramCache::getStats();
+      std::cout << "Shaders ready in "
+                << (glfwGetTime() - shaderStart) * 1000.0 << " ms ("
+                << programs.hits << " cached, " << programs.misses
+                << " compiled)" << std::endl;
+      shadersReported = true;
+    }
 
+    uniformStats = Shader::takeUniformStats();
     ImGui_ImplOpenGL3_NewFrame();
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
-    renderUI();
+    renderUI(state);
 
     glClearColor(0.15f, 0.15f, 0.18f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
@@ -305,147 +558,164 @@ int main() {
     glm::mat4 view = camera.getViewMatrix();
     glm::mat4 projection = camera.getProjectionMatrix(aspect);
 
+    // Blend the last two physics ticks by how far into the next one we are
+    float renderAlpha = physics.getAlpha(state);
+
     glm::mat4 boardModel = glm::mat4(1.0f);
     boardModel = glm::rotate(boardModel, boardTilt.x, glm::vec3(0, 0, 1));
     boardModel = glm::rotate(boardModel, boardTilt.y, glm::vec3(1, 0, 0));
 
-    pbrShader.use();
-    pbrShader.setMat4("view", view);
-    pbrShader.setMat4("projection", projection);
-    pbrShader.setVec3("camPos", camera.getPosition());
-    pbrShader.setVec3("ambientColor", glm::vec3(0.3f));
-
-    pbrShader.setInt("numLights", 2);
-    pbrShader.setVec3(
-        "lightPositions[0]",
-        glm::vec3(Config::LIGHT1_X, Config::LIGHT1_Y, Config::LIGHT1_Z));
-    pbrShader.setVec3("lightColors[0]", glm::vec3(1.0f));
-    pbrShader.setFloat("lightIntensities[0]", Config::LIGHT1_INTENSITY);
-    pbrShader.setInt("lightTypes[0]", 0);
-    pbrShader.setVec3(
-        "lightPositions[1]",
-        glm::vec3(Config::LIGHT2_X, Config::LIGHT2_Y, Config::LIGHT2_Z));
-    pbrShader.setVec3("lightColors[1]", glm::vec3(1.0f, 0.95f, 0.9f));
-    pbrShader.setFloat("lightIntensities[1]", Config::LIGHT2_INTENSITY);
-    pbrShader.setInt("lightTypes[1]", 0);
+    // Every block the PBR draws read this frame, uploaded in one write;
+    // the draws below only choose theirs
+    using UniformBlocks::material;
+    using UniformBlocks::object;
+    uniforms.beginFrame();
+    UniformBlocks::Frame frameBlock;
+    frameBlock.view = view;
+    frameBlock.projection = projection;
+    frameBlock.camPos = glm::vec4(camera.getPosition(), 1.0f);
+    frameBlock.ambientColor = glm::vec4(glm::vec3(0.3f), 1.0f);
+    frameBlock.numLights = 2;
+    frameBlock.lightPositions[0] =
+        glm::vec4(Config::LIGHT1_X, Config::LIGHT1_Y, Config::LIGHT1_Z, 0.0f);
+    frameBlock.lightColors[0] =
+        glm::vec4(glm::vec3(1.0f), Config::LIGHT1_INTENSITY);
+    frameBlock.lightPositions[1] =
+        glm::vec4(Config::LIGHT2_X, Config::LIGHT2_Y, Config::LIGHT2_Z, 0.0f);
+    frameBlock.lightColors[1] =
+        glm::vec4(1.0f, 0.95f, 0.9f, Config::LIGHT2_INTENSITY);
+    UniformRing::Range frameUniforms = uniforms.stage(frameBlock);
+
+    UniformRing::Range floorMaterial = uniforms.stage(
+        material(glm::vec3(0.6f, 0.45f, 0.28f), Config::WOOD_METALLIC,
+                 Config::WOOD_ROUGHNESS));
+    UniformRing::Range wallMaterial = uniforms.stage(
+        material(glm::vec3(0.55f, 0.4f, 0.25f), Config::WOOD_METALLIC,
+                 Config::WOOD_ROUGHNESS));
+    UniformRing::Range frameMaterial = uniforms.stage(
+        material(glm::vec3(0.5f, 0.38f, 0.22f), Config::WOOD_METALLIC,
+                 Config::WOOD_ROUGHNESS));
+    // Markers take their surface from the instances
+    UniformRing::Range markerMaterial =
+        uniforms.stage(UniformBlocks::Material());
+    UniformRing::Range ballMaterial = uniforms.stage(material(
+        glm::vec3(0.95f), Config::BALL_METALLIC, Config::BALL_ROUGHNESS));
+    UniformRing::Range marbleMaterial =
+        uniforms.stage(material(glm::vec3(0.85f, 0.2f, 0.15f), 0.3f, 0.25f));
+
+    glm::mat4 ballModel =
+        boardModel *
+        glm::translate(glm::mat4(1.0f), glm::mix(state.ballPrevious,
+                                                 state.ballPosition,
+                                                 renderAlpha));
+    UniformRing::Range boardObject = uniforms.stage(object(boardModel));
+    UniformRing::Range ballObject = uniforms.stage(object(ballModel));
+    uniforms.flush();
+
+    uniforms.bind(UniformBlocks::FRAME_BINDING, frameUniforms);
+
+    if (editing)
+      editBoard(projection * view * boardModel);
+
+    // Board chunks outside the view are skipped. The chunk bounds are in
+    // board space, so the frustum is taken through the board's tilt.
+    Frustum boardFrustum = camera.getFrustum(aspect, boardModel);
+    visibleChunks.clear();
+    for (const auto &chunk : boardMeshes.chunks) {
+      if (boardFrustum.intersects(chunk.min, chunk.max))
+        visibleChunks.push_back(&chunk);
+    }
 
 #ifdef USE_REAL_TEXTURES
     if (woodTexturesLoaded) {
-      pbrShader.setBool("useAlbedoMap", true);
-      pbrShader.setBool("useNormalMap", true);
-      pbrShader.setBool("useARMMap", true);
       woodAlbedo.bind(0);
       woodNormal.bind(1);
       woodARM.bind(2);
-      pbrShader.setInt("albedoMap", 0);
-      pbrShader.setInt("normalMap", 1);
-      pbrShader.setInt("armMap", 2);
-    } else
-#endif
-    {
-      pbrShader.setBool("useAlbedoMap", false);
-      pbrShader.setBool("useNormalMap", false);
-      pbrShader.setBool("useARMMap", false);
     }
+#endif
+
+    // Variants still compiling draw with a fallback
+    const Shader *woodShader = pbrShaders.get(woodFeatures);
+    const Shader *ballShader = pbrShaders.get(ballFeatures);
+    const Shader *markerShader = pbrShaders.get(markerFeatures);
+    const Shader *marbleShader = pbrShaders.get(PBR_INSTANCING);
 
     // Floor
-    pbrShader.setMat4("model", boardModel);
-    pbrShader.setVec3("albedo", glm::vec3(0.6f, 0.45f, 0.28f));
-    pbrShader.setFloat("metallic", Config::WOOD_METALLIC);
-    pbrShader.setFloat("roughness", Config::WOOD_ROUGHNESS);
-    pbrShader.setFloat("ao", 1.0f);
-    boardMeshes.floor.draw();
+    woodShader->use();
+    uniforms.bind(UniformBlocks::OBJECT_BINDING, boardObject);
+    uniforms.bind(UniformBlocks::MATERIAL_BINDING, floorMaterial);
+    for (const auto *chunk : visibleChunks) {
+      if (!chunk->floor.indices.empty())
+        chunk->floor.draw();
+    }
 
     // Walls
-    pbrShader.setVec3("albedo", glm::vec3(0.55f, 0.4f, 0.25f));
-    boardMeshes.walls.draw();
+    uniforms.bind(UniformBlocks::MATERIAL_BINDING, wallMaterial);
+    for (const auto *chunk : visibleChunks) {
+      if (!chunk->walls.indices.empty())
+        chunk->walls.draw();
+    }
 
     // Frame
-    pbrShader.setVec3("albedo", glm::vec3(0.5f, 0.38f, 0.22f));
+    uniforms.bind(UniformBlocks::MATERIAL_BINDING, frameMaterial);
     // boardMeshes.frame.draw();
 
-#ifdef USE_REAL_TEXTURES
-    pbrShader.setBool("useAlbedoMap", false);
-    pbrShader.setBool("useNormalMap", false);
-    pbrShader.setBool("useARMMap", false);
-#endif
     Level &level = levelManager.getCurrentLevel();
 
-    // Holes - render each hole individually
-    pbrShader.setVec3("albedo", glm::vec3(0.05f)); // Very dark for holes
-    pbrShader.setFloat("metallic", 0.0f);
-    pbrShader.setFloat("roughness", 0.95f);
-    for (const auto &holePos : level.holePoss) {
-      glm::vec3 holeWorldPos = level.gridToWorld(holePos);
-      holeWorldPos.y = 0.02f; // Raise above floor
-      glm::mat4 holeModel =
-          boardModel * glm::translate(glm::mat4(1.0f), holeWorldPos);
-      pbrShader.setMat4("model", holeModel);
-      boardMeshes.holeMarker.draw();
-    }
+    // Holes, start and goal - one instanced draw with per-instance
+    // placement and material, uploaded once per level
+    markerShader->use();
+    uniforms.bind(UniformBlocks::MATERIAL_BINDING, markerMaterial);
+    markerMesh.drawInstanced(markerInstances.getCount());
 
-    // Start marker - slight Y offset to prevent z-fighting
-    glm::vec3 startWorldPos = level.gridToWorld(level.startPos);
-    startWorldPos.y = 0.02f; // Raise above floor
-    glm::mat4 startModel =
-        boardModel * glm::translate(glm::mat4(1.0f), startWorldPos);
-    pbrShader.setMat4("model", startModel);
-    pbrShader.setVec3("albedo", glm::vec3(0.2f, 0.8f, 0.3f));
-    pbrShader.setFloat("metallic", 0.0f);
-    pbrShader.setFloat("roughness", 0.5f);
-    boardMeshes.startMarker.draw();
-
-    // Goal marker - slight Y offset to prevent z-fighting
-    glm::vec3 goalWorldPos = level.gridToWorld(level.goalPos);
-    goalWorldPos.y = 0.02f; // Raise above floor
-    glm::mat4 goalModel =
-        boardModel * glm::translate(glm::mat4(1.0f), goalWorldPos);
-    pbrShader.setMat4("model", goalModel);
-    pbrShader.setVec3("albedo", glm::vec3(1.0f, 0.84f, 0.0f));
-    pbrShader.setFloat("metallic", 0.9f);
-    pbrShader.setFloat("roughness", 0.3f);
-    boardMeshes.goalMarker.draw();
-
-    // Ball - with PBR textures
-    glm::mat4 ballModel =
-        boardModel * glm::translate(glm::mat4(1.0f), ball.position);
-    pbrShader.setMat4("model", ballModel);
+    // Ball - with PBR textures, interpolated between physics ticks
 #ifdef USE_REAL_TEXTURES
     if (ballTexturesLoaded) {
-      pbrShader.setBool("useAlbedoMap", true);
-      pbrShader.setBool("useNormalMap", true);
-      pbrShader.setBool("useARMMap", true);
       ballAlbedo.bind(0);
       ballNormal.bind(1);
       ballARM.bind(2);
-      pbrShader.setInt("albedoMap", 0);
-      pbrShader.setInt("normalMap", 1);
-      pbrShader.setInt("armMap", 2);
-    } else
-#endif
-    {
-      pbrShader.setBool("useAlbedoMap", false);
-      pbrShader.setBool("useNormalMap", false);
-      pbrShader.setBool("useARMMap", false);
     }
-    pbrShader.setVec3("albedo", glm::vec3(0.95f));
-    pbrShader.setFloat("metallic", Config::BALL_METALLIC);
-    pbrShader.setFloat("roughness", Config::BALL_ROUGHNESS);
-    pbrShader.setFloat("ao", 1.0f);
+#endif
+    ballShader->use();
+    uniforms.bind(UniformBlocks::OBJECT_BINDING, ballObject);
+    uniforms.bind(UniformBlocks::MATERIAL_BINDING, ballMaterial);
     ballMesh.draw();
 
+    // Marbles - one instanced draw for all of them
+    if (!state.marblePosition.empty()) {
+      marblePlacements.resize(state.marblePosition.size());
+      for (size_t i = 0; i < marblePlacements.size(); ++i)
+        marblePlacements[i] =
+            glm::vec4(glm::mix(state.marblePrevious[i],
+                               state.marblePosition[i], renderAlpha),
+                      1.0f);
+      marbleInstances.upload(marblePlacements);
+      marbleShader->use();
+      uniforms.bind(UniformBlocks::OBJECT_BINDING, boardObject);
+      uniforms.bind(UniformBlocks::MATERIAL_BINDING, marbleMaterial);
+      marbleMesh.drawInstanced(marbleInstances.getCount());
+    }
+    uniforms.endFrame();
+
+    // Hint arrows - translucent, so after everything opaque
+    if (showHints)
+      flowHints.draw(boardModel, view, projection, level.cellSize);
+
     ImGui::Render();
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
     glfwSwapBuffers(window);
   }
 
-  boardMeshes.floor.cleanup();
-  boardMeshes.walls.cleanup();
-  boardMeshes.holeMarker.cleanup();
-  boardMeshes.frame.cleanup();
-  boardMeshes.startMarker.cleanup();
-  boardMeshes.goalMarker.cleanup();
+  boardMeshes.cleanup();
+  markerMesh.cleanup();
+  markerInstances.cleanup();
+  physics.stop();
   ballMesh.cleanup();
+  marbleMesh.cleanup();
+  marbleInstances.cleanup();
+  uniforms.cleanup();
+  pbrShaders.cleanup();
+  flowHints.cleanup();
   woodAlbedo.cleanup();
   woodNormal.cleanup();
   woodARM.cleanup();